@@ -59,6 +59,7 @@ struct dp_tree {
 std::ostream& operator<<( std::ostream& os, const dp_tree *node );
 
 std::vector<parsrel> alpino_server_parse( frog_data& fd );
+std::vector<parsrel> xml_to_parse( const std::string&, frog_data& );
 
 /// \brief a specialization of ParserBase to run a true AlpinoParser
 class AlpinoParser: public ParserBase {
@@ -67,10 +68,12 @@ class AlpinoParser: public ParserBase {
   ParserBase( errlog, dbglog ),
     _alpino_server(false)
       {};
-  bool init( const TiCC::Configuration& ) override;
+  bool init( const TiCC::Configuration&,
+	     const ParserBase * =0 ) override;
   void add_provenance( folia::Document& doc,
 		       folia::processor * ) const override;
   void Parse( frog_data&, TimerBlock& ) override;
+  void ParseBatch( const std::vector<frog_data*>&, TimerBlock& ) override;
   void add_result( const frog_data&,
 		   const std::vector<folia::Word*>& ) const override;
   void add_mwus( const frog_data&,
@@ -32,10 +32,12 @@
 #ifndef FROG_H
 #define FROG_H
 
+#include <cstdint>
 #include <set>
 #include <ostream>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include "ticcutils/Timer.h"
 #include "ticcutils/Unicode.h"
@@ -50,6 +52,12 @@ std::string check_server( const std::string&,
 			  const std::string&,
 			  const std::string& = "" );
 
+uint64_t fnv_hash( const char *, size_t, uint64_t = 14695981039346656037ULL );
+
+uint64_t make_stamp( const std::string&, const std::string& = "" );
+
+uint64_t make_stamp( const std::string&, const std::vector<std::string>& );
+
 /// \brief a collection of Ticc:Timers that registrate timings per module
 class TimerBlock{
 public:
@@ -83,6 +91,23 @@ public:
     csiTimer.reset();
     frogTimer.reset();
   }
+  void add( const TimerBlock& tb ){
+    /// add the timings of another TimerBlock to ours
+    parseTimer = parseTimer + tb.parseTimer;
+    tokTimer = tokTimer + tb.tokTimer;
+    mblemTimer = mblemTimer + tb.mblemTimer;
+    mbmaTimer = mbmaTimer + tb.mbmaTimer;
+    mwuTimer = mwuTimer + tb.mwuTimer;
+    tagTimer = tagTimer + tb.tagTimer;
+    iobTimer = iobTimer + tb.iobTimer;
+    nerTimer = nerTimer + tb.nerTimer;
+    prepareTimer = prepareTimer + tb.prepareTimer;
+    pairsTimer = pairsTimer + tb.pairsTimer;
+    relsTimer = relsTimer + tb.relsTimer;
+    dirTimer = dirTimer + tb.dirTimer;
+    csiTimer = csiTimer + tb.csiTimer;
+    frogTimer = frogTimer + tb.frogTimer;
+  }
 };
 
 #endif
@@ -31,6 +31,8 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <atomic>
 #include <iostream>
 
 #include "timbl/TimblAPI.h"
@@ -45,6 +47,7 @@
 
 #include "frog/Frog-util.h"
 #include "frog/FrogData.h"
+#include "frog/result_cache.h"
 
 class UctoTokenizer;
 class Mbma;
@@ -54,6 +57,27 @@ class ParserBase;
 class CGNTagger;
 class IOBTagger;
 class NERTagger;
+class ResourceBundle;
+
+/// \brief a read cursor over a list of tokens delivered by the tokenizer
+/*!
+  Extracting sentences through a cursor walks the list once: the text of the
+  consumed tokens is moved into the frog_records and the tokens themselves are
+  never erased from, or copied out of, the list.
+ */
+class token_cursor {
+ public:
+  explicit token_cursor( std::vector<Tokenizer::Token>& toks ):
+    _tokens( toks ),
+    _pos( 0 )
+  {};
+  bool done() const { return _pos >= _tokens.size(); };
+  size_t position() const { return _pos; };
+  Tokenizer::Token& next() { return _tokens[_pos++]; };
+ private:
+  std::vector<Tokenizer::Token>& _tokens; ///< the list we walk
+  size_t _pos;                             ///< the first unconsumed token
+};
 
 /// \brief this class holds the runtime settings for Frog
 class FrogOptions {
@@ -117,6 +141,45 @@ class FrogOptions {
   bool do_und_language;     ///< should the tokenizer handle 'und'?
   bool do_language_detection;  ///< should the tokenizer detect more languages?
   int numThreads;           ///< limit for the number of threads
+  int numWorkers;           ///< the number of sentence analysis workers
+  /*!< When > 1, plain text input is tokenized in a separate thread and the
+    sentences are distributed over this number of analysis workers, each with
+    its own set of modules. The results are output in the original order.
+   */
+  int queueDepth;           ///< maximum number of sentences (or batches) 'in flight'
+  /*!< Only used with numWorkers > 1. It limits the number of sentences that
+    are tokenized, but not yet output. (default 4 * numWorkers)
+   */
+  int numFileWorkers;       ///< the number of files to Frog concurrently
+  /*!< When > 1, and more then 1 file is given, the files are divided over this
+    number of child processes, which share the loaded models.
+   */
+  int numServerWorkers;     ///< the number of pre-forked server processes
+  /*!< In server mode, connections are handled by this number of worker
+    processes, which are forked once at startup and then accept connections
+    one after another. Set with the --threads option.
+   */
+  bool doMultiplex;         ///< should we multiplex clients?
+  /*!< When true, 1 epoll loop keeps many connections open, and queues the
+    complete requests for numServerWorkers analysis processes.
+   */
+  int listenBacklog;        ///< the number of pending connections for listen()
+  size_t maxConnections;    ///< max open connections of the epoll loop
+  size_t maxRequestSize;    ///< max size of 1 server request in bytes
+  /*!< Checked while reading, so oversized requests are refused before they
+    are completely read. 0 means no limit
+   */
+  size_t maxRequests;       ///< max server requests analyzed or queued
+  /*!< Requests beyond this get a 'busy' reply. 0 means no limit
+   */
+  int batchSize;            ///< the number of sentences to analyze at once
+  /*!< When > 1, plain text input is analyzed in batches of this size. Every
+    module then handles the whole batch before the next module takes over.
+   */
+  size_t sentenceCacheSize; ///< memory bound of the sentence cache in MB
+  /*!< When > 0, the results for sentences are kept, and an identical sentence
+    later on is copied from the cache instead of being analyzed again.
+   */
   int debugFlag;            ///< value for the generic debug level
   /*!< This value is used as the debug level for EVERY module.
     It is however possible to set specific levels per module too.
@@ -173,6 +236,37 @@ maximum of 500 words PER SENTENC. Which is already a lot!
   FrogOptions( const FrogOptions & ) = delete;
 };
 
+/// \brief the set of modules and timers used by one analysis thread
+/*!
+  All Frog modules keep intermediate results in their members, so every thread
+  that analyzes sentences needs its own set of them. The heavy parts (MBT
+  taggers, Timbl instance bases, NER gazeteers) can be shared with a model
+  worker, see FrogWorker::init().
+ */
+class FrogWorker {
+ public:
+  FrogWorker( TiCC::LogStream *, TiCC::LogStream * );
+  ~FrogWorker();
+  bool init( const TiCC::Configuration&,
+	     const FrogOptions&,
+	     const FrogWorker * =0,
+	     const ResourceBundle * =0 );
+  int remote_modules() const;
+  Mbma *myMbma;             ///< pointer to the MBMA module
+  Mblem *myMblem;           ///< pointer to the MBLEM module
+  Mwu *myMwu;               ///< pointer to the MWU module
+  ParserBase *myParser;     ///< pointer to the CKY parser module
+  CGNTagger *myCGNTagger;   ///< pointer to the CGN tagger
+  IOBTagger *myIOBTagger;   ///< pointer to the IOB chunker
+  NERTagger *myNERTagger;   ///< pointer to the NER
+  TimerBlock timers;        ///< the timers for this worker
+ private:
+  TiCC::LogStream *errLog;  ///< the stream to send errors to
+  TiCC::LogStream *dbgLog;  ///< the stream to send debug info
+  FrogWorker( const FrogWorker& ) = delete;
+  FrogWorker operator=( const FrogWorker& ) = delete;
+};
+
 /// \brief This is the API class which can be used to set up Frog and run it
 /// on files, strings, TCP sockets or a terminal.
 class FrogAPI {
@@ -196,11 +290,34 @@ class FrogAPI {
 			TiCC::Configuration&,
 			TiCC::LogStream* );
   folia::Document *FrogFile( const std::string& );
+  void frog_one_file( const std::string& );
+  void run_on_files_parallel();
+  void run_server_worker( Sockets::ServerSocket& );
+  bool handle_request( const std::string&, std::string& );
+  std::string error_reply( const std::string& ) const;
+  bool claim_request();
   void FrogServer( Sockets::ClientSocket &conn );
 
   frog_data frog_sentence( std::vector<Tokenizer::Token>&,
 			   const size_t,
 			   bool=false );
+  frog_data frog_sentence( token_cursor&,
+			   const size_t,
+			   bool=false );
+  std::vector<frog_data> frog_sentences( std::vector<std::vector<Tokenizer::Token>>&,
+					 const size_t );
+  bool wanted_language( const frog_data&, const size_t ) const;
+  void analyze_sentence( frog_data&, const size_t, FrogWorker& );
+  void analyze_sentences( const std::vector<std::pair<frog_data*,size_t>>&,
+			  FrogWorker& );
+  void run_modules( const std::vector<std::pair<frog_data*,size_t>>&,
+		    FrogWorker& );
+  std::string sentence_key( const frog_data& ) const;
+  int run_text_pipeline( std::istream&,
+			 std::ostream&,
+			 folia::FoliaElement *&,
+			 unsigned int& );
+  void collect_timers();
   folia::Document *run_folia_engine( const std::string&,
 				     std::ostream& );
   folia::Document *run_text_engine( const std::string&,
@@ -264,6 +381,15 @@ class FrogAPI {
   IOBTagger *myIOBTagger;   ///< pointer to the IOB chunker
   NERTagger *myNERTagger;   ///< pointer to the NER
   UctoTokenizer *tokenizer; ///< pointer to the Ucot tokenizer
+  std::vector<FrogWorker*> workers; ///< the analysis workers
+  ResourceBundle *resources; ///< the precompiled resources, for all workers
+  std::atomic<size_t> *activeRequests; ///< per server process, shared by all
+  size_t requestSlot;       ///< our own entry in activeRequests
+  ResultCache<std::string,
+	      std::shared_ptr<const frog_data>> *sentence_cache; ///< finished sentences
+  /*!< workers[0] holds the modules pointed to by myMbma, myMblem etc.
+    More workers are only created when options.numWorkers > 1
+   */
 };
 
 std::vector<std::string> get_full_morph_analysis( folia::Word *word,
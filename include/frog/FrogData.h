@@ -38,38 +38,62 @@
 #include <set>
 #include "ticcutils/Unicode.h"
 #include "ticcutils/json.hpp"
+#include "frog/symbol_table.h"
 
 class BaseBracket;
+class cgn_tag;
 namespace Tokenizer {
   class Token;
 }
 
 /// a simple datastructure to hold all frogged information of one word
+/*!
+  The values that come from a small closed set (token class, tags and the
+  dependency role) are interned symbols, which keeps the records small and
+  makes comparing them cheap.
+ */
 class frog_record {
  public:
   frog_record();
   ~frog_record();
   nlohmann::json to_json() const;
+  const cgn_tag& cgn() const;
+  /// the POS tag, or the joined POS tags of a MWU
+  const icu::UnicodeString& full_tag() const {
+    return mwu_tag.isEmpty() ? tag.str() : mwu_tag; };
+  /// the NER tag, or the joined NER tags of a MWU
+  const icu::UnicodeString& full_ner_tag() const {
+    return mwu_ner_tag.isEmpty() ? ner_tag.str() : mwu_ner_tag; };
+  /// the IOB tag, or the joined IOB tags of a MWU
+  const icu::UnicodeString& full_iob_tag() const {
+    return mwu_iob_tag.isEmpty() ? iob_tag.str() : mwu_iob_tag; };
   icu::UnicodeString word;          ///< the word in Unicode
   icu::UnicodeString clean_word;    ///< lowercased word (MBMA only) in Unicode
-  icu::UnicodeString token_class;   ///< the assigned token class of the word
+  symbol token_class;               ///< the assigned token class of the word
   std::string language;      ///< the detetected language of the word
   bool no_space;             ///< was there a space after the word?
   bool new_paragraph;        ///< did the tokenizer detect a paragraph here?
-  icu::UnicodeString tag;           ///< the assigned POS tag in Unicode
+  symbol tag;                       ///< the assigned POS tag in Unicode
   double tag_confidence;            ///< the confidence of the POS tag
-  icu::UnicodeString next_tag;      ///< the assigned next POS tag in Unicode
-  icu::UnicodeString iob_tag;       ///< the assigned IOB tag
+  const cgn_tag *tag_info;          ///< the parsed POS tag, set by the tagger
+  symbol next_tag;                  ///< the assigned next POS tag in Unicode
+  symbol iob_tag;                   ///< the assigned IOB tag
   double iob_confidence;     ///< the confidence of the IOB tag
-  icu::UnicodeString ner_tag;       ///< the assigned NER tag
+  symbol ner_tag;                   ///< the assigned NER tag
   double ner_confidence;     ///< the confidence of the NER tag
   std::vector<icu::UnicodeString> lemmas;  ///< a list of possible lemma's
   icu::UnicodeString morph_string;      ///< UnicodeString representation of first morph analysis
   std::vector<const BaseBracket*> morph_structure;  ///< pointers to the deep morphemes
   std::string compound_string;   ///< string representation of first compound
   int parse_index;           ///< label of the dependency
-  std::string parse_role;    ///< role of the dependency
+  symbol parse_role;         ///< role of the dependency
   std::set<size_t> parts;    ///< set of indices a MWU is made of (MWU only)
+  icu::UnicodeString mwu_tag;     ///< the joined POS tags (MWU only)
+  icu::UnicodeString mwu_ner_tag; ///< the joined NER tags (MWU only)
+  icu::UnicodeString mwu_iob_tag; ///< the joined IOB tags (MWU only)
+  /*!< The joined tags are kept out of the symbol table, which only holds
+    the closed sets of single tags
+  */
 };
 
 /// a datastructure to hold all frogged information of one Sentence
@@ -35,13 +35,16 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <future>
 #include "ticcutils/LogStream.h"
 #include "ticcutils/Configuration.h"
 #include "ticcutils/Unicode.h"
+#include "ticcutils/json.hpp"
 #include "libfolia/folia.h"
 #include "ucto/tokenize.h"
 #include "timbl/TimblAPI.h"
 #include "frog/FrogData.h"
+#include "frog/result_cache.h"
 #include "frog/ckyparser.h" // only for struct parsrel....
 
 struct parseData;
@@ -62,13 +65,18 @@ class ParserBase {
     dbgLog->add_message("parser-dbg-");
   };
   virtual ~ParserBase();
-  virtual bool init( const TiCC::Configuration& ) = 0;
+  virtual bool init( const TiCC::Configuration&,
+		     const ParserBase * =0 ) = 0;
   virtual void add_provenance( folia::Document& doc,
 			       folia::processor * ) const =0;
   virtual void Parse( frog_data&, TimerBlock& ) = 0;
+  virtual void ParseBatch( const std::vector<frog_data*>&, TimerBlock& );
   virtual void add_result( const frog_data&,
 			   const std::vector<folia::Word*>& ) const;
   std::vector<std::string> createParserInstances( const parseData& );
+  virtual std::vector<std::pair<std::string,cache_stats>> get_cache_stats() const {
+    return std::vector<std::pair<std::string,cache_stats>>();
+  };
   const std::string& getTagset() const { return dep_tagset; };
   ParserBase( const ParserBase& ) = delete;
   ParserBase& operator=( const ParserBase& ) = delete;
@@ -86,6 +94,9 @@ class ParserBase {
   std::string _port;
 };
 
+/// \brief a cache of Timbl answers, keyed on the instance
+typedef ResultCache<icu::UnicodeString,timbl_result,unicode_hash> instance_cache;
+
 /// \brief a specialization of ParserBase to run a CKY parser
 class Parser: public ParserBase {
 public:
@@ -94,19 +105,38 @@ public:
     maxDepSpan( 0 ),
     pairs(0),
     dir(0),
-    rels(0) {};
+    rels(0),
+    pairs_cache(0),
+    dir_cache(0),
+    rels_cache(0),
+    _owns_caches(false) {};
   ~Parser() override;
-  bool init( const TiCC::Configuration& ) override;
+  bool init( const TiCC::Configuration&,
+	     const ParserBase * =0 ) override;
   void add_provenance( folia::Document& doc,
 		       folia::processor * ) const override;
   parseData prepareParse( frog_data& );
   void Parse( frog_data&, TimerBlock& ) override;
+  std::vector<std::pair<std::string,cache_stats>> get_cache_stats() const override;
  private:
   std::vector<icu::UnicodeString> createPairInstances( const parseData& );
   std::vector<icu::UnicodeString> createDirInstances( const parseData& );
   std::vector<icu::UnicodeString> createRelInstances( const parseData& );
-  std::vector<timbl_result> timbl_server( const std::string&,
-					  const std::vector<icu::UnicodeString>& );
+  std::future<nlohmann::json> submit_server( const std::string&,
+					    const std::vector<icu::UnicodeString>& );
+  std::vector<timbl_result> server_results( const nlohmann::json& ) const;
+  std::vector<icu::UnicodeString> from_cache( instance_cache *,
+					      const std::vector<icu::UnicodeString>&,
+					      std::vector<timbl_result>&,
+					      std::vector<size_t>& ) const;
+  void to_cache( instance_cache *,
+		 const std::vector<icu::UnicodeString>&,
+		 const std::vector<size_t>&,
+		 const std::vector<timbl_result>&,
+		 std::vector<timbl_result>& ) const;
+  std::vector<timbl_result> cached_timbl( Timbl::TimblAPI *,
+					  instance_cache *,
+					  const std::vector<icu::UnicodeString>& ) const;
   Parser( const Parser& ) = delete; // inhibit copies
   Parser operator=( const Parser& ) = delete; // inhibit copies
   std::string maxDepSpanS;
@@ -117,6 +147,10 @@ public:
   std::string _pairs_base;
   std::string _dirs_base;
   std::string _rels_base;
+  instance_cache *pairs_cache; ///< answers of the pairs Timbl
+  instance_cache *dir_cache;   ///< answers of the dir Timbl
+  instance_cache *rels_cache;  ///< answers of the rels Timbl
+  bool _owns_caches;
 };
 
 void appendParseResult( frog_data& fd,
@@ -0,0 +1,87 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef ALPINO_POOL_H
+#define ALPINO_POOL_H
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include "ticcutils/LogStream.h"
+
+/// \brief a process wide pool of long running local Alpino processes
+/*!
+  Every Alpino child reads 'key|sentence' lines from a pipe and writes an
+  XML file per key in its own temporary directory. So Alpino is started only
+  once per child, instead of once for every sentence, and a batch of
+  sentences is handed over in one go.
+
+  The pool is started on first use, and is safe to use from several threads.
+  After a fork() the child process starts with an empty pool.
+ */
+class AlpinoPool {
+ public:
+  static AlpinoPool& instance();
+  ~AlpinoPool();
+  void configure( size_t, int, TiCC::LogStream * );
+  std::vector<std::string> parse( const std::vector<std::string>& );
+  AlpinoPool( const AlpinoPool& ) = delete;
+  AlpinoPool& operator=( const AlpinoPool& ) = delete;
+ private:
+  /// \brief the administration of 1 running Alpino
+  struct alpino_child {
+    pid_t pid;            ///< the process id
+    int to_alpino;        ///< the write end of Alpino's stdin
+    int alive;            ///< the read end of a pipe, hung up when Alpino exits
+    int watch;            ///< an inotify descriptor on out_dir, or -1
+    std::string out_dir;  ///< the directory Alpino writes its XML files in
+    size_t counter;       ///< used to create unique keys
+  };
+  AlpinoPool();
+  alpino_child *acquire();
+  void release( alpino_child * );
+  void discard( alpino_child * );
+  alpino_child *start_child() const;
+  void stop_child( alpino_child * ) const;
+  bool wait_for( alpino_child *, const std::string&, std::string& ) const;
+  std::mutex pool_lock;
+  std::condition_variable available;
+  std::vector<alpino_child*> idle;
+  size_t max_children; ///< the maximum number of Alpino processes
+  size_t running;      ///< the number of Alpino processes started
+  int timeout;         ///< seconds to wait for 1 sentence
+  pid_t owner;         ///< the process the children belong to
+  TiCC::LogStream *log;
+};
+
+#endif // ALPINO_POOL_H
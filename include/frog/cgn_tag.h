@@ -0,0 +1,61 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef CGN_TAG_H
+#define CGN_TAG_H
+
+#include <vector>
+#include "unicode/unistr.h"
+#include "frog/symbol_table.h"
+
+/// \brief a CGN POS tag, split into its head and its features
+/*!
+  A tag like N(soort,ev,basis,zijd,stan) is parsed only once into the head N
+  and the features soort, ev, basis, zijd and stan, all interned as symbols.
+  The parsed tags are kept in a process wide table, keyed on the tag symbol,
+  so every distinct tag is parsed only once and the result may be shared
+  freely between threads.
+ */
+class cgn_tag {
+ public:
+  explicit cgn_tag( const symbol& );
+  bool has_part( const symbol& ) const;
+  static const cgn_tag& get( const symbol& );
+  symbol tag;                   ///< the full tag
+  symbol head;                  ///< the head, e.g. N
+  std::vector<symbol> features; ///< the features, in order
+  icu::UnicodeString mods;      ///< the features, joined with a '|'
+ private:
+  cgn_tag( const cgn_tag& ) = delete; // inhibit copies
+  cgn_tag& operator=( const cgn_tag& ) = delete; // inhibit copies
+};
+
+#endif // CGN_TAG_H
@@ -34,13 +34,14 @@
 
 #include "frog/FrogData.h"
 #include "frog/tagger_base.h"
+#include "frog/resource_bundle.h"
 
 /// \brief a specialization of Basetagger to tag CGN tags
 class CGNTagger: public BaseTagger {
  public:
   explicit CGNTagger( TiCC::LogStream *l, TiCC::LogStream *d = 0 ):
   BaseTagger( l, d, "tagger" ){};
-  bool init( const TiCC::Configuration& ) override;
+  bool init( const TiCC::Configuration&, const BaseTagger * =0 ) override;
   void add_declaration( folia::Document&, folia::processor * ) const override;
   void post_process( frog_data& ) override;
   void add_tags( const std::vector<folia::Word*>&,
@@ -48,10 +49,14 @@ class CGNTagger: public BaseTagger {
   std::string getSubSet( const std::string& ,
 			 const std::string&,
 			 const std::string& ) const;
+  bool compile_resources( const TiCC::Configuration&,
+			  std::vector<ResourceBundle::section>& );
  private:
   void addTag( frog_record&, const icu::UnicodeString&, double );
   void fillSubSetTable();
   bool fillSubSetTable( const std::string&, const std::string& );
+  bool loadSubSetTable( const std::string&, const std::string& );
+  bool subset_files( const TiCC::Configuration& );
   std::multimap<std::string,std::string> cgnSubSets;
   std::multimap<std::string,std::string> cgnConstraints;
 };
@@ -47,6 +47,7 @@ struct parsrel;
  */
 class timbl_result {
  public:
+  timbl_result(): _confidence( 0.0 ) {};
   timbl_result( const std::string&,
 		double,
 		const Timbl::ClassDistribution& );
@@ -0,0 +1,154 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef EVENT_SERVER_H
+#define EVENT_SERVER_H
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <sys/types.h>
+#include "ticcutils/LogStream.h"
+
+/// \brief the ways a request can be delimited on a connection
+enum class Framing {
+  LINE,        ///< every line is a request
+  EMPTY_LINE,  ///< a request runs up to (and including) an empty line
+  EOT          ///< a request runs up to a line holding just 'EOT'
+};
+
+/// \brief the limits an EventServer enforces
+struct server_limits {
+  size_t max_connections = 0;  ///< max number of open connections. 0 is no limit
+  size_t max_request_size = 0; ///< max size of 1 request in bytes. 0 is no limit
+  size_t max_requests = 0;     ///< max requests queued or analyzed. 0 is no limit
+  std::string busy_reply;      ///< sent to clients when we are full
+  std::string too_large_reply; ///< sent when a request exceeds the maximum
+};
+
+/// \brief a complete request, waiting for an analysis worker
+struct queued_request {
+  std::string text;      ///< the request, or the reply when refused
+  bool refused = false;  ///< answered 'busy' without analyzing it?
+};
+
+/// \brief the state of 1 client connection of an EventServer
+struct connection_state {
+  std::string in_buf;    ///< received bytes, not yet split into lines
+  std::string request;   ///< the lines of the current request so far
+  std::string out_buf;   ///< reply bytes not yet written
+  std::deque<queued_request> pending; ///< complete requests, not yet handed out
+  std::string last_reply; ///< sent after the request in flight is answered
+  uint64_t serial = 0;   ///< tells connections on a reused descriptor apart
+  bool in_flight = false; ///< is a worker busy with one of our requests?
+  bool input_done = false; ///< don't read anymore: EOF or refused
+  uint32_t events = 0;   ///< the epoll events we are waiting for
+};
+
+/// \brief an analysis process of an EventServer
+struct analysis_worker {
+  pid_t pid = -1;        ///< the process
+  int fd = -1;           ///< our end of the channel to the process
+  std::string in_buf;    ///< reply bytes received so far
+  std::string out_buf;   ///< request bytes not yet written
+  int conn_fd = -1;      ///< the connection we work for. -1 when idle
+  uint64_t conn_serial = 0; ///< the serial of that connection
+  bool want_write = false; ///< are we waiting for the channel to drain?
+};
+
+/// \brief an epoll based loop, serving many connections at the same time
+/*!
+  Connections are accepted, read and written without blocking, in one
+  process. Complete requests, framed according to a Framing, are put on a
+  queue. A pool of analysis processes, forked from the loop, takes requests
+  from that queue, calls the request handler, and sends the replies back to
+  the loop. So a long request never holds up the other connections, and any
+  free analysis process serves any connection.
+
+  Requests of one connection are handled one at a time, so the replies keep
+  the order of the requests.
+*/
+class EventServer {
+ public:
+  /// the handler gets a request and fills the reply. When it returns false,
+  /// the connection is closed after sending the reply
+  using request_handler = std::function<bool( const std::string&,
+					      std::string& )>;
+  EventServer( int,
+	       Framing,
+	       const request_handler&,
+	       size_t,
+	       TiCC::LogStream *,
+	       const server_limits& = server_limits() );
+  ~EventServer();
+  void run( const bool& );
+  EventServer( const EventServer& ) = delete;
+  EventServer& operator=( const EventServer& ) = delete;
+ private:
+  void accept_connections();
+  void handle_input( int );
+  void handle_lines( int, connection_state& );
+  void queue_request( int, connection_state&, const std::string& );
+  void dispatch();
+  void drop_pending( connection_state& );
+  bool start_worker( analysis_worker& );
+  void stop_workers();
+  void serve_requests( int );
+  void handle_worker( analysis_worker&, uint32_t );
+  void handle_reply( analysis_worker&, bool, const std::string& );
+  void worker_failed( analysis_worker& );
+  void flush( int );
+  void flush_worker( analysis_worker& );
+  void update_events( int );
+  bool watch( int, uint32_t, bool );
+  void close_connection( int );
+  void refuse( int, const std::string& ) const;
+  bool too_large( const connection_state& ) const;
+  int listen_fd;
+  int epoll_fd;
+  Framing framing;
+  request_handler handler;
+  size_t num_workers;
+  server_limits limits;
+  const bool *running;
+  uint64_t next_serial;
+  size_t num_requests; ///< the requests queued or being analyzed
+  std::map<int,connection_state> connections;
+  std::vector<analysis_worker> workers;
+  std::map<int,size_t> worker_index; ///< channel descriptor to worker
+  std::deque<std::pair<int,uint64_t>> ready; ///< connections with work
+  TiCC::LogStream *errLog;
+};
+
+#endif // EVENT_SERVER_H
@@ -39,13 +39,14 @@ class IOBTagger: public BaseTagger {
  public:
   explicit IOBTagger( TiCC::LogStream *l, TiCC::LogStream *d =0 ):
   BaseTagger( l, d, "IOB" ){};
-  bool init( const TiCC::Configuration& ) override;
+  bool init( const TiCC::Configuration&, const BaseTagger * =0 ) override;
   void add_declaration( folia::Document&, folia::processor * ) const override;
-  void Classify( frog_data& ) override;
   void post_process( frog_data& ) override;
   void add_result( const frog_data& fd,
 		   const std::vector<folia::Word*>& wv ) const;
  private:
+  std::vector<tag_entry> extract_sentence( const frog_data& ) override;
+  void finish_sentence( frog_data& ) override;
   void addTag( frog_record&,
 	       const icu::UnicodeString&,
 	       double );
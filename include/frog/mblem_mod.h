@@ -38,6 +38,10 @@
 #include "ticcutils/Unicode.h"
 #include "timbl/TimblAPI.h"
 #include "frog/FrogData.h"
+#include "frog/result_cache.h"
+#include "frog/suffix_table.h"
+#include "frog/persistent_cache.h"
+#include "frog/resource_bundle.h"
 
 /// \brief Helper class for Mblem. A datastructure to hold lemma/tag information
 class mblemData {
@@ -57,26 +61,45 @@ class Mblem {
  public:
   explicit Mblem( TiCC::LogStream *, TiCC::LogStream * =0 );
   ~Mblem();
-  bool init( const TiCC::Configuration& );
+  bool init( const TiCC::Configuration&, const Mblem * =0 );
   void add_provenance( folia::Document&, folia::processor * ) const;
   void Classify( frog_record& );
+  void Classify( const std::vector<frog_record*>& );
   void Classify( const icu::UnicodeString& );
   std::vector<std::pair<icu::UnicodeString,icu::UnicodeString> > getResult() const;
   const std::string& getTagset() const { return tagset; };
   const std::string& version() const { return _version; };
-  void filterTag( const icu::UnicodeString& );
+  bool is_remote() const { return !_host.empty(); };
+  void filterTag( const cgn_tag& );
   void makeUnique();
   void add_lemmas( const std::vector<folia::Word*>&,
 		   const frog_data& ) const;
+  cache_stats get_cache_stats() const;
+  size_t disk_cache_written() const;
+  bool compile_suffix_table( const std::set<icu::UnicodeString>&,
+			     const std::string& );
+  void prewarm( const icu::UnicodeString& );
+  bool compile_resources( const TiCC::Configuration&,
+			  std::vector<ResourceBundle::section>& );
+  /// use the precompiled tables in \e b, when up to date. (call before init)
+  void set_bundle( const ResourceBundle *b ){ _bundle = b; };
  private:
+  icu::UnicodeString get_class( const icu::UnicodeString& );
+  bool known_class( const icu::UnicodeString&, icu::UnicodeString& ) const;
+  icu::UnicodeString cache_key( const frog_record& ) const;
   icu::UnicodeString call_server( const icu::UnicodeString& );
+  std::vector<icu::UnicodeString> call_server( const std::vector<icu::UnicodeString>& );
+  bool fixed_lemma( const frog_record&, icu::UnicodeString& ) const;
   void read_transtable( const std::string& );
   void create_MBlem_defaults();
   bool readsettings( const std::string& dir, const std::string& fname );
   bool fill_ts_map( const std::string& );
+  bool load_ts_map( const std::string& );
   bool fill_eq_set( const std::string& );
   icu::UnicodeString make_instance( const icu::UnicodeString& in );
+  uint64_t table_stamp() const;
   Timbl::TimblAPI *myLex;
+  std::string tree_name;
   std::string punctuation;
   size_t history;
   int debug;
@@ -84,6 +107,7 @@ class Mblem {
   std::map<icu::UnicodeString, std::map<icu::UnicodeString, int>> token_strip_map;
   std::set<icu::UnicodeString> one_one_tags;
   std::vector<mblemData> mblemResult;
+  std::map<icu::UnicodeString,icu::UnicodeString> server_classes; ///< server answers for the current batch
   std::string _version;
   std::string tagset;
   std::string POS_tagset;
@@ -94,6 +118,15 @@ class Mblem {
   TiCC::LogStream *errLog;
   TiCC::LogStream *dbgLog;
   TiCC::UniFilter *filter;
+  ResultCache<icu::UnicodeString,
+	      std::vector<icu::UnicodeString>,
+	      unicode_hash> *_cache; ///< finished lemmas, shared between sessions
+  bool _owns_cache;
+  SuffixTable *_table; ///< precompiled classes, shared between sessions
+  bool _owns_table;
+  PersistentCache *_disk_cache; ///< classes kept over runs, shared between sessions
+  bool _owns_disk_cache;
+  const ResourceBundle *_bundle; ///< the precompiled resources, if any
   Mblem( const Mblem& ) = delete;
   Mblem& operator=( const Mblem& ) = delete;
 };
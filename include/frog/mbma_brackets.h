@@ -89,7 +89,15 @@ class BaseBracket {
     debugFlag(flag),
     myLog(l)
     {};
+ BaseBracket( const BaseBracket& other, TiCC::LogStream& l ):
+  RightHand(other.RightHand),
+    cls(other.cls),
+    _status( other._status ),
+    debugFlag(other.debugFlag),
+    myLog(l)
+    {};
   virtual ~BaseBracket() {};
+  virtual BaseBracket *clone( TiCC::LogStream& ) const = 0;
   Status status() const { return _status; };
   void set_status( const Status s ) { _status = s; };
   virtual icu::UnicodeString morpheme() const { return "";};
@@ -129,7 +137,12 @@ class BracketLeaf: public BaseBracket {
 public:
   BracketLeaf( const RulePart&, int, TiCC::LogStream& );
   BracketLeaf( CLEX::Type, const icu::UnicodeString&, int, TiCC::LogStream& );
+  BracketLeaf( const BracketLeaf&, TiCC::LogStream& );
   ~BracketLeaf() override;
+  BaseBracket *clone( TiCC::LogStream& l ) const override {
+    /// return a deep copy, using LogStream \e l
+    return new BracketLeaf( *this, l );
+  };
   icu::UnicodeString put( bool = false ) const override;
   icu::UnicodeString morpheme() const override {
     /// return the value of the morpheme
@@ -171,8 +184,13 @@ private:
 class BracketNest: public BaseBracket {
  public:
   BracketNest( CLEX::Type, Compound::Type, int, TiCC::LogStream& );
+  BracketNest( const BracketNest&, TiCC::LogStream& );
   BaseBracket *append( BaseBracket * ) override ;
   ~BracketNest() override;
+  BaseBracket *clone( TiCC::LogStream& l ) const override {
+    /// return a deep copy, using LogStream \e l
+    return new BracketNest( *this, l );
+  };
   bool isNested() const override { return true; };
   icu::UnicodeString put( bool = false ) const override;
   bool testMatch( const std::list<BaseBracket*>& result,
@@ -35,6 +35,7 @@
 #include <map>
 #include <vector>
 #include <list>
+#include <memory>
 #include "unicode/unistr.h"
 #include <unicode/translit.h>
 #include "ticcutils/LogStream.h"
@@ -45,24 +46,36 @@
 #include "frog/clex.h"
 #include "frog/mbma_rule.h"
 #include "frog/mbma_brackets.h"
+#include "frog/result_cache.h"
+#include "frog/persistent_cache.h"
+#include "frog/resource_bundle.h"
 
 class MBMAana;
 namespace Timbl{
   class TimblAPI;
 }
 
+/// \brief the finished MBMA results of 1 word, as kept in the result cache
+struct mbma_result {
+  icu::UnicodeString clean_word;
+  icu::UnicodeString morph_string;
+  std::string compound_string;
+  std::vector<std::shared_ptr<const BaseBracket>> morph_structure;
+};
+
 /// \brief provide all functionality to run a Timbl for Morphological Analyzis
 class Mbma {
  public:
   explicit Mbma( TiCC::LogStream *, TiCC::LogStream * =0 );
   ~Mbma();
-  bool init( const TiCC::Configuration& );
+  bool init( const TiCC::Configuration&, const Mbma * =0 );
   void add_provenance( folia::Document&, folia::processor * ) const;
   void Classify( frog_record& );
+  void Classify( const std::vector<frog_record*>& );
   void Classify( const icu::UnicodeString&,
 		 const icu::UnicodeString& );
   void filterHeadTag( const icu::UnicodeString& );
-  void filterSubTags( const std::vector<icu::UnicodeString>& );
+  void filterSubTags( const std::vector<symbol>& );
   void assign_compounds();
   std::vector<std::pair<icu::UnicodeString,std::string>> getResults( bool=false ) const;
   void setDeepMorph( bool b ){ doDeepMorph = b; };
@@ -74,8 +87,17 @@ class Mbma {
 			      const icu::UnicodeString&,
 			      const std::vector<icu::UnicodeString>& );
   const std::string& version() const { return _version; };
+  bool is_remote() const { return !_host.empty(); };
   void add_folia_morphemes( const std::vector<folia::Word*>&,
 			    const frog_data& fd ) const;
+  cache_stats get_cache_stats() const;
+  size_t disk_cache_written() const;
+  cache_stats get_window_cache_stats() const;
+  void prewarm( const icu::UnicodeString& );
+  bool compile_resources( const TiCC::Configuration&,
+			  std::vector<ResourceBundle::section>& );
+  /// use the precompiled tables in \e b, when up to date. (call before init)
+  void set_bundle( const ResourceBundle *b ){ _bundle = b; };
   static std::map<icu::UnicodeString,icu::UnicodeString> TAGconv;
   static std::string mbma_tagset;
   static std::string pos_tagset;
@@ -87,12 +109,20 @@ class Mbma {
   bool readsettings( const std::string&, const std::string& );
   void fillMaps();
   void init_cgn( const std::string&, const std::string& );
+  bool load_cgn( const std::string&, const std::string& );
   void storeResult( frog_record&,
 		    const icu::UnicodeString&,
 		    const icu::UnicodeString& ) const;
   std::vector<icu::UnicodeString> make_instances( const icu::UnicodeString& word );
+  icu::UnicodeString classify_window( const icu::UnicodeString& );
+  std::vector<icu::UnicodeString> get_classes( const icu::UnicodeString& );
+  bool known_classes( const icu::UnicodeString&,
+		      std::vector<icu::UnicodeString>& ) const;
   void call_server( const std::vector<icu::UnicodeString>&,
 		    std::vector<icu::UnicodeString>& );
+  bool as_is( const frog_record&, icu::UnicodeString& ) const;
+  void analyze( frog_record& );
+  icu::UnicodeString cache_key( const frog_record& ) const;
   CLEX::Type getFinalTag( const std::list<BaseBracket*>& );
   void store_morphemes( frog_record&,
 			const std::vector<icu::UnicodeString>& ) const;
@@ -109,6 +139,7 @@ class Mbma {
   std::string MTreeFilename;
   Timbl::TimblAPI *MTree;
   std::vector<Rule*> analysis;
+  std::map<icu::UnicodeString,std::vector<icu::UnicodeString>> server_classes; ///< server answers for the current batch
   std::string _version;
   std::string textclass;
   TiCC::LogStream *errLog;
@@ -120,6 +151,17 @@ class Mbma {
   int debugFlag;
   bool filter_diac;
   bool doDeepMorph;
+  ResultCache<icu::UnicodeString,
+	      mbma_result,
+	      unicode_hash> *_cache; ///< finished analyses, shared between sessions
+  bool _owns_cache;
+  ResultCache<icu::UnicodeString,
+	      icu::UnicodeString,
+	      unicode_hash> *_window_cache; ///< classes per character window, shared between sessions
+  bool _owns_window_cache;
+  PersistentCache *_disk_cache; ///< classes kept over runs, shared between sessions
+  bool _owns_disk_cache;
+  const ResourceBundle *_bundle; ///< the precompiled resources, if any
 };
 
 icu::UnicodeString flatten( const icu::UnicodeString& in );
@@ -34,11 +34,15 @@
 
 #include <ostream>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include "ticcutils/LogStream.h"
 #include "ticcutils/Configuration.h"
 #include "ticcutils/Unicode.h"
 #include "libfolia/folia.h"
 #include "frog/FrogData.h"
+#include "frog/result_cache.h"
+#include "frog/resource_bundle.h"
 
 /// \brief a helper class for Mwu. Stores needed information.
 class mwuAna {
@@ -47,13 +51,11 @@ public:
   mwuAna( const icu::UnicodeString&, bool, size_t );
   virtual ~mwuAna() {};
 
-  void merge( const mwuAna * );
-
   icu::UnicodeString getWord() const {
     return word;
   }
 
-  bool isSpec(){ return spec; };
+  bool isSpec() const { return spec; };
 
   size_t mwu_start;
   size_t mwu_end;
@@ -64,7 +66,48 @@ protected:
   bool spec;
 };
 
-#define mymap2 std::multimap<icu::UnicodeString, std::vector<icu::UnicodeString> >
+/// \brief a token level trie holding all known MWU's
+/*!
+  Every path from the root is a sequence of words, and nodes where a known
+  MWU ends are marked. Finding the longest MWU that starts at some position
+  is a single walk down the trie. Once filled, the trie is only read, so it
+  is shared between all Mwu instances of a Frog.
+
+  compile() stores the trie as a few sorted arrays, which load() can use
+  in place, e.g. from a mapped ResourceBundle. The trie is then searched
+  binary, and no MWU's can be added.
+ */
+class mwu_trie {
+ public:
+  mwu_trie();
+  void add( const std::vector<icu::UnicodeString>& );
+  size_t longest_match( const icu::UnicodeString&,
+			const std::vector<mwuAna*>&,
+			size_t ) const;
+  bool has_start( const icu::UnicodeString& ) const;
+  size_t size() const { return _entries; };
+  std::string compile() const;
+  bool load( const char *, size_t );
+ private:
+  /// one node in the trie
+  struct node {
+    node(): final( false ) {};
+    std::unordered_map<icu::UnicodeString,size_t,unicode_hash> next; ///< the children
+    bool final; ///< does an MWU end here?
+  };
+  size_t step( size_t, const icu::UnicodeString& ) const;
+  bool is_final( size_t ) const;
+  std::vector<node> _nodes;  ///< all nodes, the root first
+  size_t _entries;           ///< the number of MWU's added
+  const char *_compiled;     ///< when set, the compiled trie we use
+  size_t _words;             ///< compiled: the number of words
+  size_t _edge_count;        ///< compiled: the number of edges
+  const uint64_t *_word_index; ///< compiled: start of every word in the pool
+  const UChar *_word_pool;   ///< compiled: the sorted words
+  const uint64_t *_edge_keys; ///< compiled: the sorted (node,word) keys
+  const uint32_t *_edge_next; ///< compiled: the node for every key
+  const uint8_t *_final;     ///< compiled: does an MWU end in a node?
+};
 
 /// \brief provide all functionality to detect MWU's
 class Mwu {
@@ -73,7 +116,7 @@ public:
   explicit Mwu( TiCC::LogStream*, TiCC::LogStream* );
   ~Mwu();
   void reset();
-  bool init( const TiCC::Configuration& );
+  bool init( const TiCC::Configuration&, const Mwu * =0 );
   void add_provenance( folia::Document&, folia::processor * ) const;
   void Classify( frog_data& );
   void add( const frog_record& );
@@ -82,14 +125,23 @@ public:
   /// return the value for \e mwu_tagset. (set via Configuration)
   const std::string& getTagset() const { return mwu_tagset; };
   const std::string& version() const { return _version; };
+  bool compile_resources( const TiCC::Configuration&,
+			  std::vector<ResourceBundle::section>& );
+  /// use the precompiled MWU's in \e b, when up to date. (call before init)
+  void set_bundle( const ResourceBundle *b ){ _bundle = b; };
 private:
   bool readsettings( const std::string&, const std::string&);
   bool read_mwus( const std::string& );
+  bool load_mwus();
+  bool fill_mwus( const std::vector<icu::UnicodeString>& );
+  bool read_lines( const std::string&, std::vector<icu::UnicodeString>& );
   void Classify();
   int debug;
   std::string mwuFileName;
   std::vector<mwuAna*> mWords;
-  mymap2 MWUs;
+  mwu_trie *_trie;     ///< the known MWU's, shared with the model
+  bool _owns_trie;     ///< did we create _trie?
+  const ResourceBundle *_bundle; ///< the precompiled resources, if any
   TiCC::LogStream *errLog;
   TiCC::LogStream *dbgLog;
   std::string _version;
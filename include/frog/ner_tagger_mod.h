@@ -32,21 +32,70 @@
 #ifndef NER_TAGGER_MOD_H
 #define NER_TAGGER_MOD_H
 
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
+#include <map>
 #include "ticcutils/LogStream.h"
 #include "ticcutils/Configuration.h"
 #include "libfolia/folia.h"
 #include "frog/tagger_base.h"
+#include "frog/result_cache.h"
+#include "frog/resource_bundle.h"
 
 using tc_pair = std::pair<icu::UnicodeString,double>;
 
+/// \brief a token trie holding the Named Entities of a set of gazeteers
+/*!
+  The words of the NE's are numbered, and the trie is stored as one hash
+  table from (node, word number) to the next node. Every node carries the
+  set of categories of the NE's ending there, as a bitset.
+
+  match() finds all known NE's of all lengths in a sentence in one pass,
+  giving the union of the categories of the NE's covering each word.
+
+  compile() stores the trie as a few sorted arrays, which load() can use
+  in place, e.g. from a mapped ResourceBundle. The trie is then searched
+  binary, and no NE's can be added.
+ */
+class ner_gazetteer {
+ public:
+  typedef uint64_t category_set; ///< a bit for every category
+  ner_gazetteer();
+  bool add( const std::vector<icu::UnicodeString>&, const std::string& );
+  std::vector<category_set> match( const std::vector<icu::UnicodeString>&,
+				   size_t ) const;
+  icu::UnicodeString serialize( category_set ) const;
+  size_t size() const { return _entries; };
+  std::string compile() const;
+  bool load( const char *, size_t );
+ private:
+  bool word_number( const icu::UnicodeString&, uint32_t& ) const;
+  bool next_node( uint32_t, uint32_t, uint32_t& ) const;
+  category_set categories( uint32_t ) const;
+  std::unordered_map<icu::UnicodeString,uint32_t,unicode_hash> _vocab; ///< word numbers
+  std::unordered_map<uint64_t,uint32_t> _edges;   ///< (node,word) to node
+  std::vector<category_set> _node_cats;     ///< the categories per node
+  std::map<std::string,size_t> _categories; ///< the bit of every category
+  size_t _entries;                          ///< the number of NE's added
+  const char *_compiled;          ///< when set, the compiled trie we use
+  size_t _words;                  ///< compiled: the number of words
+  size_t _edge_count;             ///< compiled: the number of edges
+  size_t _nodes;                  ///< compiled: the number of nodes
+  const uint64_t *_word_index;    ///< compiled: start of every word in the pool
+  const UChar *_word_pool;        ///< compiled: the sorted words
+  const uint64_t *_edge_keys;     ///< compiled: the sorted (node,word) keys
+  const uint32_t *_edge_next;     ///< compiled: the node for every key
+  const category_set *_compiled_cats; ///< compiled: the categories per node
+};
+
 /// \brief a specialization of Basetagger to tag Named Entities
 class NERTagger: public BaseTagger {
  public:
   explicit NERTagger( TiCC::LogStream *, TiCC::LogStream * =0 );
-  bool init( const TiCC::Configuration& ) override;
-  void Classify( frog_data& ) override;
+  bool init( const TiCC::Configuration&, const BaseTagger * =0 ) override;
+  using BaseTagger::Classify;
+  void Classify( const std::vector<frog_data*>& ) override;
   void post_process( frog_data& ) override;
   void post_process( frog_data&,
 		     const std::vector<tc_pair>& );
@@ -60,29 +109,49 @@ class NERTagger: public BaseTagger {
     return read_gazets( f, p, override_ners );
   }
   std::vector<icu::UnicodeString> create_ner_list( const std::vector<icu::UnicodeString>& s ){
-    return create_ner_list( s, gazet_ners );
+    return create_ner_list( s, known_ners() );
   }
   std::vector<icu::UnicodeString> create_override_list( const std::vector<icu::UnicodeString>& s ){
-    return create_ner_list( s, override_ners );
+    return create_ner_list( s, known_overrides() );
   }
   bool Generate( const std::string& );
+  bool compile_resources( const TiCC::Configuration&,
+			  std::vector<ResourceBundle::section>& );
   void merge_override( std::vector<tc_pair>&,
 		       const std::vector<tc_pair>&,
 		       bool,
 		       const std::vector<icu::UnicodeString>& ) const;
 
  private:
+  std::vector<tag_entry> extract_sentence( const frog_data& ) override;
+  void finish_sentence( frog_data& ) override;
+  void classify_gazets( frog_data& );
+  void sentence_words( const frog_data&,
+		       std::vector<icu::UnicodeString>&,
+		       std::vector<icu::UnicodeString>& ) const;
   bool read_gazets( const std::string&,
 		    const std::string&,
-		    std::vector<std::map<icu::UnicodeString,std::set<std::string>>>& );
+		    ner_gazetteer& );
   bool fill_ners( const std::string&,
 		  const std::string&,
 		  const std::string&,
-		  std::vector<std::map<icu::UnicodeString,std::set<std::string>>>& );
+		  ner_gazetteer& );
+  bool load_gazets( const std::string&,
+		    const std::string&,
+		    const std::string&,
+		    ner_gazetteer& );
+  uint64_t gazets_stamp( const std::string&, const std::string& ) const;
   std::vector<icu::UnicodeString> create_ner_list( const std::vector<icu::UnicodeString>&,
-						   const std::vector<std::map<icu::UnicodeString,std::set<std::string>>>& );
-  std::vector<std::map<icu::UnicodeString,std::set<std::string>>> gazet_ners;
-  std::vector<std::map<icu::UnicodeString,std::set<std::string>>> override_ners;
+						   const ner_gazetteer& );
+  const ner_gazetteer& known_ners() const {
+    return _ner_model ? _ner_model->gazet_ners : gazet_ners;
+  }
+  const ner_gazetteer& known_overrides() const {
+    return _ner_model ? _ner_model->override_ners : override_ners;
+  }
+  ner_gazetteer gazet_ners;
+  ner_gazetteer override_ners;
+  const NERTagger *_ner_model; ///< when set, we use the gazeteers of this one
   void addEntity( frog_data&,
 		  size_t,
 		  const std::vector<tc_pair>& );
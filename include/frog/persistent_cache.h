@@ -0,0 +1,95 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef PERSISTENT_CACHE_H
+#define PERSISTENT_CACHE_H
+
+#include <cstdint>
+#include <sys/types.h>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include "ticcutils/LogStream.h"
+
+/// \brief a key/value store in a file, kept over runs and shared by processes
+/*!
+  The file starts with a header holding a stamp of the model and the
+  settings that produced the values. A file with another stamp is stale and
+  is started anew.
+
+  Existing records are read from a read-only shared mapping of the file, so
+  processes on the same machine share them through the page cache. New
+  records are appended under an advisory lock. Records appended by other
+  processes become visible on the next open().
+
+  A forked child opens the file again before its first append, so the lock
+  also excludes its siblings. When another process replaced the file, we
+  append to the new one. The records kept in memory have a maximum number.
+  Beyond that, new records are still appended to the file, until the file
+  reaches its maximum size.
+ */
+class PersistentCache {
+ public:
+  explicit PersistentCache( TiCC::LogStream *,
+			    size_t = 100000,
+			    size_t = 256*1024*1024 );
+  ~PersistentCache();
+  bool open( const std::string&, uint64_t );
+  bool lookup( const std::string&, std::string& ) const;
+  bool store( const std::string&, const std::string& );
+  size_t size() const;
+  size_t written() const;
+  PersistentCache( const PersistentCache& ) = delete;
+  PersistentCache& operator=( const PersistentCache& ) = delete;
+ private:
+  void close();
+  bool reset( uint64_t, size_t );
+  size_t scan();
+  bool reopen();
+  bool follow_file();
+  int _fd;                 ///< the opened file, -1 when closed
+  pid_t _owner;            ///< the process that opened _fd
+  uint64_t _stamp;         ///< the stamp given to open()
+  bool _writable;          ///< false when the file could only be opened read-only
+  const char *_map;        ///< the mapping of the records found at open()
+  size_t _map_size;        ///< the size of that mapping
+  std::unordered_multimap<uint64_t,size_t> _index; ///< key hash to record offset
+  std::unordered_map<std::string,std::string> _added; ///< records added since open()
+  size_t _max_added;       ///< the maximum size of _added
+  size_t _max_file_size;   ///< don't let the file grow beyond this
+  bool _full;              ///< did we already tell _added is full?
+  size_t _written;         ///< the number of records we appended
+  mutable std::mutex _lock; ///< protects _added and the appending
+  std::string _name;
+  TiCC::LogStream *errLog;
+};
+
+#endif // PERSISTENT_CACHE_H
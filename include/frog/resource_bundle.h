@@ -0,0 +1,81 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef RESOURCE_BUNDLE_H
+#define RESOURCE_BUNDLE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "unicode/unistr.h"
+#include "ticcutils/LogStream.h"
+
+/// \brief a memory mapped file with precompiled resources for the modules
+/*!
+  A bundle holds named sections of binary data, made by
+  frog-compile-resources. Every section carries a stamp of the source files
+  and settings it was compiled from, so a module only uses a section that
+  is still valid, and reads its text files otherwise.
+
+  The sections are used straight from the mapping, so the data is shared
+  between processes through the page cache, and nothing is parsed at startup.
+  A Frog opens its bundle once, and hands it to the modules with their
+  set_bundle() before calling init().
+ */
+class ResourceBundle {
+ public:
+  /// \brief a section to write
+  struct section {
+    std::string name;  ///< the name, e.g. 'ner:known_ners'
+    uint64_t stamp;    ///< the stamp of the sources
+    std::string data;  ///< the contents
+  };
+  explicit ResourceBundle( TiCC::LogStream * );
+  ~ResourceBundle();
+  bool open( const std::string& );
+  bool find( const std::string&, uint64_t, const char*&, size_t& ) const;
+  static bool write( const std::string&, const std::vector<section>& );
+  static std::string encode_lines( const std::vector<icu::UnicodeString>& );
+  static bool decode_lines( const char *, size_t,
+			    std::vector<icu::UnicodeString>& );
+  ResourceBundle( const ResourceBundle& ) = delete;
+  ResourceBundle& operator=( const ResourceBundle& ) = delete;
+ private:
+  void close();
+  const char *_map;        ///< the mapped file
+  size_t _map_size;        ///< the size of the mapping
+  size_t _sections;        ///< the number of sections
+  const char *_directory;  ///< the section directory
+  std::string _name;
+  TiCC::LogStream *errLog;
+};
+
+#endif // RESOURCE_BUNDLE_H
@@ -0,0 +1,194 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <cstddef>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <ostream>
+#include "ticcutils/Unicode.h"
+
+/// \brief the counters of a ResultCache
+struct cache_stats {
+  size_t hits = 0;       ///< lookups that found an entry
+  size_t misses = 0;     ///< lookups that didn't
+  size_t evictions = 0;  ///< entries removed to make room
+  size_t entries = 0;    ///< entries in the cache now
+  size_t cost = 0;       ///< the summed cost of the entries
+  double hit_ratio() const {
+    /// return the fraction of lookups that were hits
+    size_t total = hits + misses;
+    return total == 0 ? 0.0 : double(hits) / total;
+  };
+};
+
+inline std::ostream& operator<<( std::ostream& os, const cache_stats& cs ){
+  os << "hits=" << cs.hits << " misses=" << cs.misses
+     << " evictions=" << cs.evictions << " entries=" << cs.entries
+     << " (hit ratio " << 100*cs.hit_ratio() << "%)";
+  return os;
+}
+
+/// \brief hash function to use UnicodeString keys
+struct unicode_hash {
+  size_t operator()( const icu::UnicodeString& us ) const {
+    return us.hashCode();
+  }
+};
+
+/// \brief a bounded, thread-safe LRU cache for the results of a module
+/*!
+  The cache is split in shards, each with its own lock and its own LRU list,
+  so threads working on different keys seldom wait for each other. Every
+  entry has a cost, 1 by default, and every shard holds entries up to a total
+  cost of capacity/shards. When a shard is full, its least recently used
+  entries are evicted. With a cost in bytes, the capacity is a memory bound.
+
+  The key must hold ALL inputs the cached result depends on. Values are
+  copied in and out, so they should be cheap to copy.
+ */
+template <class Key, class Value, class Hash = std::hash<Key>>
+class ResultCache {
+ public:
+  explicit ResultCache( size_t capacity, size_t num_shards = 16 ):
+    shards( std::max<size_t>( 1, num_shards ) ),
+    shard_capacity( std::max<size_t>( 1, capacity / shards.size() ) ),
+    hits( 0 ),
+    misses( 0 ),
+    evictions( 0 )
+  {};
+  bool lookup( const Key& key, Value& value ){
+    /// look up \e key
+    /*!
+      \param key the key to search
+      \param value the cached value, when found
+      \return true when found
+    */
+    shard& sh = get_shard( key );
+    std::lock_guard<std::mutex> guard( sh.lock );
+    auto it = sh.index.find( key );
+    if ( it == sh.index.end() ){
+      ++misses;
+      return false;
+    }
+    // move to the front: most recently used
+    sh.lru.splice( sh.lru.begin(), sh.lru, it->second );
+    value = it->second->value;
+    ++hits;
+    return true;
+  };
+  bool contains( const Key& key ) const {
+    /// check if \e key is cached, without counting it as a lookup
+    const shard& sh = get_shard( key );
+    std::lock_guard<std::mutex> guard( sh.lock );
+    return sh.index.find( key ) != sh.index.end();
+  };
+  void store( const Key& key, const Value& value, size_t cost = 1 ){
+    /// add or replace the value for \e key
+    /*!
+      \param key the key
+      \param value the value to store
+      \param cost the cost of the entry. An entry that costs more than a shard
+      can hold is not stored
+    */
+    if ( cost > shard_capacity ){
+      return;
+    }
+    shard& sh = get_shard( key );
+    std::lock_guard<std::mutex> guard( sh.lock );
+    auto it = sh.index.find( key );
+    if ( it != sh.index.end() ){
+      sh.used -= it->second->cost;
+      sh.lru.erase( it->second );
+      sh.index.erase( it );
+    }
+    while ( !sh.lru.empty() && sh.used + cost > shard_capacity ){
+      sh.used -= sh.lru.back().cost;
+      sh.index.erase( sh.lru.back().key );
+      sh.lru.pop_back();
+      ++evictions;
+    }
+    sh.lru.push_front( entry{ key, value, cost } );
+    sh.index[key] = sh.lru.begin();
+    sh.used += cost;
+  };
+  cache_stats stats() const {
+    /// return the current counters
+    cache_stats result;
+    result.hits = hits;
+    result.misses = misses;
+    result.evictions = evictions;
+    for ( auto& sh : shards ){
+      std::lock_guard<std::mutex> guard( sh.lock );
+      result.entries += sh.index.size();
+      result.cost += sh.used;
+    }
+    return result;
+  };
+  ResultCache( const ResultCache& ) = delete;
+  ResultCache& operator=( const ResultCache& ) = delete;
+ private:
+  /// \brief one cached value
+  struct entry {
+    Key key;
+    Value value;
+    size_t cost;
+  };
+  /// \brief one independently locked part of the cache
+  struct shard {
+    mutable std::mutex lock;
+    std::list<entry> lru; ///< most recently used first
+    std::unordered_map<Key,
+		       typename std::list<entry>::iterator,
+		       Hash> index;
+    size_t used = 0;      ///< the summed cost of the entries
+  };
+  shard& get_shard( const Key& key ){
+    return shards[Hash()( key ) % shards.size()];
+  };
+  const shard& get_shard( const Key& key ) const {
+    return shards[Hash()( key ) % shards.size()];
+  };
+  std::vector<shard> shards;
+  size_t shard_capacity;
+  std::atomic<size_t> hits;
+  std::atomic<size_t> misses;
+  std::atomic<size_t> evictions;
+};
+
+#endif // RESULT_CACHE_H
@@ -0,0 +1,87 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef SERVER_POOL_H
+#define SERVER_POOL_H
+
+#include <sys/types.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <future>
+#include "ticcutils/LogStream.h"
+#include "ticcutils/SocketBasics.h"
+#include "ticcutils/json.hpp"
+
+/// \brief a process wide pool of open connections to Timbl and MBT servers
+/*!
+  Connections are kept per host, port and base. The greeting and the 'base'
+  command are only handled when a connection is opened. After that the
+  connection is reused for every query, until it fails. A failing pooled
+  connection is replaced by a fresh one transparently.
+
+  All modules using a remote classifier share this pool, and it is safe to use
+  from several threads. After a fork() the child starts with an empty pool.
+  With submit() a query runs in the background, so independent queries can
+  overlap.
+ */
+class ServerPool {
+ public:
+  static ServerPool& instance();
+  ~ServerPool();
+  nlohmann::json query( const std::string&,
+			const std::string&,
+			const std::string&,
+			const nlohmann::json&,
+			TiCC::LogStream * );
+  std::future<nlohmann::json> submit( const std::string&,
+				      const std::string&,
+				      const std::string&,
+				      const nlohmann::json&,
+				      TiCC::LogStream * );
+  ServerPool( const ServerPool& ) = delete;
+  ServerPool& operator=( const ServerPool& ) = delete;
+ private:
+  ServerPool();
+  Sockets::ClientSocket *acquire( const std::string& );
+  void release( const std::string&, Sockets::ClientSocket * );
+  void discard( const std::string& );
+  Sockets::ClientSocket *open_connection( const std::string&,
+					  const std::string&,
+					  const std::string&,
+					  TiCC::LogStream * ) const;
+  std::mutex pool_lock;
+  std::map<std::string,std::vector<Sockets::ClientSocket*>> idle;
+  pid_t owner; ///< the process the connections belong to
+};
+
+#endif // SERVER_POOL_H
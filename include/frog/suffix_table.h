@@ -0,0 +1,80 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef SUFFIX_TABLE_H
+#define SUFFIX_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include "unicode/unistr.h"
+#include "ticcutils/LogStream.h"
+
+/// \brief a precompiled, memory mapped, mapping of word suffixes to classes
+/*!
+  The Mblem classifier only looks at the last 'history' characters of a word,
+  so its answer is fully determined by that (padded) suffix. A SuffixTable
+  holds those answers for all suffixes seen while compiling, in a sorted
+  table that is searched binary, straight from the mapped file.
+
+  The file contains a header, the fixed width keys (in UTF-16 code units),
+  an index into the list of distinct classes per key, and the classes
+  themselves in UTF-8.
+ */
+class SuffixTable {
+ public:
+  explicit SuffixTable( TiCC::LogStream * );
+  ~SuffixTable();
+  bool open( const std::string&, uint64_t );
+  bool lookup( const icu::UnicodeString&, icu::UnicodeString& ) const;
+  size_t history() const { return _history; };
+  size_t size() const { return _entries; };
+  static icu::UnicodeString make_key( const icu::UnicodeString&, size_t );
+  static bool write( const std::string&,
+		     size_t,
+		     const std::map<icu::UnicodeString,icu::UnicodeString>&,
+		     uint64_t );
+  SuffixTable( const SuffixTable& ) = delete;
+  SuffixTable& operator=( const SuffixTable& ) = delete;
+ private:
+  void close();
+  const char *_map;         ///< the mapped file
+  size_t _map_size;         ///< the size of the mapping
+  const UChar *_keys;       ///< _entries keys of _history code units
+  const uint32_t *_class_of;  ///< the class index of every key
+  size_t _entries;          ///< the number of keys
+  size_t _history;          ///< the width of a key
+  std::vector<icu::UnicodeString> _classes; ///< the distinct classes
+  TiCC::LogStream *errLog;
+};
+
+#endif // SUFFIX_TABLE_H
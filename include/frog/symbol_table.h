@@ -0,0 +1,122 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <iosfwd>
+#include "unicode/unistr.h"
+
+/// \brief one entry in the global symbol table
+struct symbol_entry {
+  icu::UnicodeString str; ///< the interned string
+  uint32_t id;            ///< its (dense) number in the table
+};
+
+/// \brief an interned string, used for the closed class values in frog_record
+/*!
+  Tags, token classes and dependency roles come from small, closed sets, but
+  every frog_record used to carry its own copies of them. A symbol only holds
+  a pointer into the process wide symbol table, so it is small, cheap to copy
+  and compared in constant time. The empty string is represented by a null
+  pointer, so default construction doesn't touch the table at all.
+
+  A symbol converts implicitly to a const UnicodeString&, which stays valid
+  for the lifetime of the process. The other way round is explicit: every
+  symbol() constructed from a string may add an entry to the table that is
+  never freed, so only closed class values should be turned into symbols.
+ */
+class symbol {
+ public:
+  symbol(): _entry( 0 ) {};
+  explicit symbol( const icu::UnicodeString& s ): _entry( intern( s ) ) {};
+  explicit symbol( const char *s ): _entry( intern( icu::UnicodeString( s ) ) ) {};
+  explicit symbol( const std::string& );
+  operator const icu::UnicodeString&() const { return str(); };
+  const icu::UnicodeString& str() const {
+    return _entry ? _entry->str : empty_string;
+  };
+  uint32_t id() const { return _entry ? _entry->id : 0; };
+  bool isEmpty() const { return _entry == 0; };
+  int32_t length() const { return _entry ? _entry->str.length() : 0; };
+  char16_t operator[]( int32_t i ) const { return str()[i]; };
+  bool operator==( const symbol& other ) const {
+    return _entry == other._entry;
+  };
+  bool operator!=( const symbol& other ) const {
+    return _entry != other._entry;
+  };
+  static size_t table_size();
+ private:
+  static const symbol_entry *intern( const icu::UnicodeString& );
+  static const icu::UnicodeString empty_string;
+  const symbol_entry *_entry; ///< the entry in the table, 0 for ""
+};
+
+inline bool operator==( const symbol& s, const icu::UnicodeString& us ){
+  return s.str() == us;
+}
+
+inline bool operator==( const icu::UnicodeString& us, const symbol& s ){
+  return s.str() == us;
+}
+
+inline bool operator!=( const symbol& s, const icu::UnicodeString& us ){
+  return s.str() != us;
+}
+
+inline bool operator!=( const icu::UnicodeString& us, const symbol& s ){
+  return s.str() != us;
+}
+
+inline bool operator==( const symbol& s, const char *c ){
+  return s.str() == icu::UnicodeString( c );
+}
+
+inline bool operator!=( const symbol& s, const char *c ){
+  return !( s == c );
+}
+
+inline icu::UnicodeString operator+( const icu::UnicodeString& us,
+				     const symbol& s ){
+  return us + s.str();
+}
+
+inline icu::UnicodeString operator+( const symbol& s,
+				     const icu::UnicodeString& us ){
+  return s.str() + us;
+}
+
+std::ostream& operator<<( std::ostream&, const symbol& );
+
+#endif // SYMBOL_TABLE_H
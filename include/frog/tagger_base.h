@@ -33,6 +33,9 @@
 #define TAGGER_BASE_H
 
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include "ticcutils/LogStream.h"
 #include "ticcutils/Configuration.h"
 #include "ticcutils/SocketBasics.h"
@@ -43,6 +46,8 @@
 #include "ucto/tokenize.h"
 #include "frog/FrogData.h"
 
+class ResourceBundle;
+
 /// \brief helper class to store a word + enrichment
 class tag_entry {
 public:
@@ -50,6 +55,47 @@ public:
   icu::UnicodeString enrichment;
 };
 
+/// \brief a fixed set of MBT taggers, loaded once and shared by sessions
+/*!
+  An MbtAPI can't be cloned, and can't be used by two threads at once. So
+  the model loads a few of them, and every session borrows one for the
+  duration of a single call with acquire() and release(). By default there
+  is just one, so the tagger model is in memory only once, and sessions take
+  turns.
+ */
+class mbt_pool {
+ public:
+  mbt_pool( const std::string&, TiCC::LogStream *, size_t );
+  ~mbt_pool();
+  bool isInit() const;
+  MbtAPI *acquire();
+  void release( MbtAPI * );
+  size_t size() const { return _all.size(); };
+  mbt_pool( const mbt_pool& ) = delete;
+  mbt_pool& operator=( const mbt_pool& ) = delete;
+ private:
+  TiCC::LogStream *_log;          ///< the log of the taggers
+  std::vector<MbtAPI*> _all;      ///< all taggers
+  std::vector<MbtAPI*> _free;     ///< the taggers not in use
+  std::mutex _lock;
+  std::condition_variable _available;
+};
+
+/// \brief a tagger borrowed from an mbt_pool, until it goes out of scope
+class pooled_tagger {
+ public:
+  explicit pooled_tagger( mbt_pool& pool ):
+    _pool( pool ),
+    _tagger( pool.acquire() ) {};
+  ~pooled_tagger(){ _pool.release( _tagger ); };
+  MbtAPI *operator->() const { return _tagger; };
+  pooled_tagger( const pooled_tagger& ) = delete;
+  pooled_tagger& operator=( const pooled_tagger& ) = delete;
+ private:
+  mbt_pool& _pool;
+  MbtAPI *_tagger;
+};
+
 /// \brief a base Class for interfacing to MBT taggers
 class BaseTagger {
  public:
@@ -57,9 +103,10 @@ class BaseTagger {
 		       TiCC::LogStream *,
 		       const std::string& );
   virtual ~BaseTagger();
-  virtual bool init( const TiCC::Configuration& );
+  virtual bool init( const TiCC::Configuration&, const BaseTagger * =0 );
   virtual void post_process( frog_data& ) = 0;
-  virtual void Classify( frog_data& );
+  void Classify( frog_data& );
+  virtual void Classify( const std::vector<frog_data*>& );
   virtual void add_declaration( folia::Document&, folia::processor * ) const = 0;
   void add_provenance( folia::Document&, folia::processor * ) const;
   const std::string& getTagset() const { return tagset; };
@@ -67,13 +114,15 @@ class BaseTagger {
   bool fill_map( const std::string& );
   std::vector<Tagger::TagResult> tagLine( const icu::UnicodeString& );
   std::vector<Tagger::TagResult> tag_entries( const std::vector<tag_entry>& );
+  std::vector<std::vector<Tagger::TagResult>> tag_batch( const std::vector<std::vector<tag_entry>>& );
   const std::string& version() const { return _version; };
- private:
-  std::vector<tag_entry> extract_sentence( const frog_data& );
-  nlohmann::json read_from_client( Sockets::ClientSocket& ) const;
-  void write_to_client( nlohmann::json&,
-			Sockets::ClientSocket& ) const;
+  bool is_remote() const { return !_host.empty(); };
+  /// use the precompiled tables in \e b, when up to date. (call before init)
+  void set_bundle( const ResourceBundle *b ){ _bundle = b; };
  protected:
+  virtual std::vector<tag_entry> extract_sentence( const frog_data& );
+  virtual void finish_sentence( frog_data& );
+  icu::UnicodeString make_block( const std::vector<tag_entry>& ) const;
   std::vector<Tagger::TagResult> call_server( const std::vector<tag_entry>& ) const;
   int debug;
   std::string _label;
@@ -85,8 +134,10 @@ class BaseTagger {
   std::string base;
   std::string _host;
   std::string _port;
-  MbtAPI *tagger;
+  std::shared_ptr<mbt_pool> tagger; ///< the MBT taggers, shared with the model
+  icu::UnicodeString _eos_mark; ///< the EOS mark, used on every call
   TiCC::UniFilter *filter;
+  const ResourceBundle *_bundle; ///< the precompiled resources, if any
   std::vector<std::string> _words;
   std::vector<Tagger::TagResult> _tag_result;
   std::map<icu::UnicodeString,icu::UnicodeString> token_tag_map;
@@ -34,14 +34,16 @@
 #include <string>
 #include <iostream>
 
-#include <ticcutils/XMLtools.h>
+#include <unistd.h>
+#include <cerrno>
+#include <libxml/xmlreader.h>
 
 #include "ticcutils/StringOps.h"
 #include "ticcutils/PrettyPrint.h"
 #include "ticcutils/SocketBasics.h"
-#include "ticcutils/FileUtils.h"
 #include "frog/Frog-util.h"
 #include "frog/FrogData.h"
+#include "frog/alpino_pool.h"
 
 using namespace std;
 
@@ -88,10 +90,13 @@ void AlpinoParser::add_provenance( folia::Document& doc,
 }
 
 
-bool AlpinoParser::init( const TiCC::Configuration& configuration ){
+bool AlpinoParser::init( const TiCC::Configuration& configuration,
+			 const ParserBase * ){
   /// initaliaze an AlpinoParser class from a configuration
   /*!
     \param configuration the configuration to use
+    there is no heavy model to share between AlpinoParser instances, so a
+    model argument is ignored
   */
   filter = 0;
   bool problem = false;
@@ -185,6 +190,21 @@ bool AlpinoParser::init( const TiCC::Configuration& configuration ){
     else {
       LOG << "using locally installed Alpino." << endl;
     }
+    size_t workers = 1;
+    val = configuration.lookUp( "alpino_workers", "parser" );
+    if ( !val.empty() && !TiCC::stringTo<size_t>( val, workers ) ){
+      LOG << "invalid 'alpino_workers' value in configuration: "
+	  << val << endl;
+      problem = true;
+    }
+    int timeout = 300;
+    val = configuration.lookUp( "alpino_timeout", "parser" );
+    if ( !val.empty() && !TiCC::stringTo<int>( val, timeout ) ){
+      LOG << "invalid 'alpino_timeout' value in configuration: "
+	  << val << endl;
+      problem = true;
+    }
+    AlpinoPool::instance().configure( workers, timeout, errLog );
   }
   if ( problem ) {
     return false;
@@ -265,6 +285,49 @@ void AlpinoParser::Parse( frog_data& fd, TimerBlock& timers ){
   timers.parseTimer.stop();
 }
 
+void AlpinoParser::ParseBatch( const vector<frog_data*>& batch,
+			       TimerBlock& timers ){
+  /// parse a batch of frog_data structures using Alpino
+  /*!
+    \param batch the frog_data structures to parse
+    \param timers used for storing timing information
+
+    A locally installed Alpino gets the whole batch in one go. An Alpino
+    server still gets 1 sentence per connection.
+  */
+  if ( _alpino_server ){
+    for ( auto *fd : batch ){
+      Parse( *fd, timers );
+    }
+    return;
+  }
+  timers.parseTimer.start();
+  if ( !isInit ){
+    LOG << "Parser is not initialized! EXIT!" << endl;
+    throw runtime_error( "Parser is not initialized!" );
+  }
+  vector<frog_data*> to_do;
+  vector<string> sentences;
+  for ( auto *fd : batch ){
+    if ( fd->empty() ){
+      LOG << "unable to parse an analysis without words" << endl;
+      continue;
+    }
+    to_do.push_back( fd );
+    sentences.push_back( fd->sentence() );
+  }
+  vector<string> xmls = AlpinoPool::instance().parse( sentences );
+  for ( size_t i=0; i < to_do.size(); ++i ){
+    vector<parsrel> solution = xml_to_parse( xmls[i], *to_do[i] );
+    if ( solution.empty() ){
+      LOG << "parsing failed" << endl;
+      throw runtime_error( "Is the Alpino runtime installed?" );
+    }
+    appendParseResult( *to_do[i], solution );
+  }
+  timers.parseTimer.stop();
+}
+
 void AlpinoParser::add_mwus( const frog_data& fd,
 			     const vector<folia::Word*>& wv ) const {
   /// add the MWU's stored in a frog_data record as folia Entities
@@ -374,20 +437,34 @@ const dp_tree *extract_hd( const dp_tree *node ){
   return 0;
 }
 
-dp_tree *parse_node( xmlNode *node ){
-  /// convert a singel node in an Alpino XML tree into a much simpler dp_tree node
+string get_attribute( xmlTextReaderPtr reader, const char *att ){
+  /// return the value of an attribute of the current element of \e reader
+  /*!
+    \param reader the XML reader
+    \param att the attribute name
+    \return the value, or an empty string when not present
+  */
+  string result;
+  xmlChar *val = xmlTextReaderGetAttribute( reader, (const xmlChar*)att );
+  if ( val ){
+    result = (const char*)val;
+    xmlFree( val );
+  }
+  return result;
+}
+
+dp_tree *read_node( xmlTextReaderPtr reader ){
+  /// convert a single node in an Alpino XML tree into a much simpler dp_tree node
   /*!
-    \param node The Alpino XML node to parse
+    \param reader an XML reader positioned on a 'node' element
     \return a dp_tree structure with the essential information from Alpino
   */
-  auto atts = TiCC::getAttributes( node );
-  //  cerr << "attributes: " << atts << endl;
   dp_tree *dp = new dp_tree();
-  dp->id = TiCC::stringTo<int>( atts["id"] );
-  dp->begin = TiCC::stringTo<int>( atts["begin"] );
-  dp->end = TiCC::stringTo<int>( atts["end"] );
-  dp->rel = atts["rel"];
-  dp->word = atts["word"];
+  dp->id = TiCC::stringTo<int>( get_attribute( reader, "id" ) );
+  dp->begin = TiCC::stringTo<int>( get_attribute( reader, "begin" ) );
+  dp->end = TiCC::stringTo<int>( get_attribute( reader, "end" ) );
+  dp->rel = get_attribute( reader, "rel" );
+  dp->word = get_attribute( reader, "word" );
   if ( !dp->word.empty() ){
     dp->word_index = dp->end;
   }
@@ -400,45 +477,99 @@ dp_tree *parse_node( xmlNode *node ){
   return dp;
 }
 
-dp_tree *parse_nodes( xmlNode *node ){
-  /// recurively convert an Alpino XML tree into a much simpler dp_tree tree
+dp_tree *read_children( xmlTextReaderPtr reader, bool& has_children ){
+  /// recursively convert the content of an Alpino XML element into a much
+  /// simpler dp_tree tree, while reading it
   /*!
-    \param node The Alpino XML tree to parse
-    \return A dp_tree node tree
+    \param reader an XML reader positioned on a non-empty start element. It
+    is left on the matching end element
+    \param has_children set to true when the element has any content
+    \return A dp_tree node tree of all 'node' children, or 0
 
     an Alpino XML tree is quite complex. We try to simplify it and extract only
-    what is needed.
+    what is needed. No document tree is built.
   */
   dp_tree *result = 0;
-  xmlNode *pnt = node;
   dp_tree *last_added = 0;
-  while ( pnt ){
-    if ( TiCC::Name( pnt ) == "node" ){
-      dp_tree *parsed = parse_node( pnt );
-      if ( parsed->begin+1 < parsed->end
-	   && pnt->children == NULL ){
+  has_children = false;
+  const int depth = xmlTextReaderDepth( reader );
+  while ( xmlTextReaderRead( reader ) == 1 ){
+    int type = xmlTextReaderNodeType( reader );
+    if ( type == XML_READER_TYPE_END_ELEMENT
+	 && xmlTextReaderDepth( reader ) == depth ){
+      return result;
+    }
+    if ( type == XML_READER_TYPE_TEXT
+	 || type == XML_READER_TYPE_CDATA ){
+      has_children = true;
+    }
+    else if ( type == XML_READER_TYPE_ELEMENT ){
+      has_children = true;
+      const bool empty = xmlTextReaderIsEmptyElement( reader );
+      dp_tree *parsed = 0;
+      if ( string( (const char*)xmlTextReaderConstLocalName( reader ) )
+	   == "node" ){
+	parsed = read_node( reader );
+      }
+      dp_tree *childs = 0;
+      bool grand_children = false;
+      if ( !empty ){
+	childs = read_children( reader, grand_children );
+      }
+      if ( !parsed ){
+	// we are only interested in 'node' elements
+	delete childs;
+      }
+      else if ( parsed->begin+1 < parsed->end
+		&& !grand_children ){
 	// an aggregate with NO children. No useful information here
 	// just leave it out
 	delete parsed;
       }
-      else if ( result == 0 ){
-	// first result.
-	result = parsed;
-	last_added = result;
-      }
       else {
-	// continue
-	last_added->next = parsed;
+	if ( result == 0 ){
+	  // first result.
+	  result = parsed;
+	}
+	else {
+	  // continue
+	  last_added->next = parsed;
+	}
 	last_added = parsed;
-      }
-      if ( pnt->children ){
-	dp_tree *childs = parse_nodes( pnt->children );
 	last_added->link = childs;
       }
     }
-    pnt = pnt->next;
   }
-  return result;
+  delete result;
+  throw runtime_error( "unexpected end of Alpino XML" );
+}
+
+dp_tree *read_alpino( xmlTextReaderPtr reader ){
+  /// read Alpino XML into a dp_tree tree
+  /*!
+    \param reader an XML reader at the start of the Alpino XML
+    \return the dp_tree for the 'top' node, or 0 when not found
+  */
+  while ( xmlTextReaderRead( reader ) == 1 ){
+    if ( xmlTextReaderNodeType( reader ) == XML_READER_TYPE_ELEMENT
+	 && string( (const char*)xmlTextReaderConstLocalName( reader ) )
+	 == "node"
+	 && get_attribute( reader, "rel" ) == "top" ){
+      dp_tree *top = read_node( reader );
+      if ( !xmlTextReaderIsEmptyElement( reader ) ){
+	bool has_children;
+	try {
+	  top->link = read_children( reader, has_children );
+	}
+	catch ( ... ){
+	  delete top;
+	  throw;
+	}
+      }
+      return top;
+    }
+  }
+  return 0;
 }
 
 dp_tree *resolve_mwus( dp_tree *in,
@@ -716,17 +847,19 @@ vector<parsrel> extract( const list<pair<const dp_tree*,const dp_tree*>>& l ){
   return result;
 }
 
-vector<parsrel> extract_dp( xmlDoc *alp_doc,
+vector<parsrel> extract_dp( xmlTextReaderPtr reader,
 			    frog_data& fd ){
-  /// extract a list of parsrel records from an Alpino XML file and resolve
-  /// MWU's
+  /// extract a list of parsrel records from Alpino XML and resolve MWU's
   /*!
-    \param alp_doc an Alpino XML document
+    \param reader an XML reader on Alpino XML. The XML is read while it
+    arrives, without building a document tree
     \param fd a frog_data structure to receive the MWU information
     \return a list of parsrel records
    */
-  xmlNode *top_node = TiCC::xPath( alp_doc, "//node[@rel='top']" );
-  dp_tree *dp = parse_nodes( top_node );
+  dp_tree *dp = read_alpino( reader );
+  if ( !dp ){
+    throw runtime_error( "PANIC, no top node" );
+  }
 #if defined(DEBUG_EXTRACT) || defined(DEBUG_MWU)
   cerr << endl << "done parsing, dp nodes:" << endl;
   print_nodes( 0, dp );
@@ -759,6 +892,24 @@ vector<parsrel> extract_dp( xmlDoc *alp_doc,
   return pr;
 }
 
+int read_socket( void *context, char *buffer, int len ){
+  /// xmlInputReadCallback to read XML directly from a socket
+  /*!
+    \param context a pointer to the socket id
+    \param buffer the buffer to fill
+    \param len the size of \e buffer
+    \return the number of bytes read, 0 at the end, or -1 on errors
+  */
+  int sock = *static_cast<int*>( context );
+  while ( true ){
+    ssize_t res = ::read( sock, buffer, len );
+    if ( res < 0 && errno == EINTR ){
+      continue;
+    }
+    return res;
+  }
+}
+
 vector<parsrel> AlpinoParser::alpino_server_parse( frog_data& fd ){
   /// parse a sentence into a group of parsrel records using an Alpino server
   /*!
@@ -780,17 +931,47 @@ vector<parsrel> AlpinoParser::alpino_server_parse( frog_data& fd ){
 #endif
   string txt = fd.sentence();
   client.write( txt + "\n\n" );
-  string result;
-  string s;
-  while ( client.read(s) ){
-    result += s + "\n";
+  // the server closes the connection after sending the XML. We parse it
+  // while it arrives
+  int sock = client.getSockId();
+  xmlTextReaderPtr reader = xmlReaderForIO( read_socket, 0, &sock,
+					    0, 0, XML_PARSE_NOBLANKS );
+  if ( !reader ){
+    throw runtime_error( "unable to read the Alpino server reply" );
   }
-#ifdef DEBUG_ALPINO
-  cerr << "received data [" << result << "]" << endl;
-#endif
-  xmlDoc *doc = xmlReadMemory( result.c_str(), result.length(),
-			       0, 0, XML_PARSE_NOBLANKS );
-  return extract_dp(doc,fd);
+  vector<parsrel> result;
+  try {
+    result = extract_dp( reader, fd );
+  }
+  catch ( ... ){
+    xmlFreeTextReader( reader );
+    throw;
+  }
+  xmlFreeTextReader( reader );
+  return result;
+}
+
+vector<parsrel> xml_to_parse( const string& xml, frog_data& fd ){
+  /// extract the parse of 1 sentence from Alpino XML
+  /*!
+    \param xml the XML as produced by Alpino
+    \param fd The frog_data record of the parsed sentence
+    \return a vector of parsrel structures. Empty when the XML is invalid
+  */
+  vector<parsrel> result;
+  xmlTextReaderPtr reader = xmlReaderForMemory( xml.c_str(), xml.length(),
+						0, 0, XML_PARSE_NOBLANKS );
+  if ( reader ){
+    try {
+      result = extract_dp( reader, fd );
+    }
+    catch ( ... ){
+      xmlFreeTextReader( reader );
+      throw;
+    }
+    xmlFreeTextReader( reader );
+  }
+  return result;
 }
 
 vector<parsrel> AlpinoParser::alpino_parse( frog_data& fd ){
@@ -799,42 +980,14 @@ vector<parsrel> AlpinoParser::alpino_parse( frog_data& fd ){
     \param fd The frog_data record containing the information to parse
     \return a vector of parsrel structures
 
-    This function uses a local Alpino porgram (which should be configured
-    correctly) by feeding it the sentence contained in \e fd and parses the
+    This function hands the sentence contained in \e fd to one of the
+    long running Alpino processes from the AlpinoPool, and parses the
     delivered XML to extract all dependency information
   */
 #ifdef DEBUG_ALPINO
   cerr << "calling Alpino input:" << fd.sentence() << endl;
 #endif
-  vector<parsrel> result;
-#ifdef DEBUG_ALPINO
-  TiCC::tmp_stream temp_stream( "alpino-parse.txt.", true );
-#else
-  TiCC::tmp_stream temp_stream( "alpino-parse.txt." );
-#endif
-  string input_file = temp_stream.tmp_name();
-  string tmp_dir = TiCC::dirname(input_file) +"/";
-  string tmp_str = input_file.substr( input_file.size()-6 );
-  //    Alpino will use the tmp_str part for its output filename.
-  string txt = tmp_str + "|" + fd.sentence();
-  temp_stream.os() << txt;
-  temp_stream.close();
-  string parseCmd = "Alpino -veryfast -flag treebank " + tmp_dir +
-    " end_hook=xml -parse <  " + input_file + " -notk > /dev/null 2>&1";
-#ifdef DEBUG_ALPINO
-  cerr << "run: " << parseCmd << endl;
-#endif
-  int res = system( parseCmd.c_str() );
-  if ( res ){
-    cerr << "Alpino failed: RES = " << res << " : " << strerror(res) << endl;
-    return result;
-  }
-  string xml_file = tmp_dir + tmp_str + ".xml";
-  xmlDoc *xmldoc = xmlReadFile( xml_file.c_str(), 0, XML_PARSE_NOBLANKS );
-  result = extract_dp(xmldoc,fd);
-  xmlFreeDoc( xmldoc );
-#ifndef DEBUG_ALPINO
-  TiCC::erase( xml_file );
-#endif
-  return result;
+  vector<string> xmls
+    = AlpinoPool::instance().parse( vector<string>( 1, fd.sentence() ) );
+  return xml_to_parse( xmls[0], fd );
 }
@@ -103,3 +103,54 @@ string check_server( const string& host,
   }
   return outline;
 }
+
+uint64_t fnv_hash( const char *data, size_t len, uint64_t hash ){
+  /// a simple hash which is the same on every run, unlike std::hash
+  /*!
+    \param data the bytes to hash
+    \param len the number of bytes
+    \param hash the start value, to hash in several steps
+    \return the FNV-1a hash
+  */
+  for ( size_t i=0; i < len; ++i ){
+    hash ^= (unsigned char)data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+uint64_t make_stamp( const string& description,
+		     const string& file_name ){
+  /// create a stamp for the model and settings a stored file is made from
+  /*!
+    \param description a description of the settings. e.g. the module name
+    and version, or the server used
+    \param file_name when not empty, the model file. Its size and modification
+    time are part of the stamp
+    \return the stamp
+  */
+  string what = description;
+  if ( !file_name.empty() ){
+    struct stat st;
+    if ( stat( file_name.c_str(), &st ) == 0 ){
+      what += ":" + to_string( st.st_size ) + ":" + to_string( st.st_mtime );
+    }
+  }
+  return fnv_hash( what.data(), what.size() );
+}
+
+uint64_t make_stamp( const string& description,
+		     const vector<string>& files ){
+  /// create a stamp for something made from several files
+  /*!
+    \param description a description of the settings used
+    \param files the source files. Their sizes and modification times are
+    part of the stamp
+    \return the stamp
+  */
+  uint64_t stamp = make_stamp( description );
+  for ( const auto& file : files ){
+    stamp = make_stamp( to_string( stamp ), file );
+  }
+  return stamp;
+}
@@ -148,7 +148,31 @@ void usage( ) {
 #ifdef HAVE_OPENMP
        << "\t --threads=<n>          Use a maximum of 'n' threads. Default: 8. \n"
 #endif
-       << "\t                         (but always 1 for server mode)\n";
+       << "\t                         In server mode: the number of pre-forked server\n"
+       << "\t                         processes, each on 1 thread. (max 8 by default)\n"
+       << "\t --multiplex            In server mode: keep many connections open in 1 epoll\n"
+       << "\t                         loop, which queues complete requests for the server\n"
+       << "\t                         processes.\n"
+       << "\t --listen-backlog=<n>   In server mode: queue at most 'n' pending connections. (default 5)\n"
+       << "\t --max-connections=<n>  With --multiplex: refuse connections beyond 'n'\n"
+       << "\t                         with a 'busy' reply.\n"
+       << "\t --max-request-size=<n> In server mode: refuse requests larger than 'n' bytes.\n"
+       << "\t --max-requests=<n>     In server mode: give requests beyond 'n' that are\n"
+       << "\t                         analyzed or queued a 'busy' reply.\n"
+       << "\t --workers=<n>          Analyze plain text input with 'n' parallel workers,\n"
+       << "\t                        sharing the loaded models. The workers take turns\n"
+       << "\t                        using an MBT tagger. (default 1)\n"
+       << "\t --queue-depth=<n>      With --workers: the maximum number of sentences\n"
+       << "\t                        (or batches) 'in flight'. (default 4 times the number\n"
+       << "\t                        of workers)\n"
+       << "\t --parallel-files=<n>   When processing more files, Frog 'n' of them at the same time.\n"
+       << "\t                        Needs --outputdir or --nostdout.\n"
+       << "\t --batch-size=<n>       Analyze plain text input in batches of 'n' sentences,\n"
+       << "\t                        running every module on the whole batch. With\n"
+       << "\t                        --workers, every worker handles one batch at a time.\n"
+       << "\t                        (default 1)\n"
+       << "\t --sentence-cache=<mb>  Keep the results of up to 'mb' megabytes of sentences,\n"
+       << "\t                        and copy repeated sentences instead of analyzing them again.\n";
 }
 
 
@@ -202,7 +226,10 @@ int main(int argc, char *argv[]) {
 			  "compounds,language:,retry,nostdout,ner-override:,"
 			  "debug:,keep-parser-files,version,threads:,alpino::,"
 			  "override:,KANON,TESTAPI,debugfile:,JSONin,JSONout::,"
-			  "allow-word-corrections,OLDMWU");
+			  "allow-word-corrections,OLDMWU,workers:,queue-depth:,"
+			  "parallel-files:,batch-size:,multiplex,listen-backlog:,"
+			  "max-connections:,max-request-size:,max-requests:,"
+			  "sentence-cache:");
     Opts.init(argc, argv);
     if ( Opts.is_present('V' ) || Opts.is_present("version" ) ){
       // we already did show what we wanted.
@@ -43,6 +43,17 @@
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <new>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include "unicode/schriter.h"
 #include "config.h"
 #ifdef HAVE_OPENMP
@@ -83,6 +94,8 @@
 #include "frog/ner_tagger_mod.h"
 #include "frog/Parser.h"
 #include "frog/AlpinoParser.h"
+#include "frog/event_server.h"
+#include "frog/resource_bundle.h"
 #include "ticcutils/json.hpp"
 
 using namespace std;
@@ -172,6 +185,17 @@ FrogOptions::FrogOptions():
   do_und_language(false),
   do_language_detection(false),
   numThreads(1),
+  numWorkers(1),
+  queueDepth(0),
+  numFileWorkers(1),
+  numServerWorkers(1),
+  doMultiplex(false),
+  listenBacklog(5),
+  maxConnections(0),
+  maxRequestSize(0),
+  maxRequests(0),
+  batchSize(1),
+  sentenceCacheSize(0),
   debugFlag(0),
   JSON_pp(0),
   uttmark("<utt>"),
@@ -189,6 +213,7 @@ FrogOptions::FrogOptions():
 #ifdef HAVE_OPENMP
   numThreads = min<int>( 8, omp_get_max_threads() ); // ok, don't overdo
 #endif
+  numServerWorkers = max<int>( 1, min<int>( 8, thread::hardware_concurrency() ) );
 }
 
 void FrogAPI::test_version( const TiCC::Configuration& configuration,
@@ -551,27 +576,135 @@ bool FrogAPI::collect_options( TiCC::CL_Options& Opts,
     LOG << "option JSONin is only allowed for server mode. (-S option)" << endl;
     return false;
   }
-#ifdef HAVE_OPENMP
-  if ( options.doServer ) {
-    // run in one thread in server mode, forking is too expensive for lots of small snippets
-    options.numThreads =  1;
-    Opts.extract( "threads", opt_val ); //discard threads option
-  }
-  else if ( Opts.extract( "threads", opt_val ) ){
+  if ( Opts.extract( "threads", opt_val ) ){
     int num;
     if ( !TiCC::stringTo<int>( opt_val, num ) || num < 1 ){
       LOG << "threads value should be a positive integer" << endl;
       return false;
     }
-    options.numThreads = num;
-  }
+    if ( options.doServer ){
+      // in server mode, every worker process runs on 1 thread, so we use
+      // this value for the size of the server pool
+      options.numServerWorkers = num;
+    }
+    else {
+#ifdef HAVE_OPENMP
+      options.numThreads = num;
 #else
-  if ( Opts.extract( "threads", opt_val ) ){
-    LOG << "WARNING!\n---> There is NO OpenMP support enabled\n"
-		    << "---> --threads=" << opt_val << " is ignored.\n"
-		    << "---> Will continue on just 1 thread." << endl;
+      LOG << "WARNING!\n---> There is NO OpenMP support enabled\n"
+	  << "---> --threads=" << opt_val << " is ignored.\n"
+	  << "---> Will continue on just 1 thread." << endl;
+#endif
+    }
   }
+  if ( Opts.extract( "multiplex" ) ){
+    if ( !options.doServer ){
+      LOG << "option --multiplex is only allowed for server mode. (-S option)"
+	  << endl;
+      return false;
+    }
+#ifdef HAVE_SYS_EPOLL_H
+    options.doMultiplex = true;
+#else
+    LOG << "option --multiplex is not supported on this system" << endl;
+    return false;
 #endif
+  }
+  if ( Opts.extract( "listen-backlog", opt_val ) ){
+    if ( !options.doServer ){
+      LOG << "option --listen-backlog is only allowed for server mode. (-S option)"
+	  << endl;
+      return false;
+    }
+    if ( !TiCC::stringTo<int>( opt_val, options.listenBacklog )
+	 || options.listenBacklog < 1 ){
+      LOG << "listen-backlog value should be a positive integer" << endl;
+      return false;
+    }
+  }
+  if ( Opts.extract( "max-connections", opt_val ) ){
+    if ( !options.doMultiplex ){
+      LOG << "option --max-connections needs --multiplex" << endl;
+      return false;
+    }
+    if ( !TiCC::stringTo<size_t>( opt_val, options.maxConnections ) ){
+      LOG << "max-connections value should be a number" << endl;
+      return false;
+    }
+  }
+  if ( Opts.extract( "max-request-size", opt_val ) ){
+    if ( !options.doServer ){
+      LOG << "option --max-request-size is only allowed for server mode. (-S option)"
+	  << endl;
+      return false;
+    }
+    if ( !TiCC::stringTo<size_t>( opt_val, options.maxRequestSize ) ){
+      LOG << "max-request-size value should be a number" << endl;
+      return false;
+    }
+  }
+  if ( Opts.extract( "max-requests", opt_val ) ){
+    if ( !options.doServer ){
+      LOG << "option --max-requests is only allowed for server mode. (-S option)"
+	  << endl;
+      return false;
+    }
+    if ( !TiCC::stringTo<size_t>( opt_val, options.maxRequests ) ){
+      LOG << "max-requests value should be a number" << endl;
+      return false;
+    }
+  }
+  if ( options.doServer ) {
+    // run in one thread per server worker. OpenMP doesn't mix well with
+    // fork(), and isn't worth it for lots of small snippets
+    options.numThreads =  1;
+  }
+  if ( Opts.extract( "workers", opt_val ) ){
+    if ( options.doServer ){
+      LOG << "option --workers is not possible when running a Server" << endl;
+      return false;
+    }
+    if ( !TiCC::stringTo<int>( opt_val, options.numWorkers )
+	 || options.numWorkers < 1 ){
+      LOG << "workers value should be a positive integer" << endl;
+      return false;
+    }
+  }
+  if ( Opts.extract( "queue-depth", opt_val ) ){
+    if ( !TiCC::stringTo<int>( opt_val, options.queueDepth )
+	 || options.queueDepth < 1 ){
+      LOG << "queue-depth value should be a positive integer" << endl;
+      return false;
+    }
+  }
+  if ( options.queueDepth == 0 ){
+    options.queueDepth = 4 * options.numWorkers;
+  }
+  if ( Opts.extract( "parallel-files", opt_val ) ){
+    if ( options.doServer ){
+      LOG << "option --parallel-files is not possible when running a Server"
+	  << endl;
+      return false;
+    }
+    if ( !TiCC::stringTo<int>( opt_val, options.numFileWorkers )
+	 || options.numFileWorkers < 1 ){
+      LOG << "parallel-files value should be a positive integer" << endl;
+      return false;
+    }
+  }
+  if ( Opts.extract( "batch-size", opt_val ) ){
+    if ( !TiCC::stringTo<int>( opt_val, options.batchSize )
+	 || options.batchSize < 1 ){
+      LOG << "batch-size value should be a positive integer" << endl;
+      return false;
+    }
+  }
+  if ( Opts.extract( "sentence-cache", opt_val ) ){
+    if ( !TiCC::stringTo<size_t>( opt_val, options.sentenceCacheSize ) ){
+      LOG << "sentence-cache value should be a number (of MB)" << endl;
+      return false;
+    }
+  }
 
   if ( Opts.extract( "keep-parser-files" ) ){
     LOG << "keep-parser-files option not longer supported. (ignored)" << endl;
@@ -715,6 +848,17 @@ bool FrogAPI::collect_options( TiCC::CL_Options& Opts,
       configuration.setatt( "outputclass", outputclass );
     }
   }
+  if ( options.numFileWorkers > 1 ){
+    if ( !options.outputFileName.empty() ){
+      LOG << "option --parallel-files cannot be combined with -o. "
+	  << "Use --outputdir" << endl;
+      return false;
+    }
+    if ( options.outputDirName.empty() && !options.noStdOut ){
+      LOG << "option --parallel-files needs --outputdir or --nostdout" << endl;
+      return false;
+    }
+  }
   if ( !options.XMLoutFileName.empty() && !options.testDirName.empty() ){
     LOG << "useless -X value" << endl;
     return false;
@@ -854,6 +998,122 @@ bool FrogAPI::collect_options( TiCC::CL_Options& Opts,
   return true;
 }
 
+FrogWorker::FrogWorker( TiCC::LogStream *err_log,
+			TiCC::LogStream *dbg_log ):
+  myMbma(0),
+  myMblem(0),
+  myMwu(0),
+  myParser(0),
+  myCGNTagger(0),
+  myIOBTagger(0),
+  myNERTagger(0),
+  errLog(err_log),
+  dbgLog(dbg_log)
+{
+  /// Create an empty FrogWorker
+  /*!
+    \param err_log A LogStream for error messages
+    \param dbg_log A LogStream for debugging purposes
+  */
+}
+
+FrogWorker::~FrogWorker(){
+  /// Destructor. Clears all modules
+  delete myMbma;
+  delete myMblem;
+  delete myMwu;
+  delete myCGNTagger;
+  delete myIOBTagger;
+  delete myNERTagger;
+  delete myParser;
+}
+
+bool FrogWorker::init( const TiCC::Configuration& configuration,
+		       const FrogOptions& options,
+		       const FrogWorker *model,
+		       const ResourceBundle *bundle ){
+  /// create and initialize the modules for this worker
+  /*!
+    \param configuration the Frog configuration
+    \param options the runtime options, to decide which modules we need
+    \param model an already initialized worker. When given, our modules
+    share the read-only models of the modules of 'model', and only keep
+    their per-sentence state to themselves. The model must outlive us.
+    \param bundle the precompiled resources, if any. It must outlive us.
+    \return true on succes
+
+    The modules are initialized one after the other.
+  */
+  myCGNTagger = new CGNTagger( errLog, dbgLog );
+  myCGNTagger->set_bundle( bundle );
+  bool stat = myCGNTagger->init( configuration,
+				 model ? model->myCGNTagger : 0 );
+  if ( stat && options.doIOB ){
+    myIOBTagger = new IOBTagger( errLog, dbgLog );
+    stat = myIOBTagger->init( configuration,
+			      model ? model->myIOBTagger : 0 );
+  }
+  if ( stat && options.doNER ){
+    myNERTagger = new NERTagger( errLog, dbgLog );
+    myNERTagger->set_bundle( bundle );
+    stat = myNERTagger->init( configuration,
+			      model ? model->myNERTagger : 0 );
+  }
+  if ( stat && options.doLemma ){
+    myMblem = new Mblem( errLog, dbgLog );
+    myMblem->set_bundle( bundle );
+    stat = myMblem->init( configuration,
+			  model ? model->myMblem : 0 );
+  }
+  if ( stat && options.doMbma ){
+    myMbma = new Mbma( errLog, dbgLog );
+    myMbma->set_bundle( bundle );
+    stat = myMbma->init( configuration,
+			 model ? model->myMbma : 0 );
+    if ( stat && options.doDeepMorph ){
+      myMbma->setDeepMorph(true);
+    }
+  }
+  if ( stat && options.doAlpino ){
+    myParser = new AlpinoParser( errLog, dbgLog );
+    stat = myParser->init( configuration );
+  }
+  else if ( stat && options.doMwu ){
+    myMwu = new Mwu( errLog, dbgLog );
+    myMwu->set_bundle( bundle );
+    stat = myMwu->init( configuration,
+			model ? model->myMwu : 0 );
+    if ( stat && options.doParse ){
+      myParser = new Parser( errLog, dbgLog );
+      stat = myParser->init( configuration,
+			     model ? model->myParser : 0 );
+    }
+  }
+  return stat;
+}
+
+int FrogWorker::remote_modules() const {
+  /// count the modules after the tagger that use a remote server
+  /*!
+    \return the number of MBMA, MBLEM, NER and IOB modules that are
+    configured with a Timbl or MBT server
+  */
+  int result = 0;
+  if ( myMbma && myMbma->is_remote() ){
+    ++result;
+  }
+  if ( myMblem && myMblem->is_remote() ){
+    ++result;
+  }
+  if ( myNERTagger && myNERTagger->is_remote() ){
+    ++result;
+  }
+  if ( myIOBTagger && myIOBTagger->is_remote() ){
+    ++result;
+  }
+  return result;
+}
+
 FrogAPI::FrogAPI( TiCC::CL_Options& Opts,
 		  TiCC::LogStream *err_log,
 		  TiCC::LogStream *dbg_log ):
@@ -867,7 +1127,11 @@ FrogAPI::FrogAPI( TiCC::CL_Options& Opts,
   myCGNTagger(0),
   myIOBTagger(0),
   myNERTagger(0),
-  tokenizer(0)
+  tokenizer(0),
+  resources(0),
+  activeRequests(0),
+  requestSlot(0),
+  sentence_cache(0)
 {
   /// Initialize an FrogAPI class
   /*!
@@ -887,11 +1151,26 @@ FrogAPI::FrogAPI( TiCC::CL_Options& Opts,
   if (!parsed) {
     throw runtime_error( "init failed" );
   }
+  if ( options.sentenceCacheSize > 0 ){
+    sentence_cache
+      = new ResultCache<string,
+			shared_ptr<const frog_data>>( options.sentenceCacheSize
+						      * 1024 * 1024 );
+  }
   run_api( configuration );
 }
 
 void FrogAPI::run_api( const TiCC::Configuration& configuration ){
-  if ( options.doServer ){
+  string bundle_name = configuration.lookUp( "resource_bundle" );
+  if ( !bundle_name.empty() ){
+    // opened once, and mapped by all modules of all workers
+    resources = new ResourceBundle( theErrLog );
+    if ( !resources->open( prefix( configuration.configDir(), bundle_name ) ) ){
+      delete resources;
+      resources = 0;
+    }
+  }
+  if ( options.doServer || options.numFileWorkers > 1 ){
     // we use fork(). omp (GCC version) doesn't do well when omp is used
     // before the fork!
     // see: http://bisqwit.iki.fi/story/howto/openmp/#OpenmpAndFork
@@ -910,49 +1189,24 @@ void FrogAPI::run_api( const TiCC::Configuration& configuration ){
       tokenizer->setWordCorrection( options.correct_words );
       tokenizer->setUndLang( options.do_und_language );
       tokenizer->setLangDetection( options.do_language_detection );
-      myCGNTagger = new CGNTagger( theErrLog,theDbgLog );
-      stat = myCGNTagger->init( configuration );
+      FrogWorker *worker = new FrogWorker( theErrLog, theDbgLog );
+      workers.push_back( worker );
+      stat = worker->init( configuration, options, 0, resources );
       if ( stat ){
+	myCGNTagger = worker->myCGNTagger;
+	myIOBTagger = worker->myIOBTagger;
+	myNERTagger = worker->myNERTagger;
+	myMblem = worker->myMblem;
+	myMbma = worker->myMbma;
+	myMwu = worker->myMwu;
+	myParser = worker->myParser;
 	UnicodeString u_mark = TiCC::UnicodeFromUTF8( options.uttmark );
 	myCGNTagger->set_eos_mark( u_mark );
-	if ( options.doIOB ){
-	  myIOBTagger = new IOBTagger( theErrLog, theDbgLog );
-	  stat = myIOBTagger->init( configuration );
-	  if ( stat ){
-	    myIOBTagger->set_eos_mark( u_mark );
-	  }
-	}
-	if ( stat && options.doNER ){
-	  myNERTagger = new NERTagger( theErrLog, theDbgLog );
-	  stat = myNERTagger->init( configuration );
-	  if ( stat ){
-	    myNERTagger->set_eos_mark( u_mark );
-	  }
+	if ( myIOBTagger ){
+	  myIOBTagger->set_eos_mark( u_mark );
 	}
-	if ( stat && options.doLemma ){
-	  myMblem = new Mblem(theErrLog,theDbgLog);
-	  stat = myMblem->init( configuration );
-	}
-	if ( stat && options.doMbma ){
-	  myMbma = new Mbma(theErrLog,theDbgLog);
-	  stat = myMbma->init( configuration );
-	  if ( stat ) {
-	    if ( options.doDeepMorph ){
-	      myMbma->setDeepMorph(true);
-	    }
-	  }
-	}
-	if ( stat && options.doAlpino ){
-	  myParser = new AlpinoParser(theErrLog,theDbgLog);
-	  stat = myParser->init( configuration );
-	}
-	else if ( stat && options.doMwu ){
-	  myMwu = new Mwu(theErrLog,theDbgLog);
-	  stat = myMwu->init( configuration );
-	  if ( stat && options.doParse ){
-	    myParser = new Parser(theErrLog,theDbgLog);
-	    stat = myParser->init( configuration );
-	  }
+	if ( myNERTagger ){
+	  myNERTagger->set_eos_mark( u_mark );
 	}
       }
     }
@@ -1025,6 +1279,7 @@ void FrogAPI::run_api( const TiCC::Configuration& configuration ){
 	if ( options.doLemma ){
 	  try {
 	    myMblem = new Mblem(theErrLog,theDbgLog);
+	    myMblem->set_bundle( resources );
 	    lemStat = myMblem->init( configuration );
 	  }
 	  catch ( const exception& e ){
@@ -1038,6 +1293,7 @@ void FrogAPI::run_api( const TiCC::Configuration& configuration ){
 	if ( options.doMbma ){
 	  try {
 	    myMbma = new Mbma(theErrLog,theDbgLog);
+	    myMbma->set_bundle( resources );
 	    mbaStat = myMbma->init( configuration );
 	    if ( options.doDeepMorph ){
 	      myMbma->setDeepMorph(true);
@@ -1053,6 +1309,7 @@ void FrogAPI::run_api( const TiCC::Configuration& configuration ){
       {
 	try {
 	  myCGNTagger = new CGNTagger( theErrLog, theDbgLog );
+	  myCGNTagger->set_bundle( resources );
 	  tagStat = myCGNTagger->init( configuration );
 	}
 	catch ( const exception& e ){
@@ -1078,6 +1335,7 @@ void FrogAPI::run_api( const TiCC::Configuration& configuration ){
 	if ( options.doNER ){
 	  try {
 	    myNERTagger = new NERTagger( theErrLog, theDbgLog );
+	    myNERTagger->set_bundle( resources );
 	    nerStat = myNERTagger->init( configuration );
 	  }
 	  catch ( const exception& e ){
@@ -1105,6 +1363,7 @@ void FrogAPI::run_api( const TiCC::Configuration& configuration ){
 	else if ( options.doMwu ){
 	  try {
 	    myMwu = new Mwu( theErrLog, theDbgLog );
+	    myMwu->set_bundle( resources );
 	    mwuStat = myMwu->init( configuration );
 	    if ( mwuStat && options.doParse ){
 	      TiCC::Timer initTimer;
@@ -1158,6 +1417,27 @@ void FrogAPI::run_api( const TiCC::Configuration& configuration ){
       LOG << out << endl;
       throw runtime_error( "Frog init failed" );
     }
+    // the modules we just created form the first worker
+    FrogWorker *worker = new FrogWorker( theErrLog, theDbgLog );
+    worker->myCGNTagger = myCGNTagger;
+    worker->myIOBTagger = myIOBTagger;
+    worker->myNERTagger = myNERTagger;
+    worker->myMblem = myMblem;
+    worker->myMbma = myMbma;
+    worker->myMwu = myMwu;
+    worker->myParser = myParser;
+    workers.push_back( worker );
+  }
+  for ( int i=1; i < options.numWorkers; ++i ){
+    LOG << "initializing worker " << i+1 << " of "
+	<< options.numWorkers << endl;
+    FrogWorker *worker = new FrogWorker( theErrLog, theDbgLog );
+    workers.push_back( worker );
+    // share the models of the first worker
+    if ( !worker->init( configuration, options, workers[0], resources ) ){
+      LOG << "Initialization failed for worker " << i+1 << endl;
+      throw runtime_error( "Frog init failed" );
+    }
   }
   LOG << TiCC::Timer::now() <<  " Initialization done." << endl;
 }
@@ -1165,127 +1445,242 @@ void FrogAPI::run_api( const TiCC::Configuration& configuration ){
 
 FrogAPI::~FrogAPI() {
   /// Destructor. Clears all resources
-  delete myMbma;
-  delete myMblem;
-  delete myMwu;
-  delete myCGNTagger;
-  delete myIOBTagger;
-  delete myNERTagger;
-  delete myParser;
+  /*!
+    the modules are owned by the workers. The first worker holds the models
+    the others share, so it goes last. The modules may use the resource
+    bundle in place, so that is unmapped after them
+  */
+  for ( auto it = workers.rbegin(); it != workers.rend(); ++it ){
+    delete *it;
+  }
+  delete resources;
   delete tokenizer;
+  delete sentence_cache;
 }
 
 void FrogAPI::run_on_files(){
-  string outPath = options.outputDirName;
-  string xmlPath = options.xmlDirName;
-
+  /// Run Frog on all files given in options.fileNames
+  /*!
+    When options.numFileWorkers > 1, the files are divided over that number of
+    child processes.
+  */
   if ( options.fileNames.size() > 1 ){
     LOG << "start processing " << options.fileNames.size() << " files..." << endl;
   }
-  for ( auto const& name : options.fileNames ){
-    string testName = options.testDirName + name;
-    if ( !TiCC::isFile( testName ) ){
-      LOG << "skip " << testName << " (file not found )"
-	  << endl;
-      continue;
+  if ( options.numFileWorkers > 1
+       && options.fileNames.size() > 1 ){
+    run_on_files_parallel();
+  }
+  else {
+    for ( auto const& name : options.fileNames ){
+      frog_one_file( name );
     }
-    string outName;
-    if ( outS == 0 ){
-      if ( options.wantOUT ){
-	if ( options.doXMLin ){
-	  if ( !outPath.empty() ){
-	    outName = outPath + name + ".out";
+  }
+  LOG << TiCC::Timer::now() << " Frog finished" << endl;
+}
+
+void FrogAPI::run_on_files_parallel(){
+  /// Run Frog on all files in options.fileNames, using several processes
+  /*!
+    We fork() options.numFileWorkers children, which all share the already
+    loaded models with us. (copy on write) Every child has its own tokenizer,
+    timers and output stream.
+    The children pick the next file to handle from a shared counter, until all
+    files are done.
+    A child never returns into our code: when frogging a file fails, it logs
+    the error, continues with the next file and signals the failure with its
+    exit status. We throw when any of the children failed.
+  */
+  vector<string> names( options.fileNames.begin(), options.fileNames.end() );
+  void *mem = mmap( 0, sizeof(atomic<size_t>),
+		    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+		    -1, 0 );
+  if ( mem == MAP_FAILED ){
+    string err = strerror(errno);
+    throw runtime_error( "mmap failed: " + err );
+  }
+  atomic<size_t> *next_file = new (mem) atomic<size_t>(0);
+  size_t num_children = min<size_t>( options.numFileWorkers, names.size() );
+  LOG << "running " << num_children << " files in parallel" << endl;
+  cout.flush();
+  cerr.flush();
+  vector<pid_t> children;
+  for ( size_t i=0; i < num_children; ++i ){
+    pid_t pid = fork();
+    if ( pid < 0 ){
+      string err = strerror(errno);
+      LOG << "ERROR on fork: " << err << endl;
+      break;
+    }
+    else if ( pid == 0 ){
+#ifdef HAVE_OPENMP
+      // the files are already handled in parallel.
+      omp_set_num_threads( 1 );
+#endif
+      int result = EXIT_SUCCESS;
+      try {
+	size_t index;
+	while ( (index = next_file->fetch_add(1)) < names.size() ){
+	  try {
+	    frog_one_file( names[index] );
+	  }
+	  catch ( const exception& e ){
+	    LOG << "frogging " << names[index] << " failed: " << e.what()
+		<< endl;
+	    result = EXIT_FAILURE;
 	  }
 	}
-	else {
-	  outName = outPath + name + ".out";
-	}
-	if ( options.doRetry && TiCC::isFile( outName ) ){
-	  LOG << "retry, skip: " << outName << " already exists" << endl;
-	  continue;
-	}
-	if ( !TiCC::createPath( outName ) ) {
-	  LOG << "problem frogging: " << name << endl
-	      << "unable to create outputfile: " << outName
-	      << endl;
-	  continue;
-	}
-	outS = new ofstream( outName );
+	cout.flush();
       }
-      else {
-	outS = &cout;
+      catch ( ... ){
+	result = EXIT_FAILURE;
       }
+      // don't run the destructors of our parent's objects
+      _exit( result );
     }
-    string xmlOutName = options.XMLoutFileName;
-    if ( xmlOutName.empty() ){
-      if ( !options.xmlDirName.empty() ){
-	if ( name.rfind(".xml") == string::npos ){
-	  xmlOutName = xmlPath + name + ".xml";
-	}
-	else {
-	  xmlOutName = xmlPath + name;
+    children.push_back( pid );
+  }
+  if ( children.empty() ){
+    // no luck forking. do it ourselves
+    size_t index;
+    while ( (index = next_file->fetch_add(1)) < names.size() ){
+      frog_one_file( names[index] );
+    }
+  }
+  size_t failed = 0;
+  for ( const auto& pid : children ){
+    int status = 0;
+    if ( waitpid( pid, &status, 0 ) < 0 ){
+      string err = strerror(errno);
+      LOG << "waitpid failed for child " << pid << ": " << err << endl;
+      ++failed;
+    }
+    else if ( !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS ){
+      LOG << "child " << pid << " terminated abnormally" << endl;
+      ++failed;
+    }
+  }
+  munmap( mem, sizeof(atomic<size_t>) );
+  if ( failed > 0 ){
+    throw runtime_error( to_string( failed ) + " of the "
+			 + to_string( children.size() )
+			 + " file workers failed" );
+  }
+}
+
+void FrogAPI::frog_one_file( const string& name ){
+  /// Run Frog on one file, taking care of all the output
+  /*!
+    \param name the name of the file. When options.testDirName is set, it is
+    relative to that directory
+
+    Depending on the options, an output file for tabbed or JSON output is
+    created, and/or a FoLiA file is stored.
+    When options.doRetry is set, we skip files that already have output.
+  */
+  string outPath = options.outputDirName;
+  string xmlPath = options.xmlDirName;
+  string testName = options.testDirName + name;
+  if ( !TiCC::isFile( testName ) ){
+    LOG << "skip " << testName << " (file not found )"
+	<< endl;
+    return;
+  }
+  string outName;
+  if ( outS == 0 ){
+    if ( options.wantOUT ){
+      if ( options.doXMLin ){
+	if ( !outPath.empty() ){
+	  outName = outPath + name + ".out";
 	}
       }
-      else if ( options.doXMLout ){
-	xmlOutName = name + ".xml"; // do not clobber the inputdir!
+      else {
+	outName = outPath + name + ".out";
       }
-    }
-    if ( !xmlOutName.empty() ){
-      if ( options.doRetry && TiCC::isFile( xmlOutName ) ){
-	LOG << "retry, skip: " << xmlOutName << " already exists" << endl;
-	continue;
+      if ( options.doRetry && TiCC::isFile( outName ) ){
+	LOG << "retry, skip: " << outName << " already exists" << endl;
+	return;
       }
-      if ( !TiCC::createPath( xmlOutName ) ){
+      if ( !TiCC::createPath( outName ) ) {
 	LOG << "problem frogging: " << name << endl
-	    << "unable to create outputfile: " << xmlOutName
+	    << "unable to create outputfile: " << outName
 	    << endl;
-	continue;
+	return;
+      }
+      outS = new ofstream( outName );
+    }
+    else {
+      outS = &cout;
+    }
+  }
+  string xmlOutName = options.XMLoutFileName;
+  if ( xmlOutName.empty() ){
+    if ( !options.xmlDirName.empty() ){
+      if ( name.rfind(".xml") == string::npos ){
+	xmlOutName = xmlPath + name + ".xml";
       }
       else {
-	remove( xmlOutName.c_str() );
+	xmlOutName = xmlPath + name;
       }
     }
-    LOG << TiCC::Timer::now() << " Frogging " << testName << endl;
-    if ( options.test_API ){
-      run_api_tests( testName );
+    else if ( options.doXMLout ){
+      xmlOutName = name + ".xml"; // do not clobber the inputdir!
+    }
+  }
+  if ( !xmlOutName.empty() ){
+    if ( options.doRetry && TiCC::isFile( xmlOutName ) ){
+      LOG << "retry, skip: " << xmlOutName << " already exists" << endl;
+      return;
+    }
+    if ( !TiCC::createPath( xmlOutName ) ){
+      LOG << "problem frogging: " << name << endl
+	  << "unable to create outputfile: " << xmlOutName
+	  << endl;
+      return;
     }
     else {
-      folia::Document *result = 0;
-      try {
-	result = FrogFile( testName );
-      }
-      catch ( exception& e ){
-	LOG << "problem frogging: " << name << endl
-	    << e.what() << endl;
-	continue;
+      remove( xmlOutName.c_str() );
+    }
+  }
+  LOG << TiCC::Timer::now() << " Frogging " << testName << endl;
+  if ( options.test_API ){
+    run_api_tests( testName );
+  }
+  else {
+    folia::Document *result = 0;
+    try {
+      result = FrogFile( testName );
+    }
+    catch ( exception& e ){
+      LOG << "problem frogging: " << name << endl
+	  << e.what() << endl;
+      return;
+    }
+    if ( !xmlOutName.empty() ){
+      if ( !result ){
+	LOG << "FAILED to create FoLiA: " << xmlOutName << endl;
       }
-      if ( !xmlOutName.empty() ){
-	if ( !result ){
-	  LOG << "FAILED to create FoLiA: " << xmlOutName << endl;
-	}
-	else {
-	  result->save( xmlOutName, options.doKanon );
-	  LOG << "FoLiA stored in " << xmlOutName << endl;
-	  delete result;
-	}
+      else {
+	result->save( xmlOutName, options.doKanon );
+	LOG << "FoLiA stored in " << xmlOutName << endl;
+	delete result;
       }
-      if ( !outName.empty() ){
-	LOG << "results stored in " << outName << endl;
-	if ( outS != &cout ){
-	  delete outS;
-	  outS = 0;
-	}
+    }
+    if ( !outName.empty() ){
+      LOG << "results stored in " << outName << endl;
+      if ( outS != &cout ){
+	delete outS;
+	outS = 0;
       }
-      if ( !options.outputFileName.empty() ){
-	LOG << "results stored in " << options.outputFileName << endl;
-	if ( outS != &cout ){
-	  delete outS;
-	  outS = 0;
-	}
+    }
+    if ( !options.outputFileName.empty() ){
+      LOG << "results stored in " << options.outputFileName << endl;
+      if ( outS != &cout ){
+	delete outS;
+	outS = 0;
       }
     }
   }
-  LOG << TiCC::Timer::now() << " Frog finished" << endl;
 }
 
 static bool StillRunning = true;
@@ -1298,15 +1693,68 @@ void KillServerFun( int Signal ){
   }
 }
 
+void FrogAPI::run_server_worker( Sockets::ServerSocket& server ){
+  /// accept and handle connections, one at a time, until we are terminated
+  /*!
+    \param server the listening socket, shared with the other workers
+
+    This runs in a pre-forked child process, using the modules that were
+    initialized by the parent.
+  */
+  LOG << "server worker " << getpid() << " started" << endl;
+  if ( options.doMultiplex ){
+    Framing framing = Framing::EOT;
+    if ( options.doXMLin ){
+      framing = Framing::EMPTY_LINE;
+    }
+    else if ( options.doJSONin || options.doSentencePerLine ){
+      framing = Framing::LINE;
+    }
+    server_limits limits;
+    limits.max_connections = options.maxConnections;
+    limits.max_request_size = options.maxRequestSize;
+    limits.max_requests = options.maxRequests;
+    limits.busy_reply = error_reply( "server busy, retry later" );
+    limits.too_large_reply = error_reply( "request too large" );
+    EventServer event_server( server.getSockId(),
+			      framing,
+			      [this]( const string& request, string& reply ){
+				return handle_request( request, reply );
+			      },
+			      options.numServerWorkers,
+			      theErrLog,
+			      limits );
+    event_server.run( StillRunning );
+    LOG << "server worker " << getpid() << " terminated" << endl;
+    return;
+  }
+  while ( StillRunning ) {
+    Sockets::ClientSocket conn;
+    if ( server.accept( conn ) ){
+      LOG << "New connection, socketid=" << conn.getSockId()
+	  << " (worker " << getpid() << ")" << endl;
+      FrogServer( conn );
+    }
+    else if ( StillRunning ){
+      LOG << "Accept failed: " << server.getMessage() << endl;
+    }
+  }
+  LOG << "server worker " << getpid() << " terminated" << endl;
+}
+
 bool FrogAPI::run_a_server(){
-  //first set up some things to deal with zombies
-  struct sigaction action;
-  action.sa_handler = SIG_IGN;
-  sigemptyset(&action.sa_mask);
-#ifdef SA_NOCLDWAIT
-  action.sa_flags = SA_NOCLDWAIT;
-#endif
-  sigaction(SIGCHLD, &action, NULL);
+  /// run Frog as a TCP server on options.listenport
+  /*!
+    A pool of options.numServerWorkers processes is forked once. They share
+    the listening socket and the already initialized modules. Workers that die
+    are replaced. On SIGTERM the whole pool is terminated.
+
+    With --multiplex, the pool holds 1 event loop, which forks the
+    options.numServerWorkers analysis processes itself. Otherwise every pool
+    process counts its requests in its own slot of a shared table, to enforce
+    options.maxRequests. When a process dies, its slot is cleared before it is
+    handed to the replacement, so a crash can't leak requests.
+  */
   struct sigaction act;
   sigaction( SIGTERM, NULL, &act ); // get current action
   act.sa_handler = KillServerFun;
@@ -1316,41 +1764,104 @@ bool FrogAPI::run_a_server(){
   srand((unsigned)time(0));
   LOG << "Listening on port " << options.listenport << "\n";
 
+  size_t pool_size = options.doMultiplex ? 1 : options.numServerWorkers;
   try {
     // Create the socket
     Sockets::ServerSocket server;
     if ( !server.connect( options.listenport ) ){
       throw( runtime_error( "starting server on port " + options.listenport + " failed" ) );
     }
-    if ( !server.listen( 5 ) ) {
-      // maximum of 5 pending requests
-      throw( runtime_error( "listen(5) failed" ) );
+    if ( !server.listen( options.listenBacklog ) ) {
+      // maximum of pending requests. The kernel refuses the rest
+      throw( runtime_error( "listen(" + TiCC::toString(options.listenBacklog)
+			    + ") failed" ) );
+    }
+    if ( !options.doMultiplex && options.maxRequests > 0 ){
+      void *mem = mmap( 0, pool_size * sizeof(atomic<size_t>),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+			-1, 0 );
+      if ( mem == MAP_FAILED ){
+	string err = strerror(errno);
+	throw runtime_error( "mmap failed: " + err );
+      }
+      activeRequests = static_cast<atomic<size_t>*>( mem );
+      for ( size_t i=0; i < pool_size; ++i ){
+	new ( &activeRequests[i] ) atomic<size_t>(0);
+      }
+    }
+    LOG << "starting a pool of " << pool_size << " server workers" << endl;
+    map<pid_t,size_t> pool; // the slot in activeRequests of every process
+    set<size_t> free_slots;
+    for ( size_t i=0; i < pool_size; ++i ){
+      free_slots.insert( i );
     }
     while ( StillRunning ) {
-      Sockets::ClientSocket conn;
-      if ( server.accept( conn ) ){
-	LOG << "New connection, socketid=" << conn.getSockId() << endl;
-	int pid = fork();
-	if (pid < 0) {
+      while ( StillRunning
+	      && pool.size() < pool_size ){
+	size_t slot = *free_slots.begin();
+	pid_t pid = fork();
+	if ( pid < 0 ) {
 	  string err = strerror(errno);
 	  LOG << "ERROR on fork: " << err << endl;
-	  throw runtime_error( "FORK failed: " + err );
+	  if ( pool.empty() ){
+	    throw runtime_error( "FORK failed: " + err );
+	  }
+	  break; // try again when one of the others is gone
 	}
-	else if (pid == 0)  {
-	  FrogServer( conn );
+	else if ( pid == 0 ) {
+	  requestSlot = slot;
+	  run_server_worker( server );
 	  return true;
 	}
+	pool[pid] = slot;
+	free_slots.erase( slot );
       }
-      else {
-	throw( runtime_error( "Accept failed" ) );
+      int status = 0;
+      pid_t pid = waitpid( -1, &status, 0 );
+      if ( pid > 0 ){
+	auto it = pool.find( pid );
+	if ( it != pool.end() ){
+	  if ( activeRequests && activeRequests[it->second] > 0 ){
+	    LOG << "server worker " << pid << " died with "
+		<< activeRequests[it->second] << " active request(s)" << endl;
+	    activeRequests[it->second] = 0;
+	  }
+	  free_slots.insert( it->second );
+	  pool.erase( it );
+	}
+	if ( StillRunning ){
+	  LOG << "server worker " << pid << " died unexpectedly. restarting"
+	      << endl;
+	  if ( !WIFEXITED(status) || WEXITSTATUS(status) != 0 ){
+	    sleep(1); // don't go wild when workers keep failing
+	  }
+	}
+      }
+      else if ( errno != EINTR ){
+	string err = strerror(errno);
+	throw runtime_error( "waiting for server workers failed: " + err );
       }
     }
+    for ( const auto& it : pool ){
+      kill( it.first, SIGTERM );
+    }
+    for ( const auto& it : pool ){
+      waitpid( it.first, NULL, 0 );
+    }
     LOG << TiCC::Timer::now() << " server terminated by SIGTERM" << endl;
   }
   catch ( exception& e ) {
     LOG << "Server error:" << e.what() << " Exiting." << endl;
+    if ( activeRequests ){
+      munmap( activeRequests, pool_size * sizeof(atomic<size_t>) );
+      activeRequests = 0;
+    }
     throw;
   }
+  if ( activeRequests ){
+    munmap( activeRequests, pool_size * sizeof(atomic<size_t>) );
+    activeRequests = 0;
+  }
   return true;
 }
 
@@ -1616,6 +2127,243 @@ void FrogAPI::append_to_words( const vector<folia::Word*>& wv,
   }
 }
 
+string FrogAPI::error_reply( const string& message ) const {
+  /// create a reply for a client we can't serve
+  /*!
+    \param message the reason
+    \return a JSON object when JSON output is wanted, otherwise an ERROR line
+    followed by the usual READY marker
+  */
+  if ( options.doJSONout ){
+    json err;
+    err["error"] = message;
+    return err.dump() + "\n";
+  }
+  return "ERROR: " + message + "\nREADY\n\n";
+}
+
+bool FrogAPI::handle_request( const string& request, string& reply ){
+  /// handle 1 complete request, as received by a server
+  /*!
+    \param request the received data. Depending on the Frog settings this is
+    (a part of) a FoLiA document, 1 line of JSON or a block of text
+    \param reply the output to send back to the client
+    \return false when the client signals it is done, and the connection
+    should be closed
+
+    This will throw on invalid input.
+  */
+  ostringstream output_stream;
+  if ( options.doXMLin ){
+    if ( request.size() < 50 ){
+      // a FoLia doc must be at least a few 100 bytes
+      // so this is clearly wrong. Just bail out
+      throw( runtime_error( "read garbage" ) );
+    }
+    if ( options.debugFlag > 5 ){
+      DBG << "received data [" << request << "]" << endl;
+    }
+    TiCC::tmp_stream ts( "frog" );
+    ts.os() << request << endl;
+    ts.close();
+    folia::Document *xml = run_folia_engine( ts.tmp_name(), output_stream );
+    if ( xml && options.doXMLout ){
+      xml->set_canonical(options.doKanon);
+      output_stream << xml;
+      delete xml;
+    }
+    LOG << "Done Processing XML... " << endl;
+  }
+  else if ( options.doJSONin ){
+    if ( options.debugFlag > 5 ){
+      DBG << "JSON read line: " << request << endl;
+    }
+    if ( request.empty() ){
+      // assume we are done
+      if ( options.debugFlag > 5 ){
+	DBG << "Done with processing JSON. exit" << endl;
+      }
+      LOG << "Done with JSON" << endl;
+      return false;
+    }
+    json the_json;
+    try {
+      the_json = json::parse( request );
+    }
+    catch ( const exception& e ){
+      cerr << "json parsing failed on '" << request + "':"
+	   << e.what() << endl;
+      throw runtime_error( "json failure" );
+    }
+    if ( options.debugFlag ){
+      DBG << "Parsed JSON: " << the_json << endl;
+    }
+    for ( const auto& it : the_json ){
+      UnicodeString data = TiCC::UnicodeFromUTF8(it["sentence"]);
+      timers.tokTimer.start();
+      vector<Tokenizer::Token> toks = tokenizer->tokenize_line( data );
+      timers.tokTimer.stop();
+      while ( toks.size() > 0 ){
+	frog_data sent = frog_sentence( toks, 1 );
+	show_results( output_stream, sent );
+	timers.tokTimer.start();
+	toks = tokenizer->tokenize_next();
+	timers.tokTimer.stop();
+      }
+    }
+  }
+  else {
+    // So request will contain the COMPLETE input,
+    // OR a sequence of lines, forming sentences and paragraphs
+    if ( options.debugFlag > 5 ){
+      DBG << "Received: [" << request << "]" << endl;
+    }
+    LOG << TiCC::Timer::now() << " Processing... " << endl;
+    folia::Document *doc = 0;
+    folia::FoliaElement *root = 0;
+    unsigned int par_count = 0;
+    if ( options.doXMLout ){
+      string doc_id = options.docid;
+      if ( doc_id.empty() ){
+	doc_id = "untitled";
+      }
+      root = start_document( doc_id, doc );
+    }
+    timers.tokTimer.start();
+    // start tokenizing
+    // tokenize_data() delivers the first sentence, call
+    //  tokenize_next() multiple times to get all sentences!
+    vector<Tokenizer::Token> toks = tokenizer->tokenize_data( request );
+    timers.tokTimer.stop();
+    while ( toks.size() > 0 ){
+      frog_data sent = frog_sentence( toks, 1 );
+      if ( options.doXMLout ){
+	root = append_to_folia( root, sent, par_count );
+      }
+      else {
+	show_results( output_stream, sent );
+      }
+      timers.tokTimer.start();
+      toks = tokenizer->tokenize_next();
+      timers.tokTimer.stop();
+    }
+    if ( options.doXMLout && doc ){
+      doc->set_canonical(options.doKanon);
+      output_stream << doc;
+      delete doc;
+    }
+  }
+  reply = output_stream.str();
+  if ( options.doJSONout ){
+    if ( options.debugFlag > 10 ){
+      LOG << "JSON:" << reply << endl;
+    }
+  }
+  else {
+    reply += "READY\n\n";
+  }
+  return true;
+}
+
+/// \brief reads lines from a blocking socket in chunks, holding at most a
+/// given number of bytes of an unfinished line
+class line_reader {
+public:
+  explicit line_reader( int fd ):
+    _fd( fd ), _start( 0 ), _scan( 0 ), _eof( false ), _too_large( false ) {};
+  bool read_line( string&, size_t );
+  bool too_large() const { return _too_large; };
+private:
+  int _fd;                   ///< the socket
+  string _buf;               ///< received bytes, not yet returned
+  string::size_type _start;  ///< the start of the next line in _buf
+  string::size_type _scan;   ///< _buf is searched for a newline up to here
+  bool _eof;                 ///< did the client close its side?
+  bool _too_large;           ///< did the last line exceed the limit?
+};
+
+bool line_reader::read_line( string& line, size_t max_size ){
+  /// get the next line, reading more data when needed
+  /*!
+    \param line the line found, without the newline
+    \param max_size the maximum size of the line. 0 means no limit
+    \return false at the end of the input, on errors and when the line
+    exceeds max_size. Use too_large() to tell the last case
+
+    We never read more than max_size+1 bytes of an unfinished line
+  */
+  line.clear();
+  while ( true ){
+    string::size_type pos = _buf.find( '\n', max( _start, _scan ) );
+    if ( pos != string::npos ){
+      if ( max_size > 0 && pos - _start > max_size ){
+	_too_large = true;
+	return false;
+      }
+      line = _buf.substr( _start, pos - _start );
+      _start = pos + 1;
+      if ( !line.empty() && line.back() == '\r' ){
+	line.pop_back();
+      }
+      return true;
+    }
+    _scan = _buf.size();
+    if ( max_size > 0 && _buf.size() - _start > max_size ){
+      _too_large = true;
+      return false;
+    }
+    if ( _eof ){
+      if ( _start < _buf.size() ){
+	// a last line without a newline
+	line = _buf.substr( _start );
+	_start = _buf.size();
+	return true;
+      }
+      return false;
+    }
+    _buf.erase( 0, _start );
+    _scan -= _start;
+    _start = 0;
+    size_t room = 65536;
+    if ( max_size > 0 ){
+      room = min( room, max_size + 1 - _buf.size() );
+    }
+    size_t old_size = _buf.size();
+    _buf.resize( old_size + room );
+    ssize_t len = recv( _fd, &_buf[old_size], room, 0 );
+    _buf.resize( old_size + max<ssize_t>( len, 0 ) );
+    if ( len == 0 ){
+      _eof = true;
+    }
+    else if ( len < 0
+	      && ( errno != EINTR || !StillRunning ) ){
+      return false;
+    }
+  }
+}
+
+bool FrogAPI::claim_request(){
+  /// try to add a request to our slot in activeRequests
+  /*!
+    \return true when the request may be handled, false when that would
+    exceed options.maxRequests. Our slot is unchanged then.
+
+    We add to our own slot first, and only then count all slots. When two
+    processes race, both may refuse, but they can never both accept beyond
+    the limit.
+  */
+  ++activeRequests[requestSlot];
+  size_t active = 0;
+  for ( int i=0; i < options.numServerWorkers; ++i ){
+    active += activeRequests[i];
+  }
+  if ( active > options.maxRequests ){
+    --activeRequests[requestSlot];
+    return false;
+  }
+  return true;
+}
+
 void FrogAPI::FrogServer( Sockets::ClientSocket &conn ){
   /// Run a server
   /*!
@@ -1624,168 +2372,84 @@ void FrogAPI::FrogServer( Sockets::ClientSocket &conn ){
     The 'conn' object should be correctly set up using the right parameters.
     Depending on the Frog settings we can serve text, FoLiA and JSON.
     At the moment only TCP connections are supported.
+
+    The input is read in chunks, so a request larger than
+    options.maxRequestSize is refused before it is read completely.
+    When options.maxRequests requests are already being analyzed by the
+    server processes, the request gets a 'busy' reply.
   */
+  const size_t max_size = options.maxRequestSize;
+  line_reader reader( conn.getSockId() );
   try {
     while ( conn.isValid() ) {
-      ostringstream output_stream;
+      string request;
       if ( options.doXMLin ){
-        string result;
-        string s;
-        while ( conn.read(s) ){
-	  result += s + "\n";
-	  if ( s.empty() ){
+	string s;
+	while ( reader.read_line( s, max_size ) ){
+	  request += s + "\n";
+	  if ( s.empty()
+	       || ( max_size > 0 && request.size() > max_size ) ){
 	    break;
 	  }
-        }
-        if ( result.size() < 50 ){
-	  // a FoLia doc must be at least a few 100 bytes
-	  // so this is clearly wrong. Just bail out
-	  throw( runtime_error( "read garbage" ) );
-        }
-        if ( options.debugFlag > 5 ){
-	  DBG << "received data [" << result << "]" << endl;
 	}
-	TiCC::tmp_stream ts( "frog" );
-	ts.os() << result << endl;
-	ts.close();
-	folia::Document *xml = run_folia_engine( ts.tmp_name(), output_stream );
-	if ( xml && options.doXMLout ){
-	  xml->set_canonical(options.doKanon);
-	  output_stream << xml;
-	  delete xml;
-	}
-	LOG << "Done Processing XML... " << endl;
       }
-      else if ( options.doJSONin ){
-	json the_json;
-	string json_line;
+      else if ( options.doJSONin
+		|| options.doSentencePerLine ){
 	// read data from the connection
-	if ( !conn.read( json_line ) ){
-	  throw( runtime_error( "read failed: '" + json_line + "' (" +
-				conn.getMessage() + ")" ) );
-	}
-        if ( options.debugFlag > 5 ){
-	  DBG << "JSON read line: " << json_line << endl;
-	}
-	if ( json_line.empty() ){
-	  // assume we are done
-	  if ( options.debugFlag > 5 ){
-	    DBG << "Done with processing JSON. exit" << endl;
-	  }
-	  LOG << "Done with JSON" << endl;
-	  return; // closes this connection
-	}
-	else {
-	  try {
-	    the_json = json::parse( json_line );
-	  }
-	  catch ( const exception& e ){
-	    cerr << "json parsing failed on '" << json_line + "':"
-		 << e.what() << endl;
-	    throw runtime_error( "json failure" );
-	  }
-	  if ( options.debugFlag ){
-	    DBG << "Parsed JSON: " << the_json << endl;
-	  }
-	  for ( const auto& it : the_json ){
-	    UnicodeString data = TiCC::UnicodeFromUTF8(it["sentence"]);
-	    timers.tokTimer.start();
-	    vector<Tokenizer::Token> toks = tokenizer->tokenize_line( data );
-	    timers.tokTimer.stop();
-	    while ( toks.size() > 0 ){
-	      frog_data sent = frog_sentence( toks, 1 );
-	      show_results( output_stream, sent );
-	      timers.tokTimer.start();
-	      toks = tokenizer->tokenize_next();
-	      timers.tokTimer.stop();
-	    }
-	  }
+	if ( !reader.read_line( request, max_size )
+	     && !reader.too_large() ){
+	  throw( runtime_error( "read failed: '" + request + "'" ) );
 	}
       }
       else {
-        string data = "";
-        if ( options.doSentencePerLine ){
-	  if ( !conn.read( data ) ){
-	    //read data from client
-	    throw( runtime_error( "read failed" ) );
-	  }
-	}
-        else {
-	  string line;
-	  while( conn.read(line) ){
-	    if ( line == "EOT" ){
-	      break;
-	    }
-	    data += line + "\n";
-	  }
-        }
-	// So data will contain the COMPLETE input,
-	// OR a FoLiA Document (which should be valid)
-	// OR a sequence of lines, forming sentences and paragraphs
-        if ( options.debugFlag > 5 ){
-	  DBG << "Received: [" << data << "]" << endl;
-	}
-        LOG << TiCC::Timer::now() << " Processing... " << endl;
-	folia::Document *doc = 0;
-	folia::FoliaElement *root = 0;
-	unsigned int par_count = 0;
-	if ( options.doXMLout ){
-	  string doc_id = options.docid;
-	  if ( doc_id.empty() ){
-	    doc_id = "untitled";
-	  }
-	  root = start_document( doc_id, doc );
-	}
-	timers.tokTimer.start();
-	// start tokenizing
-	// tokenize_data() delivers the first sentence, call
-	//  tokenize_next() multiple times to get all sentences!
-	vector<Tokenizer::Token> toks = tokenizer->tokenize_data( data );
-	timers.tokTimer.stop();
-	while ( toks.size() > 0 ){
-	  frog_data sent = frog_sentence( toks, 1 );
-	  if ( options.doXMLout ){
-	    root = append_to_folia( root, sent, par_count );
-	  }
-	  else {
-	    show_results( output_stream, sent );
-	  }
-	  timers.tokTimer.start();
-	  toks = tokenizer->tokenize_next();
-	  timers.tokTimer.stop();
-	}
-	if ( options.doXMLout && doc ){
-	  doc->set_canonical(options.doKanon);
-	  output_stream << doc;
-	  delete doc;
+	string line;
+	while ( reader.read_line( line, max_size ) ){
+	  if ( line == "EOT" ){
+	    break;
+	  }
+	  request += line + "\n";
+	  if ( max_size > 0 && request.size() > max_size ){
+	    break;
+	  }
 	}
-	//	DBG << "Done Processing... " << endl;
       }
-      if ( options.doJSONout ){
-        if ( options.debugFlag > 5 ){
-	  LOG << "start JSON output:"<< endl;
-	}
-        if ( options.debugFlag > 10 ){
-	  LOG << "JSON:" << output_stream.str() << endl;
-	}
-	if (!conn.write( output_stream.str() ) ){
-	  if (options.debugFlag > 5 ) {
-	    DBG << "socket " << conn.getMessage() << endl;
-	  }
-	  throw ( runtime_error( "JSON write to client failed: "
+      if ( reader.too_large()
+	   || ( max_size > 0 && request.size() > max_size ) ){
+	LOG << "request exceeds " << max_size << " bytes" << endl;
+	conn.write( error_reply( "request too large" ) );
+	break;
+      }
+      if ( activeRequests && !claim_request() ){
+	LOG << "too many requests, refusing one" << endl;
+	if ( !conn.write( error_reply( "server busy, retry later" ) ) ){
+	  throw ( runtime_error( "write to client failed: "
 				 + conn.getMessage() ) );
 	}
-        if ( options.debugFlag > 5 ){
-	  LOG << "done with JSON output" << endl;
+	continue;
+      }
+      string reply;
+      bool keep_open = false;
+      try {
+	keep_open = handle_request( request, reply );
+      }
+      catch ( ... ){
+	if ( activeRequests ){
+	  --activeRequests[requestSlot];
 	}
+	throw;
       }
-      else if ( !conn.write( output_stream.str() )
-		|| !(conn.write("READY\n\n"))  ){
+      if ( activeRequests ){
+	--activeRequests[requestSlot];
+      }
+      if ( !keep_open ){
+	return; // closes this connection
+      }
+      if ( !conn.write( reply ) ){
 	if (options.debugFlag > 5 ) {
 	  DBG << "socket " << conn.getMessage() << endl;
 	}
-	throw ( runtime_error( "write to client failed" +
-			       conn.getMessage() ) );
+	throw ( runtime_error( "write to client failed: "
+			       + conn.getMessage() ) );
       }
     }
   }
@@ -1985,30 +2649,32 @@ string FrogAPI::Frogtostringfromfile( const string& infilename ){
   return ss.str();
 }
 
-frog_data extract_fd( vector<Tokenizer::Token>& tokens,
+frog_data extract_fd( token_cursor& cursor,
 		      bool no_eos ){
   /// extract a frog_data structure from a list of Tokens
   /*!
-    \param tokens a list of Tokenizer::Token
+    \param cursor a cursor on a list of Tokenizer::Token
     \param no_eos if true, ignore ENDOFSENTENCE marks, and read on
     \return the new frog_data structure
 
     The tokens list may span multiple sentences and paragraphs; this function
     will return the data for a single sentence and must be called multiple times
-    until the whole list is consumed.
+    until the cursor is done.
+
+    The text of the consumed tokens is moved into the result, so those
+    tokens are left without text.
    */
   frog_data result;
   int quotelevel = 0;
-  while ( !tokens.empty() ){
-    const auto tok = tokens.front();
-    tokens.erase(tokens.begin());
-    frog_record tmp;
-    tmp.word = tok.us;
-    tmp.token_class = tok.type;
+  while ( !cursor.done() ){
+    Tokenizer::Token& tok = cursor.next();
+    result.units.emplace_back();
+    frog_record& tmp = result.units.back();
+    tmp.word = std::move( tok.us );
+    tmp.token_class = symbol( tok.type );
     tmp.no_space = (tok.role & Tokenizer::TokenRole::NOSPACE);
-    tmp.language = tok.lang_code;
+    tmp.language = std::move( tok.lang_code );
     tmp.new_paragraph = (tok.role & Tokenizer::TokenRole::NEWPARAGRAPH);
-    result.units.push_back( tmp );
     if ( (tok.role & Tokenizer::TokenRole::BEGINQUOTE) ){
       ++quotelevel;
     }
@@ -2028,6 +2694,23 @@ frog_data extract_fd( vector<Tokenizer::Token>& tokens,
   return result;
 }
 
+frog_data extract_fd( vector<Tokenizer::Token>& tokens,
+		      bool no_eos ){
+  /// extract a frog_data structure from a list of Tokens
+  /*!
+    \param tokens a list of Tokenizer::Token
+    \param no_eos if true, ignore ENDOFSENTENCE marks, and read on
+    \return the new frog_data structure
+
+    The consumed tokens are removed from the list in one go. To extract
+    several sentences from one long list, use a token_cursor.
+   */
+  token_cursor cursor( tokens );
+  frog_data result = extract_fd( cursor, no_eos );
+  tokens.erase( tokens.begin(), tokens.begin() + cursor.position() );
+  return result;
+}
+
 frog_data FrogAPI::frog_sentence( vector<Tokenizer::Token>& sent,
 				  const size_t s_count,
 				  bool no_eos ){
@@ -2051,10 +2734,76 @@ frog_data FrogAPI::frog_sentence( vector<Tokenizer::Token>& sent,
   if ( options.debugFlag > 0 ){
     DBG << "tokens:\n" << sent << endl;
   }
-  frog_data sentence = extract_fd( sent, no_eos );
+  token_cursor cursor( sent );
+  frog_data sentence = frog_sentence( cursor, s_count, no_eos );
+  sent.erase( sent.begin(), sent.begin() + cursor.position() );
+  return sentence;
+}
+
+frog_data FrogAPI::frog_sentence( token_cursor& cursor,
+				  const size_t s_count,
+				  bool no_eos ){
+  /// extract and frog the next sentence from a token_cursor
+  /*!
+    \param cursor a cursor on a list of Tokenizer::Token
+    \param s_count holds the sentence count
+    \param no_eos if true, process all remaining tokens, ignoring
+    ENDOFSENTENCE marks
+    \return a frog_data structure representing 1 totally frogged sentence.
+
+    Like the vector version, but the list isn't modified, so it should be
+    called until the cursor is done.
+  */
+  frog_data sentence = extract_fd( cursor, no_eos );
   if ( options.debugFlag > 0 ){
     DBG << "sentence:\n" << sentence << endl;
   }
+  if ( wanted_language( sentence, s_count ) ){
+    analyze_sentence( sentence, s_count, *workers[0] );
+  }
+  return sentence;
+}
+
+vector<frog_data> FrogAPI::frog_sentences( vector<vector<Tokenizer::Token>>& batch,
+					   const size_t s_count ){
+  /// Frog a batch of tokenized sentences
+  /*!
+    \param batch a list of Tokenizer::Token lists, each holding 1 sentence
+    \param s_count the sentence count of the first sentence in the batch
+    \return a list of frog_data structures, 1 for every entry in \e batch
+
+    Unlike frog_sentence(), every module is run on the whole batch, before the
+    next module is started. This saves the per call overhead of the modules
+    and keeps their models 'hot'.
+  */
+  vector<frog_data> result;
+  result.reserve( batch.size() );
+  vector<pair<frog_data*,size_t>> to_do;
+  for ( auto& toks : batch ){
+    if ( options.debugFlag > 0 ){
+      DBG << "tokens:\n" << toks << endl;
+    }
+    result.push_back( extract_fd( toks, false ) );
+  }
+  // only now 'result' is stable, so we can take pointers into it
+  for ( size_t i=0; i < result.size(); ++i ){
+    if ( wanted_language( result[i], s_count+i ) ){
+      to_do.push_back( make_pair( &result[i], s_count+i ) );
+    }
+  }
+  analyze_sentences( to_do, *workers[0] );
+  return result;
+}
+
+bool FrogAPI::wanted_language( const frog_data& sentence,
+			       const size_t s_count ) const {
+  /// check if the language of a sentence is the one we can handle
+  /*!
+    \param sentence the frog_data to check
+    \param s_count holds the sentence count
+    \return false when the tokenizer detected another language then the
+    default language
+  */
   string lan = sentence.get_language();
   string def_lang = tokenizer->default_language();
   if ( options.debugFlag > 0 ){
@@ -2070,143 +2819,324 @@ frog_data FrogAPI::frog_sentence( vector<Tokenizer::Token>& sent,
       DBG << "skipping sentence " << s_count << " (different language: " << lan
 	   << " --language=" << def_lang << ")" << endl;
     }
-    return sentence;
+    return false;
   }
-  else {
-    timers.frogTimer.start();
-    if ( options.debugFlag > 5 ){
-      DBG << "Frogging sentence:\n" << sentence << endl;
-      DBG << "tokenized text = " << sentence.sentence() << endl;
+  return true;
+}
+
+void FrogAPI::analyze_sentence( frog_data& sentence,
+				const size_t s_count,
+				FrogWorker& worker ){
+  /// run all enabled modules on one sentence
+  /*!
+    \param sentence the frog_data to analyze. It will be extended with the
+    results
+    \param s_count holds the sentence count
+    \param worker the FrogWorker with the modules and timers to use
+
+    It is safe to call this function from several threads at the same time, as
+    long as every thread uses its own \e worker
+  */
+  vector<pair<frog_data*,size_t>> batch( 1, make_pair( &sentence, s_count ) );
+  analyze_sentences( batch, worker );
+}
+
+frog_data copy_sentence( const frog_data& fd, TiCC::LogStream& log ){
+  /// make a deep copy of a frog_data structure
+  /*!
+    \param fd the frog_data to copy
+    \param log the LogStream for the copied morpheme structures
+    \return the copy
+
+    A copied frog_record shares the morpheme structures of the original,
+    and will delete them. So we give the copy clones of its own.
+  */
+  frog_data result = fd;
+  for ( auto& rec : result.units ){
+    for ( auto& br : rec.morph_structure ){
+      br = br->clone( log );
     }
-    bool all_well = true;
-    string exs;
-    timers.tagTimer.start();
-    try {
-      myCGNTagger->Classify( sentence );
+  }
+  for ( auto& rec : result.mw_units ){
+    for ( auto& br : rec.morph_structure ){
+      br = br->clone( log );
     }
-    catch ( exception&e ){
-      all_well = false;
-      exs += string(e.what()) + " ";
+  }
+  return result;
+}
+
+size_t approx_size( const frog_data& fd ){
+  /// estimate the memory used by a frog_data structure
+  /*!
+    \param fd the frog_data
+    \return an estimate of the size in bytes
+  */
+  size_t result = sizeof( frog_data ) + fd.mwus.size() * 48;
+  for ( const auto *recs : { &fd.units, &fd.mw_units } ){
+    for ( const auto& rec : *recs ){
+      result += sizeof( frog_record )
+	+ 2 * ( rec.word.length() + rec.clean_word.length()
+		+ rec.morph_string.length() + rec.mwu_tag.length()
+		+ rec.mwu_ner_tag.length() + rec.mwu_iob_tag.length() )
+	+ rec.language.size() + rec.compound_string.size()
+	+ rec.morph_structure.size() * 256
+	+ rec.parts.size() * 40;
+      for ( const auto& lemma : rec.lemmas ){
+	result += sizeof( UnicodeString ) + 2 * lemma.length();
+      }
     }
-    timers.tagTimer.stop();
-    if ( !all_well ){
-      throw runtime_error( exs );
+  }
+  return result;
+}
+
+string FrogAPI::sentence_key( const frog_data& fd ) const {
+  /// create the key for the sentence cache
+  /*!
+    \param fd the frog_data of a tokenized sentence
+    \return a key holding the modules and options used, and everything the
+    tokenizer gave us
+  */
+  string result;
+  result += options.doTagger ? "T" : "-";
+  result += options.doLemma ? "L" : "-";
+  result += options.doMbma ? "M" : "-";
+  result += options.doDeepMorph ? "D" : "-";
+  result += options.doCompounds ? "C" : "-";
+  result += options.doMwu ? "W" : "-";
+  result += options.doIOB ? "I" : "-";
+  result += options.doNER ? "N" : "-";
+  result += options.doParse ? "P" : "-";
+  result += options.doAlpino ? "A" : "-";
+  result += to_string( options.maxParserTokens ) + "\n";
+  for ( const auto& rec : fd.units ){
+    result += TiCC::UnicodeToUTF8( rec.word ) + "\t"
+      + TiCC::UnicodeToUTF8( rec.token_class ) + "\t"
+      + rec.language + "\t"
+      + ( rec.no_space ? "1" : "0" )
+      + ( rec.new_paragraph ? "1" : "0" ) + "\n";
+  }
+  return result;
+}
+
+void FrogAPI::analyze_sentences( const vector<pair<frog_data*,size_t>>& batch,
+				 FrogWorker& worker ){
+  /// run all enabled modules on a batch of sentences
+  /*!
+    \param batch a list of frog_data structures to analyze, together with
+    their sentence count. They will be extended with the results
+    \param worker the FrogWorker with the modules and timers to use
+
+    When the sentence cache is enabled, sentences that were analyzed before
+    are copied from the cache, and only the others are analyzed.
+
+    It is safe to call this function from several threads at the same time, as
+    long as every thread uses its own \e worker
+  */
+  if ( !sentence_cache ){
+    run_modules( batch, worker );
+    return;
+  }
+  vector<pair<frog_data*,size_t>> to_do;
+  vector<string> keys;
+  for ( const auto& it : batch ){
+    string key = sentence_key( *it.first );
+    shared_ptr<const frog_data> done;
+    if ( sentence_cache->lookup( key, done ) ){
+      *it.first = copy_sentence( *done, *theDbgLog );
     }
-    for ( auto& word : sentence.units ) {
-#pragma omp parallel sections
-      {
-	// Lemmatization and Mophological analysis can be done in parallel
-	// per word
+    else {
+      to_do.push_back( it );
+      keys.push_back( key );
+    }
+  }
+  run_modules( to_do, worker );
+  for ( size_t i=0; i < to_do.size(); ++i ){
+    shared_ptr<const frog_data> done
+      = make_shared<const frog_data>( copy_sentence( *to_do[i].first,
+						     *theDbgLog ) );
+    sentence_cache->store( keys[i], done,
+			   keys[i].size() + approx_size( *done ) );
+  }
+}
+
+void FrogAPI::run_modules( const vector<pair<frog_data*,size_t>>& batch,
+			   FrogWorker& worker ){
+  /// run all enabled modules on a batch of sentences
+  /*!
+    \param batch a list of frog_data structures to analyze, together with
+    their sentence count. They will be extended with the results
+    \param worker the FrogWorker with the modules and timers to use
+
+    Every module handles the whole batch before the next one is started.
+    The MBT taggers get the whole batch in one call.
+  */
+  if ( batch.empty() ){
+    return;
+  }
+  worker.timers.frogTimer.start();
+  if ( options.debugFlag > 5 ){
+    for ( const auto& [sentence,s_count] : batch ){
+      DBG << "Frogging sentence " << s_count << ":\n" << *sentence << endl;
+      DBG << "tokenized text = " << sentence->sentence() << endl;
+    }
+  }
+  bool all_well = true;
+  string exs;
+  vector<frog_data*> sentences;
+  sentences.reserve( batch.size() );
+  for ( const auto& it : batch ){
+    sentences.push_back( it.first );
+  }
+  worker.timers.tagTimer.start();
+  try {
+    worker.myCGNTagger->Classify( sentences );
+  }
+  catch ( exception&e ){
+    all_well = false;
+    exs += string(e.what()) + " ";
+  }
+  worker.timers.tagTimer.stop();
+  if ( !all_well ){
+    worker.timers.frogTimer.stop();
+    throw runtime_error( exs );
+  }
+  vector<frog_record*> words;
+  for ( const auto& it : batch ){
+    for ( auto& word : it.first->units ) {
+      words.push_back( &word );
+    }
+  }
+#ifdef HAVE_OPENMP
+  // with remote modules, we want all their requests in flight at once,
+  // even when OpenMP would give us fewer threads
+  const int stage_threads = max<int>( omp_get_max_threads(),
+				      worker.remote_modules() );
+#pragma omp parallel sections num_threads( stage_threads )
+#endif
+  {
+    // Lemmatization, Mophological analysis, NER and IOB tagging only depend
+    // on the tagger results, so they can be done in parallel
 #pragma omp section
-	{
-	  if ( options.doMbma ){
-	    timers.mbmaTimer.start();
-	    if (options.debugFlag > 1){
-	      DBG << "Calling mbma..." << endl;
-	    }
-	    try {
-	      myMbma->Classify( word );
-	    }
-	    catch ( exception& e ){
-	      all_well = false;
-	      exs += string(e.what()) + " ";
-	    }
-	    timers.mbmaTimer.stop();
+    {
+      if ( options.doMbma ){
+	worker.timers.mbmaTimer.start();
+	if (options.debugFlag > 1){
+	  DBG << "Calling mbma..." << endl;
+	}
+	try {
+	  worker.myMbma->Classify( words );
+	}
+	catch ( exception& e ){
+#pragma omp critical (analyze_errors)
+	  {
+	    all_well = false;
+	    exs += string(e.what()) + " ";
 	  }
 	}
+	worker.timers.mbmaTimer.stop();
+      }
+    }
 #pragma omp section
-	{
-	  if ( options.doLemma ){
-	    timers.mblemTimer.start();
-	    if (options.debugFlag > 1) {
-	      DBG << "Calling mblem..." << endl;
-	    }
-	    try {
-	      myMblem->Classify( word );
-	    }
-	    catch ( exception&e ){
-	      all_well = false;
-	      exs += string(e.what()) + " ";
-	    }
-	    timers.mblemTimer.stop();
+    {
+      if ( options.doLemma ){
+	worker.timers.mblemTimer.start();
+	if (options.debugFlag > 1) {
+	  DBG << "Calling mblem..." << endl;
+	}
+	try {
+	  worker.myMblem->Classify( words );
+	}
+	catch ( exception&e ){
+#pragma omp critical (analyze_errors)
+	  {
+	    all_well = false;
+	    exs += string(e.what()) + " ";
 	  }
 	}
-      } // omp parallel sections
-    } //for all words
-    if ( !all_well ){
-      throw runtime_error( exs );
+	worker.timers.mblemTimer.stop();
+      }
     }
-    //    cout << endl;
-#pragma omp parallel sections
-    {
-      // NER and IOB tagging can be done in parallel, per Sentence
 #pragma omp section
-      {
-	if ( options.doNER ){
-	  timers.nerTimer.start();
-	  if (options.debugFlag > 1) {
-	    DBG << "Calling NER..." << endl;
-	  }
-	  try {
-	    myNERTagger->Classify( sentence );
-	  }
-	  catch ( exception&e ){
+    {
+      if ( options.doNER ){
+	worker.timers.nerTimer.start();
+	if (options.debugFlag > 1) {
+	  DBG << "Calling NER..." << endl;
+	}
+	try {
+	  worker.myNERTagger->Classify( sentences );
+	}
+	catch ( exception&e ){
+#pragma omp critical (analyze_errors)
+	  {
 	    all_well = false;
 	    exs += string(e.what()) + " ";
 	  }
-	  timers.nerTimer.stop();
 	}
+	worker.timers.nerTimer.stop();
       }
+    }
 #pragma omp section
-      {
-	if ( options.doIOB ){
-	  timers.iobTimer.start();
-	  try {
-	    myIOBTagger->Classify( sentence );
-	  }
-	  catch ( exception&e ){
+    {
+      if ( options.doIOB ){
+	worker.timers.iobTimer.start();
+	try {
+	  worker.myIOBTagger->Classify( sentences );
+	}
+	catch ( exception&e ){
+#pragma omp critical (analyze_errors)
+	  {
 	    all_well = false;
 	    exs += string(e.what()) + " ";
 	  }
-	  timers.iobTimer.stop();
 	}
+	worker.timers.iobTimer.stop();
       }
     }
-    //
-    // MWU resolution needs the previous results per sentence
-    // AND must be done before parsing
-    //
-    if ( !all_well ){
-      throw runtime_error( exs );
-    }
-    if ( options.doMwu ){
-      if ( !sentence.empty() ){
-	timers.mwuTimer.start();
-	myMwu->Classify( sentence );
-	timers.mwuTimer.stop();
+  } // omp parallel sections
+  //
+  // MWU resolution needs the previous results per sentence
+  // AND must be done before parsing
+  //
+  if ( !all_well ){
+    worker.timers.frogTimer.stop();
+    throw runtime_error( exs );
+  }
+  if ( options.doMwu ){
+    worker.timers.mwuTimer.start();
+    for ( const auto& it : batch ){
+      if ( !it.first->empty() ){
+	worker.myMwu->Classify( *it.first );
       }
     }
-    if ( options.doAlpino || options.doParse ){
+    worker.timers.mwuTimer.stop();
+  }
+  if ( options.doAlpino || options.doParse ){
+    vector<frog_data*> to_parse;
+    for ( const auto& [sentence,s_count] : batch ){
       if ( options.maxParserTokens == 0
-	   || sentence.size() <= options.maxParserTokens ){
-	myParser->Parse( sentence, timers );
+	   || sentence->size() <= options.maxParserTokens ){
+	to_parse.push_back( sentence );
       }
       else {
 	LOG << "WARNING!" << endl;
 	LOG << "Sentence " << s_count
 	    << " isn't parsed because it contains more tokens ("
-	    << sentence.size()
+	    << sentence->size()
 	    << ") then set with the --max-parser-tokens="
 	    << options.maxParserTokens << " option." << endl;
 	DBG << 	"Sentence " << s_count << " is too long: " << endl
-	    << sentence.sentence(true) << endl;
+	    << sentence->sentence(true) << endl;
       }
     }
-    timers.frogTimer.stop();
-    if ( options.debugFlag > 5 ){
-      DBG << "Frogged one sentence:" << endl << sentence << endl;
+    worker.myParser->ParseBatch( to_parse, worker.timers );
+  }
+  worker.timers.frogTimer.stop();
+  if ( options.debugFlag > 5 ){
+    for ( const auto& [sentence,s_count] : batch ){
+      DBG << "Frogged sentence " << s_count << ":" << endl
+	  << *sentence << endl;
     }
-    return sentence;
   }
 }
 
@@ -2287,11 +3217,11 @@ void FrogAPI::output_tabbed( ostream& os, const frog_record& fd ) const {
     }
   }
   if ( options.doTagger ){
-    if ( fd.tag.isEmpty() ){
+    if ( fd.full_tag().isEmpty() ){
       os << Tab << Tab << fixed << showpoint << std::setprecision(6) << 1.0;
     }
     else {
-      os << Tab << fd.tag << Tab
+      os << Tab << fd.full_tag() << Tab
 	 << fixed << showpoint << std::setprecision(6) << fd.tag_confidence;
     }
   }
@@ -2299,13 +3229,13 @@ void FrogAPI::output_tabbed( ostream& os, const frog_record& fd ) const {
     os << Tab << Tab << Tab;
   }
   if ( options.doNER ){
-    os << Tab << fd.ner_tag;
+    os << Tab << fd.full_ner_tag();
   }
   else {
     os << Tab << Tab;
   }
   if ( options.doIOB ){
-    os << Tab << fd.iob_tag;
+    os << Tab << fd.full_iob_tag();
   }
   else {
     os << Tab << Tab;
@@ -2514,7 +3444,9 @@ void FrogAPI::handle_one_sentence( ostream& os,
 	// the tokenizer may split the text into more than one sentences
 	// but we don't want that, it spoils the resulting FoLiA.
 	// The input Sentence node should stay leading
-	all_toks.insert( all_toks.end(), toks.begin(), toks.end() );
+	all_toks.insert( all_toks.end(),
+			 make_move_iterator( toks.begin() ),
+			 make_move_iterator( toks.end() ) );
 	toks = tokenizer->tokenize_next();
       }
       timers.tokTimer.stop();
@@ -2572,8 +3504,9 @@ void FrogAPI::handle_one_paragraph( ostream& os,
       vector<Tokenizer::Token> toks = tokenizer->tokenize_line( text );
       timers.tokTimer.stop();
       while ( toks.size() > 0 ){
-	frog_data res = frog_sentence( toks, ++sentences_done );
-	while ( !res.empty() ){
+	token_cursor cursor( toks );
+	while ( !cursor.done() ){
+	  frog_data res = frog_sentence( cursor, ++sentences_done );
 	  if ( !options.noStdOut ){
 	    show_results( os, res );
 	  }
@@ -2586,10 +3519,6 @@ void FrogAPI::handle_one_paragraph( ostream& os,
 	    folia::Sentence *s = p->add_child<folia::Sentence>( args );
 	    append_to_sentence( s, res );
 	  }
-	  if ( toks.size() == 0 ){
-	    break;
-	  }
-	  res = frog_sentence( toks, ++sentences_done );
 	}
 	timers.tokTimer.start();
 	toks = tokenizer->tokenize_next();
@@ -2887,9 +3816,44 @@ folia::Document *FrogAPI::run_text_engine( const string& infilename,
     doc_id = filter_non_NC( TiCC::basename(doc_id) );
     root = start_document( doc_id, doc );
   }
+  if ( workers.size() > 1 ){
+    i = run_text_pipeline( test_file, os, root, par_count );
+    if  (options.debugFlag > 0){
+      DBG << TiCC::Timer::now() << " done with " << i << " sentences" << endl;
+    }
+    return doc;
+  }
   timers.tokTimer.start();
   vector<Tokenizer::Token> toks = tokenizer->tokenize_stream( test_file );
   timers.tokTimer.stop();
+  if ( options.batchSize > 1 ){
+    vector<vector<Tokenizer::Token>> batch;
+    while ( !toks.empty() ){
+      batch.push_back( std::move( toks ) );
+      timers.tokTimer.start();
+      toks = tokenizer->tokenize_stream_next();
+      timers.tokTimer.stop();
+      if ( toks.empty()
+	   || batch.size() == (size_t)options.batchSize ){
+	vector<frog_data> results = frog_sentences( batch, i+1 );
+	for ( const auto& res : results ){
+	  ++i;
+	  if ( !options.noStdOut ){
+	    show_results( os, res );
+	  }
+	  if ( options.doXMLout ){
+	    root = append_to_folia( root, res, par_count );
+	  }
+	}
+	if  (options.debugFlag > 0){
+	  DBG << TiCC::Timer::now() << " done with sentence[" << i << "]"
+	      << endl;
+	}
+	batch.clear();
+      }
+    }
+    return doc;
+  }
   while ( toks.size() > 0 ){
     frog_data res = frog_sentence( toks, ++i );
     if ( !options.noStdOut ){
@@ -2908,6 +3872,283 @@ folia::Document *FrogAPI::run_text_engine( const string& infilename,
   return doc;
 }
 
+/// \brief a batch of sentences travelling through the analysis pipeline
+struct pipeline_job {
+  size_t seq;                  ///< the position of the job in the input
+  size_t first;                ///< the sentence count of the first sentence
+  vector<frog_data> sentences; ///< the sentences themselves
+  vector<bool> analyze;        ///< false for sentences in an unwanted language
+  string error;                ///< the reason why analysis failed, if it did
+};
+
+/// \brief the shared state of the tokenizer, the workers and the writer
+/*!
+  The tokenizer adds jobs, which are picked up by the workers. The workers
+  deliver the results, which are collected in the original order by the
+  writer. At most \e depth jobs are 'in flight' between the tokenizer and the
+  writer, so memory use stays bounded, even when some sentences take much
+  longer then others.
+*/
+class sentence_pipeline {
+public:
+  explicit sentence_pipeline( size_t depth ):
+    max_in_flight(depth),
+    in_flight(0),
+    produced(0),
+    next_out(1),
+    input_done(false),
+    aborted(false)
+  {};
+  bool put( pipeline_job *job ){
+    /// add a new job. Blocks while there are too many jobs in flight
+    /*!
+      \param job the job to add
+      \return false when the pipeline is aborted. The job is deleted then.
+    */
+    unique_lock<mutex> lock( mtx );
+    room.wait( lock, [this]{ return aborted || in_flight < max_in_flight; } );
+    if ( aborted ){
+      delete job;
+      return false;
+    }
+    ++in_flight;
+    ++produced;
+    todo.push_back( job );
+    work.notify_one();
+    return true;
+  }
+  pipeline_job *take(){
+    /// get a job to work on. Blocks when there is nothing to do (yet)
+    /*!
+      \return the next job, or 0 when we are finished
+    */
+    unique_lock<mutex> lock( mtx );
+    work.wait( lock, [this]{ return aborted || input_done || !todo.empty(); } );
+    if ( aborted || todo.empty() ){
+      return 0;
+    }
+    pipeline_job *job = todo.front();
+    todo.pop_front();
+    return job;
+  }
+  void deliver( pipeline_job *job ){
+    /// hand over the result of a job to the writer
+    unique_lock<mutex> lock( mtx );
+    done[job->seq] = job;
+    if ( job->seq == next_out ){
+      ready.notify_one();
+    }
+  }
+  pipeline_job *next_result(){
+    /// get the next result in input order. Blocks until it is available
+    /*!
+      \return the next job, or 0 when all jobs are output
+    */
+    unique_lock<mutex> lock( mtx );
+    ready.wait( lock, [this]{ return aborted
+			       || done.find( next_out ) != done.end()
+			       || ( input_done && next_out > produced ); } );
+    auto it = done.find( next_out );
+    if ( aborted || it == done.end() ){
+      return 0;
+    }
+    pipeline_job *job = it->second;
+    done.erase( it );
+    ++next_out;
+    --in_flight;
+    room.notify_one();
+    return job;
+  }
+  void finish( const string& err="" ){
+    /// signal that no more jobs will be added
+    /*!
+      \param err the reason, when the tokenizer stopped on an error
+    */
+    unique_lock<mutex> lock( mtx );
+    input_done = true;
+    input_error = err;
+    work.notify_all();
+    ready.notify_all();
+  }
+  void abort(){
+    /// stop all processing as soon as possible
+    unique_lock<mutex> lock( mtx );
+    aborted = true;
+    room.notify_all();
+    work.notify_all();
+    ready.notify_all();
+  }
+  string error() {
+    /// return the error message of the tokenizer, if any
+    unique_lock<mutex> lock( mtx );
+    return input_error;
+  }
+  ~sentence_pipeline(){
+    for ( const auto& job : todo ){
+      delete job;
+    }
+    for ( const auto& it : done ){
+      delete it.second;
+    }
+  }
+private:
+  mutex mtx;
+  condition_variable room;   // the tokenizer waits for room here
+  condition_variable work;   // the workers wait for jobs here
+  condition_variable ready;  // the writer waits for results here
+  deque<pipeline_job*> todo;
+  map<size_t,pipeline_job*> done;
+  size_t max_in_flight;
+  size_t in_flight;
+  size_t produced;
+  size_t next_out;
+  bool input_done;
+  bool aborted;
+  string input_error;
+};
+
+int FrogAPI::run_text_pipeline( istream& is,
+				ostream& os,
+				folia::FoliaElement *& root,
+				unsigned int& par_count ){
+  /// Run frog on a text stream, using all our workers
+  /*!
+    \param is the input stream
+    \param os the stream to output tabbed/JSON to.
+    \param root the FoLiA node to append the results to (XML output only)
+    \param par_count the paragraph counter for the FoLiA output
+    \return the number of sentences handled
+
+    The tokenizer runs in a separate thread, and every worker in a thread of
+    its own. The results are output in the calling thread, in the original
+    order.
+
+    The tokenizer groups the sentences in jobs of --batch-size sentences, so
+    every worker runs its modules on a whole batch at once, like
+    frog_sentences() does.
+  */
+  sentence_pipeline pipe( options.queueDepth );
+  thread producer( [&]{
+      string err;
+      pipeline_job *job = 0;
+      try {
+	size_t seq = 0;
+	size_t s_count = 0;
+	timers.tokTimer.start();
+	vector<Tokenizer::Token> toks = tokenizer->tokenize_stream( is );
+	timers.tokTimer.stop();
+	while ( toks.size() > 0 ){
+	  if ( !job ){
+	    job = new pipeline_job;
+	    job->seq = ++seq;
+	    job->first = s_count+1;
+	    job->sentences.reserve( options.batchSize );
+	  }
+	  job->sentences.push_back( extract_fd( toks, false ) );
+	  job->analyze.push_back( wanted_language( job->sentences.back(),
+						   ++s_count ) );
+	  timers.tokTimer.start();
+	  toks = tokenizer->tokenize_stream_next();
+	  timers.tokTimer.stop();
+	  if ( toks.empty()
+	       || job->sentences.size() == (size_t)options.batchSize ){
+	    bool ok = pipe.put( job );
+	    job = 0;
+	    if ( !ok ){
+	      break;
+	    }
+	  }
+	}
+      }
+      catch ( const exception& e ){
+	err = e.what();
+      }
+      delete job;
+      pipe.finish( err );
+    } );
+  vector<thread> analyzers;
+  for ( const auto& worker : workers ){
+    analyzers.push_back( thread( [&pipe,worker,this]{
+#ifdef HAVE_OPENMP
+	  // the sentences are already handled in parallel.
+	  omp_set_num_threads( 1 );
+#endif
+	  pipeline_job *job;
+	  while ( (job = pipe.take()) ){
+	    vector<pair<frog_data*,size_t>> to_do;
+	    for ( size_t i=0; i < job->sentences.size(); ++i ){
+	      if ( job->analyze[i] ){
+		to_do.push_back( make_pair( &job->sentences[i],
+					    job->first+i ) );
+	      }
+	    }
+	    try {
+	      analyze_sentences( to_do, *worker );
+	    }
+	    catch ( const exception& e ){
+	      job->error = e.what();
+	    }
+	    pipe.deliver( job );
+	  }
+	} ) );
+  }
+  int count = 0;
+  string err;
+  pipeline_job *job;
+  while ( (job = pipe.next_result()) ){
+    if ( !job->error.empty() ){
+      err = job->error;
+      delete job;
+      pipe.abort();
+      break;
+    }
+    count += job->sentences.size();
+    try {
+      for ( const auto& sentence : job->sentences ){
+	if ( !options.noStdOut ){
+	  show_results( os, sentence );
+	}
+	if ( options.doXMLout ){
+	  root = append_to_folia( root, sentence, par_count );
+	}
+      }
+    }
+    catch ( const exception& e ){
+      err = e.what();
+      delete job;
+      pipe.abort();
+      break;
+    }
+    if  (options.debugFlag > 0){
+      DBG << TiCC::Timer::now() << " done with sentence["
+	  << job->first + job->sentences.size() - 1 << "]" << endl;
+    }
+    delete job;
+  }
+  producer.join();
+  for ( auto& t : analyzers ){
+    t.join();
+  }
+  if ( err.empty() ){
+    err = pipe.error();
+  }
+  if ( !err.empty() ){
+    throw runtime_error( err );
+  }
+  return count;
+}
+
+void FrogAPI::collect_timers(){
+  /// add the timings of all workers to our own timers
+  /*!
+    Our own timers only measured the tokenizer. When more workers are active,
+    the result is the sum of the time spent in all workers.
+  */
+  for ( const auto& worker : workers ){
+    timers.add( worker->timers );
+  }
+}
+
 folia::Document *FrogAPI::FrogFile( const string& infilename ){
   /// generic function to Frog a file
   /*!
@@ -2928,13 +4169,26 @@ folia::Document *FrogAPI::FrogFile( const string& infilename ){
     xml_in = true;
   }
   timers.reset();
+  for ( const auto& worker : workers ){
+    worker->timers.reset();
+  }
+  // the module timers are summed over the workers, so measure the elapsed
+  // time separately
+  TiCC::Timer totalTimer;
+  totalTimer.start();
   if ( xml_in ){
     result = run_folia_engine( infilename, *outS );
   }
   else {
     result = run_text_engine( infilename, *outS );
   }
+  totalTimer.stop();
+  collect_timers();
   if ( !options.hide_timers ){
+    if ( workers.size() > 1 ){
+      LOG << "timings are summed over " << workers.size() << " workers,"
+	  << " except the total" << endl;
+    }
     LOG << "tokenisation took:  " << timers.tokTimer << endl;
     LOG << "CGN tagging took:   " << timers.tagTimer << endl;
     if ( options.doIOB){
@@ -2945,9 +4199,21 @@ folia::Document *FrogAPI::FrogFile( const string& infilename ){
     }
     if ( options.doMbma ){
       LOG << "MBMA took:          " << timers.mbmaTimer << endl;
+      cache_stats cs = workers[0]->myMbma->get_cache_stats();
+      if ( cs.hits + cs.misses > 0 ){
+	LOG << "MBMA cache:         " << cs << endl;
+      }
+      cs = workers[0]->myMbma->get_window_cache_stats();
+      if ( cs.hits + cs.misses > 0 ){
+	LOG << "MBMA window cache:  " << cs << endl;
+      }
     }
     if ( options.doLemma ){
       LOG << "Mblem took:         " << timers.mblemTimer << endl;
+      cache_stats cs = workers[0]->myMblem->get_cache_stats();
+      if ( cs.hits + cs.misses > 0 ){
+	LOG << "Mblem cache:        " << cs << endl;
+      }
     }
     if ( options.doMwu ){
       LOG << "MWU resolving took: " << timers.mwuTimer << endl;
@@ -2962,9 +4228,20 @@ folia::Document *FrogAPI::FrogFile( const string& infilename ){
       LOG << "Parsing (rels)    took: " << timers.relsTimer << endl;
       LOG << "Parsing (dir)     took: " << timers.dirTimer << endl;
       LOG << "Parsing (csi)     took: " << timers.csiTimer << endl;
+      for ( const auto& [name,cs] : workers[0]->myParser->get_cache_stats() ){
+	if ( cs.hits + cs.misses > 0 ){
+	  LOG << "Parsing (" << name << ") cache: " << cs << endl;
+	}
+      }
       LOG << "Parsing (total)   took: " << timers.parseTimer << endl;
     }
-    LOG << "Frogging in total took: " << timers.frogTimer + timers.tokTimer << endl;
+    if ( sentence_cache ){
+      cache_stats cs = sentence_cache->stats();
+      LOG << "Sentence cache:     " << cs << " using ~"
+	  << cs.cost / ( 1024 * 1024 ) << " of "
+	  << options.sentenceCacheSize << " MB" << endl;
+    }
+    LOG << "Frogging in total took: " << totalTimer << endl;
   }
   return result;
 }
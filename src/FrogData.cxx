@@ -35,6 +35,7 @@
 #include "ticcutils/StringOps.h"
 #include "ticcutils/Unicode.h"
 #include "frog/FrogData.h"
+#include "frog/cgn_tag.h"
 #include "frog/mbma_brackets.h"
 
 using namespace std;
@@ -42,14 +43,18 @@ using namespace icu;
 using namespace nlohmann;
 using TiCC::operator<<;
 
+/// the initial IOB and NER tag
+static const symbol outside_tag( "O" );
+
 /// default constructor
 frog_record::frog_record():
   no_space(false),
   new_paragraph(false),
   tag_confidence(0.0),
-  iob_tag( "O" ),
+  tag_info(0),
+  iob_tag( outside_tag ),
   iob_confidence(0.0),
-  ner_tag( "O" ),
+  ner_tag( outside_tag ),
   ner_confidence(0.0),
   compound_string( "0" ),
   parse_index(-1)
@@ -62,6 +67,18 @@ frog_record::~frog_record(){
   }
 }
 
+const cgn_tag& frog_record::cgn() const {
+  /// return the parsed POS tag of this record
+  /*!
+    \return the parsed tag. The version stored by the tagger is used, unless
+    the tag was changed afterwards.
+  */
+  if ( tag_info && tag_info->tag == tag ){
+    return *tag_info;
+  }
+  return cgn_tag::get( tag );
+}
+
 json frog_record::to_json() const {
   /// format a frog_record fd into a json structure
   /*!
@@ -89,28 +106,28 @@ json frog_record::to_json() const {
   if ( compound_string.find("0") == string::npos ){
     result["compound"] = compound_string;
   }
-  if ( !tag.isEmpty() ){
+  if ( !full_tag().isEmpty() ){
     json tg;
-    tg["tag"] = TiCC::UnicodeToUTF8(tag);
+    tg["tag"] = TiCC::UnicodeToUTF8(full_tag());
     tg["confidence"] = tag_confidence;
     result["pos"] = tg;
   }
-  if ( !ner_tag.isEmpty() && ner_confidence > 0.0 ){
+  if ( !full_ner_tag().isEmpty() && ner_confidence > 0.0 ){
     json tg;
-    tg["tag"] = TiCC::UnicodeToUTF8(ner_tag);
+    tg["tag"] = TiCC::UnicodeToUTF8(full_ner_tag());
     tg["confidence"] = ner_confidence;
     result["ner"] = tg;
   }
-  if ( !iob_tag.isEmpty() ){
+  if ( !full_iob_tag().isEmpty() ){
     json tg;
-    tg["tag"] = TiCC::UnicodeToUTF8(iob_tag);
+    tg["tag"] = TiCC::UnicodeToUTF8(full_iob_tag());
     tg["confidence"] = iob_confidence;
     result["chunking"] = tg;
   }
-  if ( !parse_role.empty() ){
+  if ( !parse_role.isEmpty() ){
     json parse;
     parse["parse_index"] = parse_index;
-    parse["parse_role"] = parse_role;
+    parse["parse_role"] = TiCC::UnicodeToUTF8(parse_role);
     result["parse"] = parse;
   }
   return result;
@@ -131,9 +148,9 @@ ostream& operator<<( ostream& os, const frog_record& fr ){
     os << fr.lemmas[0];
   }
   os << TAB << fr.morph_string;
-  os << TAB << fr.tag << TAB << fixed << showpoint << std::setprecision(6) << fr.tag_confidence;
-  os << TAB << fr.ner_tag; // << TAB << fr.ner_confidence;
-  os << TAB << fr.iob_tag; // << TAB << fr.iob_confidence;
+  os << TAB << fr.full_tag() << TAB << fixed << showpoint << std::setprecision(6) << fr.tag_confidence;
+  os << TAB << fr.full_ner_tag(); // << TAB << fr.ner_confidence;
+  os << TAB << fr.full_iob_tag(); // << TAB << fr.iob_confidence;
   os << TAB << fr.parse_index;
   os << TAB << fr.parse_role;
   return os;
@@ -149,7 +166,8 @@ frog_record merge( const frog_data& fd, size_t start, size_t finish ){
 
     all information from the records \e start +1 to \em finish is merged into
     the record at position \e start. Strings are concatenated using an
-    underscore ('_') which is the way Frog has always displayed MWU's
+    underscore ('_') which is the way Frog has always displayed MWU's.
+    The joined tags go in the mwu_ fields, and are not interned.
 
     \note merging is only done for the first (default) lemma and morpheme
    */
@@ -160,6 +178,11 @@ frog_record merge( const frog_data& fd, size_t start, size_t finish ){
   //  cerr << "start: " << result << endl;
   result.compound_string = "0"; // MWU's are never compounds
   result.parts.insert( start );
+  if ( finish > start ){
+    result.mwu_tag = result.tag;
+    result.mwu_ner_tag = result.ner_tag;
+    result.mwu_iob_tag = result.iob_tag;
+  }
   for ( size_t i = start+1; i <= finish; ++i ){
     result.parts.insert( i );
     result.word += "_" + fd.units[i].word;
@@ -172,10 +195,10 @@ frog_record merge( const frog_data& fd, size_t start, size_t finish ){
       // there is already morpheme information
       result.morph_string += "_" + fd.units[i].morph_string;
     }
-    result.tag += "_" + fd.units[i].tag;
+    result.mwu_tag += "_" + fd.units[i].tag;
     result.tag_confidence *= fd.units[i].tag_confidence;
-    result.ner_tag += "_" + fd.units[i].ner_tag;
-    result.iob_tag += "_" + fd.units[i].iob_tag;
+    result.mwu_ner_tag += "_" + fd.units[i].ner_tag;
+    result.mwu_iob_tag += "_" + fd.units[i].iob_tag;
     // cerr << "intermediate: " << result << endl;
   }
   // cerr << "DONE: " << result << endl;
@@ -47,7 +47,9 @@
 #include "ticcutils/json.hpp"
 #include "timbl/TimblAPI.h"
 #include "frog/Frog-util.h"
+#include "frog/server_pool.h"
 #include "frog/csidp.h"
+#include "frog/cgn_tag.h"
 #include "frog/Parser.h"
 
 using namespace std;
@@ -100,10 +102,14 @@ UnicodeString filter_spaces( const UnicodeString& in ){
   return result;
 }
 
-bool Parser::init( const TiCC::Configuration& configuration ){
+bool Parser::init( const TiCC::Configuration& configuration,
+		   const ParserBase *base_model ){
   /// initialize a Parser from the configuration
   /*!
     \param configuration the config to use
+    \param base_model an already initialized Parser. When given, the 3 Timbl
+    instances are created as clones which share the instance bases of the
+    model
     \return true on succes
     extract all needed information from the configuration and setup the parser
     by creating 3 Timbl instances
@@ -117,6 +123,7 @@ bool Parser::init( const TiCC::Configuration& configuration ){
   string relsOptions = "-a1 +D -G0 +vdb+di";
   maxDepSpanS = "20";
   maxDepSpan = 20;
+  size_t cache_size = 100000;
   bool problem = false;
   LOG << "initiating parser ... " << endl;
   string cDir = configuration.configDir();
@@ -179,6 +186,11 @@ bool Parser::init( const TiCC::Configuration& configuration ){
       problem = true;
     }
   }
+  val = configuration.lookUp( "cache_size", "parser" );
+  if ( !val.empty() && !TiCC::stringTo<size_t>( val, cache_size ) ){
+    LOG << "invalid 'cache_size' value in configuration: " << val << endl;
+    problem = true;
+  }
 
   val = configuration.lookUp( "host", "parser" );
   if ( !val.empty() ){
@@ -267,7 +279,24 @@ bool Parser::init( const TiCC::Configuration& configuration ){
     textclass = "current";
   }
   bool happy = true;
-  if ( _host.empty() ){
+  const Parser *model = dynamic_cast<const Parser*>( base_model );
+  if ( base_model && !model ){
+    LOG << "unable to share a parser model of another type" << endl;
+    happy = false;
+  }
+  else if ( model && _host.empty() ){
+    if ( !model->pairs || !model->dir || !model->rels ){
+      LOG << "unable to share the parser model: it isn't loaded" << endl;
+      happy = false;
+    }
+    else {
+      pairs = new Timbl::TimblAPI( *model->pairs );
+      dir = new Timbl::TimblAPI( *model->dir );
+      rels = new Timbl::TimblAPI( *model->rels );
+      happy = pairs->Valid() && dir->Valid() && rels->Valid();
+    }
+  }
+  else if ( _host.empty() ){
     pairs = new Timbl::TimblAPI( pairsOptions );
     if ( pairs->Valid() ){
       LOG << "reading " <<  pairsFileName << endl;
@@ -314,6 +343,20 @@ bool Parser::init( const TiCC::Configuration& configuration ){
       LOG << "using Parser Timbl's on " << _host << ":" << _port << endl;
     }
   }
+  if ( happy ){
+    if ( model ){
+      // share the caches of the model
+      pairs_cache = model->pairs_cache;
+      dir_cache = model->dir_cache;
+      rels_cache = model->rels_cache;
+    }
+    else if ( cache_size > 0 ){
+      pairs_cache = new instance_cache( cache_size );
+      dir_cache = new instance_cache( cache_size );
+      rels_cache = new instance_cache( cache_size );
+      _owns_caches = true;
+    }
+  }
   isInit = happy;
   return happy;
 }
@@ -323,6 +366,11 @@ Parser::~Parser(){
   delete rels;
   delete dir;
   delete pairs;
+  if ( _owns_caches ){
+    delete rels_cache;
+    delete dir_cache;
+    delete pairs_cache;
+  }
 }
 
 vector<UnicodeString> Parser::createPairInstances( const parseData& pd ){
@@ -899,56 +947,31 @@ void Parser::add_provenance( folia::Document& doc, folia::processor *main ) cons
   doc.declare( folia::AnnotationType::DEPENDENCY, dep_tagset, args );
 }
 
-void extract( const UnicodeString& tv,
-	      UnicodeString& head,
-	      UnicodeString& mods ){
-  /// spit a (CGN-like) tag into a head and a modifier part
-  /*!
-    \param tv a CGN-like tag
-    \param head the extacted head
-    \param mods the modfiers, concatenated using the '|' symbol
-
-    Example: the tag WW(pv,tgw,met-t) will be split into a head 'WW' and a
-    mods string 'pv|tgw|met-t'
-   */
-  vector<UnicodeString> v = TiCC::split_at_first_of( tv, "()" );
-  head = v[0];
-  mods.remove();
-  if ( v.size() > 1 ){
-    vector<UnicodeString> mv = TiCC::split_at( v[1], "," );
-    mods = mv[0];
-    for ( size_t i=1; i < mv.size(); ++i ){
-      mods += "|" + mv[i];
-    }
-  }
-  else {
-    mods = ""; // HACK should be "__", but then there are differences!
-  }                                                      //     ^
-}                                                        //     |
-                                                         //     |
-parseData Parser::prepareParse( frog_data& fd ){         //     |
+parseData Parser::prepareParse( frog_data& fd ){
   /// setup the parser for  action
   /*!
     \param fd the frog_data structure with the needed information
     \return a parseData structure for further processing
+
+    The heads and the mods are taken from the parsed POS tags. e.g. the tag
+    WW(pv,tgw,met-t) gives a head 'WW' and a mods string 'pv|tgw|met-t'
   */
-  parseData pd;                                          //     |
-  for ( size_t i = 0; i < fd.units.size(); ++i ){        //     |
-    if ( fd.mwus.find( i ) == fd.mwus.end() ){           //     |
-      UnicodeString head;                                       //     |
-      UnicodeString mods;                                       //     |
-      extract( fd.units[i].tag, head, mods );            //     |
-      UnicodeString word_s = filter_spaces(fd.units[i].word);   //     |
-      pd.words.push_back( word_s );                      //     |
-      pd.heads.push_back( head );                        //     |
-      if ( mods.isEmpty() ){                               //    \/
+  parseData pd;
+  for ( size_t i = 0; i < fd.units.size(); ++i ){
+    if ( fd.mwus.find( i ) == fd.mwus.end() ){
+      const cgn_tag& parsed = fd.units[i].cgn();
+      UnicodeString word_s = filter_spaces(fd.units[i].word);
+      pd.words.push_back( word_s );
+      pd.heads.push_back( parsed.head );
+      if ( parsed.mods.isEmpty() ){
 	// HACK: make this bug-to-bug compatible with older versions.
 	// But in fact this should also be done for the mwu's loop below!
 	// now sometimes empty mods get appended there.
-	// extract should return "__", I suppose  (see above)
-	mods = "__";
+	pd.mods.push_back( "__" );
+      }
+      else {
+	pd.mods.push_back( parsed.mods );
       }
-      pd.mods.push_back( mods );
     }
     else {
       UnicodeString multi_word;
@@ -960,18 +983,16 @@ parseData Parser::prepareParse( frog_data& fd ){         //     |
 	  tmp = filter->filter( tmp );
 	}
 	tmp = filter_spaces( tmp );
-	UnicodeString head;
-	UnicodeString mods;
-	extract( fd.units[k].tag, head, mods );
+	const cgn_tag& parsed = fd.units[k].cgn();
 	if ( k == i ){
 	  multi_word = tmp;
-	  multi_head = head;
-	  multi_mods = mods;
+	  multi_head = parsed.head;
+	  multi_mods = parsed.mods;
 	}
 	else {
 	  multi_word += "_" + tmp;
-	  multi_head += "_" + head;
-	  multi_mods += "_" + mods;
+	  multi_head += "_" + parsed.head;
+	  multi_mods += "_" + parsed.mods;
 	}
       }
       pd.words.push_back( multi_word );
@@ -1020,54 +1041,16 @@ vector<pair<string,double>> parse_vd( const string& ds ){
   return result;
 }
 
-vector<timbl_result> Parser::timbl_server( const string& base,
-					   const vector<UnicodeString>& instances ){
-  /// call a Timbl Server with a list of instances
+future<json> Parser::submit_server( const string& base,
+				    const vector<UnicodeString>& instances ){
+  /// start a call to a Timbl Server with a list of instances
   /*!
     \param base used to select the Timbl to use (should be configured correctly)
     \param instances the instances to feed to the Timbl Server
-    \return a list of timbl_result structures with the result of processing
-    all instances
+    \return a future holding the JSON reply of the server. Use
+    server_results() to convert it
    */
-  vector<timbl_result> result;
-  Sockets::ClientSocket client;
-  if ( !client.connect( _host, _port ) ){
-    LOG << "failed to open connection, " << _host
-	<< ":" << _port << endl
-	<< "Reason: " << client.getMessage() << endl;
-    exit( EXIT_FAILURE );
-  }
   DBG << "calling " << base << " server" << endl;
-  string line;
-  client.read( line );
-  json response;
-  try {
-    response = json::parse( line );
-  }
-  catch ( const exception& e ){
-    LOG << "json parsing failed on '" << line << "':"
-	<< e.what() << endl;
-    abort();
-  }
-  DBG << "received json data:" << response.dump(2) << endl;
-
-  json out_json;
-  out_json["command"] = "base";
-  out_json["param"] = base;
-  string out_line = out_json.dump() + "\n";
-  DBG << "sending BASE json data:" << out_line << endl;
-  client.write( out_line );
-  client.read( line );
-  try {
-    response = json::parse( line );
-  }
-  catch ( const exception& e ){
-    LOG << "json parsing failed on '" << line << "':"
-	<< e.what() << endl;
-    abort();
-  }
-  DBG << "received json data:" << response.dump(2) << endl;
-
   // create json query struct
   json query;
   query["command"] = "classify";
@@ -1077,21 +1060,17 @@ vector<timbl_result> Parser::timbl_server( const string& base,
   }
   query["params"] = arr;
   DBG << "send json" << query.dump(2) << endl;
-  // send it to the server
-  line = query.dump() + "\n";
-  client.write( line );
-  // receive json
-  client.read( line );
-  DBG << "received line:" << line << "" << endl;
-  try {
-    response = json::parse( line );
-  }
-  catch ( const exception& e ){
-    LOG << "json parsing failed on '" << line << "':"
-	<< e.what() << endl;
-    LOG << "the request to the server was: '" <<  query.dump(2) << "'" << endl;
-    abort();
-  }
+  return ServerPool::instance().submit( _host, _port, base,
+					query, dbgLog );
+}
+
+vector<timbl_result> Parser::server_results( const json& response ) const {
+  /// convert the JSON reply of a Timbl Server into timbl_result structures
+  /*!
+    \param response the JSON as received from the server
+    \return a list of timbl_result structures, one for every instance
+   */
+  vector<timbl_result> result;
   DBG << "received json data:" << response.dump(2) << endl;
   if ( !response.is_array() ){
     string cat = response["category"];
@@ -1110,6 +1089,87 @@ vector<timbl_result> Parser::timbl_server( const string& base,
   return result;
 }
 
+vector<UnicodeString> Parser::from_cache( instance_cache *cache,
+					 const vector<UnicodeString>& instances,
+					 vector<timbl_result>& results,
+					 vector<size_t>& missing ) const {
+  /// fill the results for instances that are in the cache
+  /*!
+    \param cache the cache to use. May be 0
+    \param instances the instances we need results for
+    \param results the results, one for every instance. Only those found in
+    the cache are filled
+    \param missing the positions of the instances NOT in the cache
+    \return the instances NOT in the cache, which we have to classify
+   */
+  results.assign( instances.size(), timbl_result() );
+  missing.clear();
+  vector<UnicodeString> todo;
+  for ( size_t i=0; i < instances.size(); ++i ){
+    if ( !cache || !cache->lookup( instances[i], results[i] ) ){
+      missing.push_back( i );
+      todo.push_back( instances[i] );
+    }
+  }
+  return todo;
+}
+
+void Parser::to_cache( instance_cache *cache,
+		       const vector<UnicodeString>& instances,
+		       const vector<size_t>& missing,
+		       const vector<timbl_result>& answers,
+		       vector<timbl_result>& results ) const {
+  /// add the answers for the missing instances to the results and the cache
+  /*!
+    \param cache the cache to use. May be 0
+    \param instances all instances
+    \param missing the positions of the instances that were classified
+    \param answers the classifier's results for those instances
+    \param results the full list of results to complete
+   */
+  if ( answers.size() != missing.size() ){
+    throw runtime_error( "parser got " + to_string(answers.size())
+			 + " results for " + to_string(missing.size())
+			 + " instances" );
+  }
+  for ( size_t i=0; i < missing.size(); ++i ){
+    results[missing[i]] = answers[i];
+    if ( cache ){
+      cache->store( instances[missing[i]], answers[i] );
+    }
+  }
+}
+
+vector<timbl_result> Parser::cached_timbl( Timbl::TimblAPI *tim,
+					   instance_cache *cache,
+					   const vector<UnicodeString>& instances ) const {
+  /// call a Timbl experiment, but only for instances which aren't cached
+  /*!
+    \param tim The Timbl to use
+    \param cache the cache to use. May be 0
+    \param instances the instances to feed to the Timbl
+    \return a list of timbl_result structures, one for every instance
+   */
+  vector<timbl_result> result;
+  vector<size_t> missing;
+  vector<UnicodeString> todo = from_cache( cache, instances, result, missing );
+  if ( !todo.empty() ){
+    to_cache( cache, instances, missing, timbl( tim, todo ), result );
+  }
+  return result;
+}
+
+vector<pair<string,cache_stats>> Parser::get_cache_stats() const {
+  /// return the counters of the 3 instance caches
+  vector<pair<string,cache_stats>> result;
+  if ( pairs_cache ){
+    result.push_back( make_pair( "pairs", pairs_cache->stats() ) );
+    result.push_back( make_pair( "rels", rels_cache->stats() ) );
+    result.push_back( make_pair( "dir", dir_cache->stats() ) );
+  }
+  return result;
+}
+
 void appendParseResult( frog_data& fd,
 			const vector<parsrel>& res ){
   /// transfer the outcome of the parser back into the fog_data structure
@@ -1130,7 +1190,7 @@ void appendParseResult( frog_data& fd,
   // cerr << "roles=" << roles << endl;
   for ( size_t i = 0; i < nums.size(); ++i ){
     fd.mw_units[i].parse_index = nums[i];
-    fd.mw_units[i].parse_role = roles[i];
+    fd.mw_units[i].parse_role = symbol( roles[i] );
   }
 }
 
@@ -1141,7 +1201,8 @@ void Parser::Parse( frog_data& fd, TimerBlock& timers ){
     \param timers the TimerBlock for measuring what we wasting
 
     This function will run 3 Timbl's in parallel to get its information
-    which is the handled to the 'real' parsing CSIDP process
+    which is the handled to the 'real' parsing CSIDP process. When Timbl
+    servers are used, the 3 queries are in flight at the same time.
   */
   timers.parseTimer.start();
   if ( !isInit ){
@@ -1159,44 +1220,78 @@ void Parser::Parse( frog_data& fd, TimerBlock& timers ){
   vector<timbl_result> p_results;
   vector<timbl_result> d_results;
   vector<timbl_result> r_results;
+  if ( !_host.empty() ){
+    // put the 3 queries in flight at once, so we only wait for the slowest
+    // server, also when OpenMP gives us only 1 thread
+    // only the instances that aren't cached are sent
+    timers.pairsTimer.start();
+    timers.dirTimer.start();
+    timers.relsTimer.start();
+    vector<UnicodeString> p_insts = createPairInstances( pd );
+    vector<UnicodeString> d_insts = createDirInstances( pd );
+    vector<UnicodeString> r_insts = createRelInstances( pd );
+    vector<size_t> p_missing;
+    vector<size_t> d_missing;
+    vector<size_t> r_missing;
+    vector<UnicodeString> p_todo = from_cache( pairs_cache, p_insts,
+					       p_results, p_missing );
+    vector<UnicodeString> d_todo = from_cache( dir_cache, d_insts,
+					       d_results, d_missing );
+    vector<UnicodeString> r_todo = from_cache( rels_cache, r_insts,
+					       r_results, r_missing );
+    future<json> p_reply;
+    future<json> d_reply;
+    future<json> r_reply;
+    if ( !p_todo.empty() ){
+      p_reply = submit_server( _pairs_base, p_todo );
+    }
+    if ( !d_todo.empty() ){
+      d_reply = submit_server( _dirs_base, d_todo );
+    }
+    if ( !r_todo.empty() ){
+      r_reply = submit_server( _rels_base, r_todo );
+    }
+    if ( p_reply.valid() ){
+      to_cache( pairs_cache, p_insts, p_missing,
+		server_results( p_reply.get() ), p_results );
+    }
+    timers.pairsTimer.stop();
+    if ( d_reply.valid() ){
+      to_cache( dir_cache, d_insts, d_missing,
+		server_results( d_reply.get() ), d_results );
+    }
+    timers.dirTimer.stop();
+    if ( r_reply.valid() ){
+      to_cache( rels_cache, r_insts, r_missing,
+		server_results( r_reply.get() ), r_results );
+    }
+    timers.relsTimer.stop();
+  }
+  else {
 #pragma omp parallel sections
-  {
+    {
 #pragma omp section
       {
 	timers.pairsTimer.start();
 	vector<UnicodeString> instances = createPairInstances( pd );
-	if ( _host.empty() ){
-	  p_results = timbl( pairs, instances );
-	}
-	else {
-	  p_results = timbl_server( _pairs_base, instances );
-	}
+	p_results = cached_timbl( pairs, pairs_cache, instances );
 	timers.pairsTimer.stop();
       }
 #pragma omp section
       {
 	timers.dirTimer.start();
 	vector<UnicodeString> instances = createDirInstances( pd );
-	if ( _host.empty() ){
-	  d_results = timbl( dir, instances );
-	}
-	else {
-	  d_results = timbl_server( _dirs_base, instances );
-	}
+	d_results = cached_timbl( dir, dir_cache, instances );
 	timers.dirTimer.stop();
       }
 #pragma omp section
       {
 	timers.relsTimer.start();
 	vector<UnicodeString> instances = createRelInstances( pd );
-	if ( _host.empty() ){
-	  r_results = timbl( rels, instances );
-	}
-	else {
-	  r_results = timbl_server( _rels_base, instances );
-	}
+	r_results = cached_timbl( rels, rels_cache, instances );
 	timers.relsTimer.stop();
       }
+    }
   }
 
   timers.csiTimer.start();
@@ -1217,6 +1312,21 @@ ParserBase::~ParserBase(){
   delete filter;
 }
 
+void ParserBase::ParseBatch( const vector<frog_data*>& batch,
+			     TimerBlock& timers ){
+  /// Run the Parser on a batch of frog_data structures
+  /*!
+    \param batch the frog_data structures to parse
+    \param timers the TimerBlock for measuring what we wasting
+
+    The default is to parse them one by one. Parsers that can do better
+    override this.
+  */
+  for ( auto *fd : batch ){
+    Parse( *fd, timers );
+  }
+}
+
 void ParserBase::add_result( const frog_data& fd,
 			     const vector<folia::Word*>& wv ) const {
   /// add the parser's conclusiong to the FoLiA we are working on
@@ -1240,7 +1350,7 @@ void ParserBase::add_result( const frog_data& fd,
   folia::DependenciesLayer *el = s->add_child<folia::DependenciesLayer>( args );
   for ( size_t pos=0; pos < fd.mw_units.size(); ++pos ){
     //    DBG << "POS=" << pos << endl;
-    string cls = fd.mw_units[pos].parse_role;
+    string cls = TiCC::UnicodeToUTF8( fd.mw_units[pos].parse_role );
     int dep_id = fd.mw_units[pos].parse_index;
     if ( cls != "ROOT" && dep_id != 0 ){
       if ( !el->id().empty() ){
@@ -0,0 +1,455 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include "frog/alpino_pool.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <sys/wait.h>
+#include "config.h"
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+#define LOG *TiCC::Log(log)
+
+AlpinoPool::AlpinoPool():
+  max_children( 1 ),
+  running( 0 ),
+  timeout( 300 ),
+  owner( getpid() ),
+  log( 0 )
+{
+}
+
+AlpinoPool::~AlpinoPool(){
+  if ( owner != getpid() ){
+    // the children belong to our parent
+    return;
+  }
+  for ( const auto& c : idle ){
+    stop_child( c );
+  }
+}
+
+AlpinoPool& AlpinoPool::instance(){
+  /// return the one and only pool
+  static AlpinoPool the_pool;
+  return the_pool;
+}
+
+void AlpinoPool::configure( size_t workers,
+			    int seconds,
+			    TiCC::LogStream *ls ){
+  /// set the parameters of the pool
+  /*!
+    \param workers the maximum number of Alpino processes to run
+    \param seconds how long to wait for the parse of 1 sentence
+    \param ls a LogStream for messages
+  */
+  lock_guard<mutex> guard( pool_lock );
+  max_children = max<size_t>( 1, workers );
+  timeout = seconds;
+  log = ls;
+}
+
+AlpinoPool::alpino_child *AlpinoPool::start_child() const {
+  /// start a new Alpino process, reading sentences from a pipe
+  /*!
+    \return the administration of the new child
+
+    This will throw when anything goes wrong
+  */
+  string tmpl = "/tmp/";
+  const char *env = getenv( "TMPDIR" );
+  if ( env && *env ){
+    tmpl = string(env) + "/";
+  }
+  tmpl += "frog-alpino-XXXXXX";
+  vector<char> dir_name( tmpl.begin(), tmpl.end() );
+  dir_name.push_back( '\0' );
+  if ( !mkdtemp( dir_name.data() ) ){
+    throw runtime_error( string("unable to create a directory for Alpino: ")
+			 + strerror(errno) );
+  }
+  // we may run concurrently with other threads that fork, so all our
+  // descriptors are close-on-exec from the start
+  int fds[2];
+  if ( pipe2( fds, O_CLOEXEC ) < 0 ){
+    rmdir( dir_name.data() );
+    throw runtime_error( string("unable to create a pipe for Alpino: ")
+			 + strerror(errno) );
+  }
+  int alive[2];
+  if ( pipe2( alive, O_CLOEXEC ) < 0 ){
+    close( fds[0] );
+    close( fds[1] );
+    rmdir( dir_name.data() );
+    throw runtime_error( string("unable to create a pipe for Alpino: ")
+			 + strerror(errno) );
+  }
+  alpino_child *child = new alpino_child();
+  child->out_dir = string( dir_name.data() ) + "/";
+  child->counter = 0;
+  child->watch = -1;
+#ifdef HAVE_SYS_INOTIFY_H
+  child->watch = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+  if ( child->watch >= 0
+       && inotify_add_watch( child->watch, child->out_dir.c_str(),
+			     IN_CLOSE_WRITE | IN_MOVED_TO ) < 0 ){
+    close( child->watch );
+    child->watch = -1;
+  }
+  if ( child->watch < 0 ){
+    LOG << "unable to watch " << child->out_dir << ": " << strerror(errno)
+	<< endl;
+  }
+#endif
+  child->pid = fork();
+  if ( child->pid < 0 ){
+    close( fds[0] );
+    close( fds[1] );
+    close( alive[0] );
+    close( alive[1] );
+    if ( child->watch >= 0 ){
+      close( child->watch );
+    }
+    rmdir( dir_name.data() );
+    delete child;
+    throw runtime_error( string("unable to fork Alpino: ") + strerror(errno) );
+  }
+  if ( child->pid == 0 ){
+    // the child. Read sentences from the pipe, be silent otherwise.
+    // dup2() clears the close-on-exec flag of the copies
+    dup2( fds[0], 0 );
+    int null_fd = open( "/dev/null", O_WRONLY );
+    if ( null_fd >= 0 ){
+      dup2( null_fd, 1 );
+      dup2( null_fd, 2 );
+      close( null_fd );
+    }
+    // Alpino never touches descriptor 3, so it is closed when Alpino exits
+    if ( alive[1] == 3 ){
+      fcntl( 3, F_SETFD, 0 );
+    }
+    else {
+      dup2( alive[1], 3 );
+    }
+    execlp( "Alpino", "Alpino", "-veryfast",
+	    "-flag", "treebank", child->out_dir.c_str(),
+	    "end_hook=xml", "-parse", "-notk", (char*)0 );
+    _exit( EXIT_FAILURE );
+  }
+  close( fds[0] );
+  close( alive[1] );
+  child->to_alpino = fds[1];
+  child->alive = alive[0];
+  LOG << "started Alpino process " << child->pid << " writing in "
+      << child->out_dir << endl;
+  return child;
+}
+
+void AlpinoPool::stop_child( alpino_child *child ) const {
+  /// stop an Alpino process and clean up after it
+  /*!
+    \param child the child to stop. It is deleted.
+
+    Closing the pipe makes Alpino finish. When it doesn't, it is killed.
+  */
+  close( child->to_alpino );
+  int status;
+  bool done = false;
+  for ( int i=0; i < 50 && !done; ++i ){
+    done = ( waitpid( child->pid, &status, WNOHANG ) != 0 );
+    if ( !done ){
+      this_thread::sleep_for( chrono::milliseconds( 100 ) );
+    }
+  }
+  if ( !done ){
+    kill( child->pid, SIGKILL );
+    waitpid( child->pid, &status, 0 );
+  }
+  close( child->alive );
+  if ( child->watch >= 0 ){
+    close( child->watch );
+  }
+  // remove the XML files that nobody waited for, like after a timeout
+  DIR *dir = opendir( child->out_dir.c_str() );
+  if ( dir ){
+    while ( const dirent *entry = readdir( dir ) ){
+      string name = entry->d_name;
+      if ( name != "." && name != ".." ){
+	unlink( ( child->out_dir + name ).c_str() );
+      }
+    }
+    closedir( dir );
+  }
+  if ( rmdir( child->out_dir.c_str() ) < 0 ){
+    LOG << "unable to remove " << child->out_dir << ": " << strerror(errno)
+	<< endl;
+  }
+  delete child;
+}
+
+AlpinoPool::alpino_child *AlpinoPool::acquire(){
+  /// take an idle Alpino out of the pool, or start a new one
+  /*!
+    \return an Alpino child, ready to receive sentences
+
+    When the maximum number of Alpino's is running, this waits for one to
+    become available.
+  */
+  unique_lock<mutex> guard( pool_lock );
+  if ( owner != getpid() ){
+    // we are a forked child. The Alpino's are the parent's, so we only
+    // close our copies of the pipes
+    for ( const auto& c : idle ){
+      close( c->to_alpino );
+      close( c->alive );
+      if ( c->watch >= 0 ){
+	close( c->watch );
+      }
+      delete c;
+    }
+    idle.clear();
+    running = 0;
+    owner = getpid();
+  }
+  while ( idle.empty() && running >= max_children ){
+    available.wait( guard );
+  }
+  if ( !idle.empty() ){
+    alpino_child *result = idle.back();
+    idle.pop_back();
+    return result;
+  }
+  ++running;
+  guard.unlock();
+  try {
+    return start_child();
+  }
+  catch ( ... ){
+    guard.lock();
+    --running;
+    available.notify_one();
+    throw;
+  }
+}
+
+void AlpinoPool::release( alpino_child *child ){
+  /// return an Alpino to the pool
+  lock_guard<mutex> guard( pool_lock );
+  idle.push_back( child );
+  available.notify_one();
+}
+
+void AlpinoPool::discard( alpino_child *child ){
+  /// stop a failing Alpino, making room for a new one
+  LOG << "stopping Alpino process " << child->pid << endl;
+  stop_child( child );
+  lock_guard<mutex> guard( pool_lock );
+  --running;
+  available.notify_one();
+}
+
+static bool read_complete( const string& file_name, string& xml ){
+  /// read an XML file Alpino wrote, if it is complete
+  ifstream is( file_name );
+  if ( !is ){
+    return false;
+  }
+  stringstream ss;
+  ss << is.rdbuf();
+  xml = ss.str();
+  // Alpino may still be writing it
+  return xml.find( "</alpino_ds>" ) != string::npos;
+}
+
+bool AlpinoPool::wait_for( alpino_child *child,
+			   const string& key,
+			   string& xml ) const {
+  /// wait until Alpino has written the parse for \e key
+  /*!
+    \param child the Alpino that is parsing
+    \param key the key of the sentence
+    \param xml the XML Alpino produced
+    \return false when Alpino died or didn't finish in time
+
+    We sleep until inotify tells a file in the output directory is written,
+    or until Alpino exits and hangs up its end of the 'alive' pipe. Without
+    inotify we look again every 50 milliseconds.
+  */
+  const string file_name = child->out_dir + key + ".xml";
+  auto deadline = chrono::steady_clock::now() + chrono::seconds( timeout );
+  while ( true ){
+    if ( read_complete( file_name, xml ) ){
+      unlink( file_name.c_str() );
+      return true;
+    }
+    auto left = chrono::duration_cast<chrono::milliseconds>
+      ( deadline - chrono::steady_clock::now() ).count();
+    if ( left <= 0 ){
+      break;
+    }
+    pollfd fds[2];
+    fds[0].fd = child->alive;
+    fds[0].events = POLLIN;
+    fds[1].fd = child->watch;
+    fds[1].events = POLLIN;
+    int wait_ms = ( child->watch >= 0 ) ? left : min<long>( left, 50 );
+    int num = poll( fds, child->watch >= 0 ? 2 : 1, wait_ms );
+    if ( num < 0 && errno != EINTR ){
+      LOG << "waiting for Alpino failed: " << strerror(errno) << endl;
+      return false;
+    }
+    if ( num > 0 && fds[0].revents ){
+      // Alpino is gone, but may have finished our sentence first
+      if ( read_complete( file_name, xml ) ){
+	unlink( file_name.c_str() );
+	return true;
+      }
+      LOG << "Alpino process " << child->pid << " died" << endl;
+      return false;
+    }
+#ifdef HAVE_SYS_INOTIFY_H
+    if ( num > 0 && child->watch >= 0 && fds[1].revents ){
+      // we only need to know something happened
+      char buf[4096];
+      while ( read( child->watch, buf, sizeof(buf) ) > 0 ){
+      }
+    }
+#endif
+  }
+  LOG << "Alpino process " << child->pid << " didn't parse " << key
+      << " within " << timeout << " seconds" << endl;
+  return false;
+}
+
+static int write_all( int fd, const string& data ){
+  /// write \e data to a pipe, without getting SIGPIPE when the reader is gone
+  /*!
+    \param fd the pipe
+    \param data the bytes to write
+    \return 0 on succes, or the errno of the failing write
+
+    SIGPIPE is blocked in this thread only, so the signal disposition of the
+    process is left alone. A SIGPIPE we caused is taken before unblocking.
+  */
+  sigset_t pipe_set;
+  sigset_t old_set;
+  sigemptyset( &pipe_set );
+  sigaddset( &pipe_set, SIGPIPE );
+  pthread_sigmask( SIG_BLOCK, &pipe_set, &old_set );
+  sigset_t pending;
+  sigpending( &pending );
+  bool was_pending = sigismember( &pending, SIGPIPE );
+  int result = 0;
+  const char *pnt = data.c_str();
+  size_t left = data.size();
+  while ( left > 0 ){
+    ssize_t written = write( fd, pnt, left );
+    if ( written < 0 ){
+      if ( errno == EINTR ){
+	continue;
+      }
+      result = errno;
+      break;
+    }
+    pnt += written;
+    left -= written;
+  }
+  if ( result == EPIPE && !was_pending ){
+    const timespec no_wait = { 0, 0 };
+    sigtimedwait( &pipe_set, NULL, &no_wait );
+  }
+  pthread_sigmask( SIG_SETMASK, &old_set, NULL );
+  return result;
+}
+
+vector<string> AlpinoPool::parse( const vector<string>& sentences ){
+  /// parse a batch of sentences
+  /*!
+    \param sentences the tokenized sentences to parse
+    \return the Alpino XML for every sentence
+
+    All sentences are handed to 1 Alpino at once. The results are matched
+    back by their key. This will throw when Alpino fails. The failing Alpino
+    is replaced by a fresh one on the next call.
+  */
+  vector<string> result;
+  if ( sentences.empty() ){
+    return result;
+  }
+  alpino_child *child = acquire();
+  vector<string> keys;
+  string input;
+  for ( const auto& sent : sentences ){
+    string key = "s" + to_string( ++child->counter );
+    keys.push_back( key );
+    // Alpino uses the '|' as separator between key and sentence
+    string line = sent;
+    replace( line.begin(), line.end(), '\n', ' ' );
+    input += key + "|" + line + "\n";
+  }
+  int err = write_all( child->to_alpino, input );
+  if ( err != 0 ){
+    string mess = strerror(err);
+    discard( child );
+    throw runtime_error( "sending sentences to Alpino failed: " + mess );
+  }
+  for ( const auto& key : keys ){
+    string xml;
+    if ( !wait_for( child, key, xml ) ){
+      discard( child );
+      throw runtime_error( "Alpino failed to parse sentence " + key );
+    }
+    result.push_back( xml );
+  }
+  release( child );
+  return result;
+}
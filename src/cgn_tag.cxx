@@ -0,0 +1,102 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include "frog/cgn_tag.h"
+
+#include <unordered_map>
+#include <memory>
+#include <shared_mutex>
+#include <mutex>
+#include <algorithm>
+#include "ticcutils/StringOps.h"
+#include "ticcutils/Unicode.h"
+
+using namespace std;
+using icu::UnicodeString;
+
+cgn_tag::cgn_tag( const symbol& t ):
+  tag( t )
+{
+  /// parse a CGN tag
+  /*!
+    \param t the tag. e.g. WW(pv,tgw,met-t) is split in the head 'WW', the
+    features 'pv', 'tgw' and 'met-t' and the mods 'pv|tgw|met-t'
+  */
+  vector<UnicodeString> v = TiCC::split_at_first_of( t.str(), "()" );
+  if ( v.empty() ){
+    return;
+  }
+  head = symbol( v[0] );
+  if ( v.size() > 1 ){
+    vector<UnicodeString> feats = TiCC::split_at( v[1], "," );
+    for ( const auto& f : feats ){
+      if ( !features.empty() ){
+	mods += "|";
+      }
+      mods += f;
+      features.push_back( symbol( f ) );
+    }
+  }
+}
+
+bool cgn_tag::has_part( const symbol& part ) const {
+  /// check if a symbol is the head or one of the features of this tag
+  /*!
+    \param part the symbol to look for
+    \return true when found
+  */
+  return part == head
+    || std::find( features.begin(), features.end(), part ) != features.end();
+}
+
+const cgn_tag& cgn_tag::get( const symbol& tag ){
+  /// return the parsed version of a tag
+  /*!
+    \param tag the tag to look up
+    \return the parsed tag. It is parsed on first use and stays valid for
+    the lifetime of the process.
+  */
+  static shared_mutex lock;
+  static unordered_map<uint32_t,unique_ptr<const cgn_tag>> parsed;
+  {
+    shared_lock<shared_mutex> guard( lock );
+    auto it = parsed.find( tag.id() );
+    if ( it != parsed.end() ){
+      return *it->second;
+    }
+  }
+  unique_lock<shared_mutex> guard( lock );
+  auto& entry = parsed[tag.id()];
+  if ( !entry ){
+    entry.reset( new cgn_tag( tag ) );
+  }
+  return *entry;
+}
@@ -31,6 +31,7 @@
 
 #include "frog/cgn_tagger_mod.h"
 #include "frog/FrogData.h"
+#include "frog/cgn_tag.h"
 #include "frog/Frog-util.h"
 #include "ticcutils/Unicode.h"
 #include "ticcutils/PrettyPrint.h"
@@ -38,6 +39,7 @@
 using namespace std;
 using namespace Tagger;
 using TiCC::operator<<;
+using icu::UnicodeString;
 
 #define LOG *TiCC::Log(err_log)
 #define DBG *TiCC::Log(dbg_log)
@@ -47,6 +49,44 @@ static string subsets_file = "subsets.cgn";
 /// default value for the name of the CGN constraints file
 static string constraints_file = "constraints.cgn";
 
+namespace {
+  string encode_table( const multimap<string,string>& table ){
+    /// store a subsets or constraints table in a bundle section
+    /*!
+      \param table the table
+      \return the section data: a list of key and value pairs
+    */
+    vector<UnicodeString> fields;
+    for ( const auto& [key,value] : table ){
+      fields.push_back( TiCC::UnicodeFromUTF8( key ) );
+      fields.push_back( TiCC::UnicodeFromUTF8( value ) );
+    }
+    return ResourceBundle::encode_lines( fields );
+  }
+
+  bool decode_table( const char *data,
+		     size_t size,
+		     multimap<string,string>& table ){
+    /// read a table stored by encode_table()
+    /*!
+      \param data the section data
+      \param size the size of the data
+      \param table the table to fill
+      \return false when the data is corrupt
+    */
+    vector<UnicodeString> fields;
+    if ( !ResourceBundle::decode_lines( data, size, fields )
+	 || fields.size() % 2 != 0 ){
+      return false;
+    }
+    for ( size_t i=0; i < fields.size(); i += 2 ){
+      table.insert( make_pair( TiCC::UnicodeToUTF8( fields[i] ),
+			       TiCC::UnicodeToUTF8( fields[i+1] ) ) );
+    }
+    return true;
+  }
+}
+
 bool CGNTagger::fillSubSetTable( const string& sub_file,
 				 const string& const_file ){
   /// read als the CGN subsets and constraints
@@ -115,22 +155,54 @@ bool CGNTagger::fillSubSetTable( const string& sub_file,
   return true;
 }
 
-bool CGNTagger::init( const TiCC::Configuration& config ){
-  /// initalize a CGN tagger from 'config'
+bool CGNTagger::loadSubSetTable( const string& sub_file,
+				 const string& const_file ){
+  /// use the CGN subsets and constraints from the resource bundle
   /*!
-    \param config the TiCC::Configuration
-    \return true on succes, false otherwise
-
-    first BaseTagger::init() is called to set generic values,
-    then the CGN specific values for subset and constraints file-names are
-    added and those files are read, except when these have the value 'ignore'
+    \param sub_file The name of the subsets file
+    \param const_file The name of the constraints file. May be empty
+    \return false when the bundle has no up to date tables. The caller
+    should read the files then.
   */
-  if (  debug > 1 ){
-    DBG << "INIT CGN Tagger." << endl;
+  if ( !_bundle ){
+    return false;
   }
-  if ( !BaseTagger::init( config ) ){
+  multimap<string,string> subsets;
+  multimap<string,string> constraints;
+  const char *data = 0;
+  size_t size = 0;
+  if ( !_bundle->find( "tagger:subsets",
+		       make_stamp( "tagger:subsets", sub_file ),
+		       data, size ) ){
     return false;
   }
+  if ( !decode_table( data, size, subsets ) ){
+    LOG << "corrupt section tagger:subsets in resource bundle" << endl;
+    return false;
+  }
+  if ( !const_file.empty() ){
+    if ( !_bundle->find( "tagger:constraints",
+			 make_stamp( "tagger:constraints", const_file ),
+			 data, size ) ){
+      return false;
+    }
+    if ( !decode_table( data, size, constraints ) ){
+      LOG << "corrupt section tagger:constraints in resource bundle" << endl;
+      return false;
+    }
+  }
+  cgnSubSets.swap( subsets );
+  cgnConstraints.swap( constraints );
+  LOG << "using precompiled subsets" << endl;
+  return true;
+}
+
+bool CGNTagger::subset_files( const TiCC::Configuration& config ){
+  /// find the names of the subsets and constraints files
+  /*!
+    \param config the TiCC::Configuration
+    \return false when the settings conflict
+  */
   string val = config.lookUp( "subsets_file", "tagger" );
   if ( !val.empty() ){
     subsets_file = val;
@@ -153,7 +225,32 @@ bool CGNTagger::init( const TiCC::Configuration& config ){
   else {
     constraints_file = prefix( config.configDir(), constraints_file );
   }
-  if ( subsets_file != "ignore" ){
+  return true;
+}
+
+bool CGNTagger::init( const TiCC::Configuration& config,
+		      const BaseTagger *model ){
+  /// initalize a CGN tagger from 'config'
+  /*!
+    \param config the TiCC::Configuration
+    \param model an already initialized tagger to share the models with
+    \return true on succes, false otherwise
+
+    first BaseTagger::init() is called to set generic values,
+    then the CGN specific values for subset and constraints file-names are
+    added and those files are read, except when these have the value 'ignore'
+  */
+  if (  debug > 1 ){
+    DBG << "INIT CGN Tagger." << endl;
+  }
+  if ( !BaseTagger::init( config, model ) ){
+    return false;
+  }
+  if ( !subset_files( config ) ){
+    return false;
+  }
+  if ( subsets_file != "ignore"
+       && !loadSubSetTable( subsets_file, constraints_file ) ){
     if ( !fillSubSetTable( subsets_file, constraints_file ) ){
       return false;
     }
@@ -164,6 +261,37 @@ bool CGNTagger::init( const TiCC::Configuration& config ){
   return true;
 }
 
+bool CGNTagger::compile_resources( const TiCC::Configuration& config,
+				   vector<ResourceBundle::section>& sections ){
+  /// read the subsets and constraints and add them to a resource bundle
+  /*!
+    \param config the TiCC::Configuration
+    \param sections the list of sections to add the tables to
+    \return false when reading the tables failed
+  */
+  if ( !subset_files( config ) ){
+    return false;
+  }
+  if ( subsets_file == "ignore" ){
+    return true;
+  }
+  if ( !fillSubSetTable( subsets_file, constraints_file ) ){
+    return false;
+  }
+  ResourceBundle::section sec;
+  sec.name = "tagger:subsets";
+  sec.stamp = make_stamp( "tagger:subsets", subsets_file );
+  sec.data = encode_table( cgnSubSets );
+  sections.push_back( sec );
+  if ( !constraints_file.empty() ){
+    sec.name = "tagger:constraints";
+    sec.stamp = make_stamp( "tagger:constraints", constraints_file );
+    sec.data = encode_table( cgnConstraints );
+    sections.push_back( sec );
+  }
+  return true;
+}
+
 void CGNTagger::add_declaration( folia::Document& doc,
 				 folia::processor *proc ) const {
   /// add POS annotation as an AnnotationType to the document
@@ -238,7 +366,7 @@ void CGNTagger::post_process( frog_data& words ){
 	    _tag_result[i].assigned_tag(),
 	    _tag_result[i].confidence() );
     if ( i < _tag_result.size()-1 ){
-      words.units[i].next_tag = _tag_result[i+1].assigned_tag();
+      words.units[i].next_tag = symbol( _tag_result[i+1].assigned_tag() );
     }
   }
 }
@@ -258,10 +386,13 @@ void CGNTagger::addTag( frog_record& fd,
     Also a token_tag_map may be used to POST correct the found tags for
     specific Ucto token_classes. e.g. an EMOTICON might be translated to a
     SPEC(SYMB) or a PUNCTUATION to a LET()
+
+    The tag is also stored in its parsed form, for use by the later modules.
   */
 #pragma omp critical (dataupdate)
   {
-    fd.tag = inputTag;
+    fd.tag = symbol( inputTag );
+    fd.tag_info = &cgn_tag::get( fd.tag );
     if ( inputTag.indexOf( "SPEC(" ) == 0 ){
       fd.tag_confidence = 1.0;
     }
@@ -281,7 +412,8 @@ void CGNTagger::addTag( frog_record& fd,
     }
 #pragma omp critical (dataupdate)
     {
-      fd.tag = tt->second;
+      fd.tag = symbol( tt->second );
+      fd.tag_info = &cgn_tag::get( fd.tag );
       fd.tag_confidence = 1.0;
     }
   }
@@ -310,8 +442,8 @@ void CGNTagger::add_tags( const vector<folia::Word*>& wv,
     {
       postag = wv[pos]->addPosAnnotation( u_args );
     }
-    vector<UnicodeString> hv = TiCC::split_at_first_of( word.tag, "()" );
-    UnicodeString head = hv[0];
+    const cgn_tag& parsed = word.cgn();
+    const UnicodeString& head = parsed.head;
     u_args["class"] = TiCC::UnicodeToUTF8(head);
 #pragma omp critical (foliaupdate)
     {
@@ -320,14 +452,15 @@ void CGNTagger::add_tags( const vector<folia::Word*>& wv,
 	postag->confidence(1.0);
       }
     }
-    if ( hv.size() > 1 ){
-      vector<UnicodeString> feats = TiCC::split_at( hv[1], "," );
-      for ( const auto& f : feats ){
+    if ( !parsed.features.empty() ){
+      string utf8_head = TiCC::UnicodeToUTF8(head);
+      string utf8_tag = TiCC::UnicodeToUTF8(word.tag);
+      for ( const auto& f : parsed.features ){
 	folia::KWargs f_args;
 	f_args["set"] =  getTagset();
 	f_args["subset"] = getSubSet( TiCC::UnicodeToUTF8(f),
-				      TiCC::UnicodeToUTF8(head),
-				      TiCC::UnicodeToUTF8(word.tag) );
+				      utf8_head,
+				      utf8_tag );
 	f_args["class"]  = TiCC::UnicodeToUTF8(f);
 #pragma omp critical (foliaupdate)
 	{
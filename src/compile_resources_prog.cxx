@@ -0,0 +1,166 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include <string>
+#include <iostream>
+#include <vector>
+
+#include "config.h"
+#include "ticcutils/LogStream.h"
+#include "ticcutils/Configuration.h"
+#include "ticcutils/CommandLine.h"
+#include "ticcutils/StringOps.h"
+#include "frog/Frog-util.h"
+#include "frog/resource_bundle.h"
+#include "frog/mwu_chunker_mod.h"
+#include "frog/ner_tagger_mod.h"
+#include "frog/cgn_tagger_mod.h"
+#include "frog/mblem_mod.h"
+#include "frog/mbma_mod.h"
+
+using namespace std;
+
+TiCC::LogStream my_default_log( cerr ); // fall-back
+TiCC::LogStream *theErrLog = &my_default_log;  // fill the externals
+
+string bundleName;
+
+TiCC::Configuration configuration;
+static string configDir = string(SYSCONF_PATH) + "/" + PACKAGE + "/nld/";
+static string configFileName = configDir + "frog.cfg";
+
+void usage( ) {
+  cout << endl << "frog-compile-resources [options]" << endl
+       << "Compile the MWU list, the NER gazeteers and the tag tables of a"
+       << endl << "configuration into one binary resource bundle, which Frog maps"
+       << endl << "at startup instead of parsing the text files." << endl;
+  cout << "Options:\n"
+       << "\t -c <filename>    Set configuration file (default " << configFileName << ")\n"
+       << "\t -o <filename>    the bundle to write. (default the 'resource_bundle'\n"
+       << "\t\t entry of the configuration)\n"
+       << "\t -h. give some help.\n"
+       << "\t -V or --version .   Show version info.\n"
+       << "\t -d <debug level>    (for more verbosity)\n";
+}
+
+bool parse_args( TiCC::CL_Options& Opts ) {
+  if ( Opts.is_present('V') || Opts.is_present("version" ) ){
+    // we already did show what we wanted.
+    exit( EXIT_SUCCESS );
+  }
+  if ( Opts.is_present ('h') ) {
+    usage();
+    exit( EXIT_SUCCESS );
+  };
+  Opts.extract( 'c', configFileName );
+  if ( configuration.fill( configFileName ) ){
+    cerr << "config read from: " << configFileName << endl;
+  }
+  else {
+    cerr << "failed to read configuration from! '" << configFileName << "'" << endl;
+    cerr << "did you correctly install the frogdata package?" << endl;
+    return false;
+  }
+  string value;
+  if ( Opts.extract( 'd', value ) ) {
+    int debug = 0;
+    if ( !TiCC::stringTo<int>( value, debug ) ){
+      cerr << "-d value should be an integer" << endl;
+      return false;
+    }
+    configuration.setatt( "debug", value, "mwu" );
+    configuration.setatt( "debug", value, "NER" );
+    configuration.setatt( "debug", value, "tagger" );
+    configuration.setatt( "debug", value, "mblem" );
+    configuration.setatt( "debug", value, "mbma" );
+  }
+  if ( !Opts.extract( 'o', bundleName ) ){
+    bundleName = configuration.lookUp( "resource_bundle" );
+    if ( bundleName.empty() ){
+      cerr << "no -o option and no 'resource_bundle' in the configuration"
+	   << endl;
+      return false;
+    }
+    bundleName = prefix( configuration.configDir(), bundleName );
+  }
+  return true;
+}
+
+int main( int argc, char *argv[] ) {
+  std::ios_base::sync_with_stdio(false);
+  cerr << "frog-compile-resources " << VERSION << " (c) CLST, ILK 2024." << endl;
+  TiCC::CL_Options Opts( "c:d:hVo:", "version" );
+  try {
+    Opts.init( argc, argv );
+  }
+  catch ( const exception& e ){
+    cerr << "fatal error: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+  if ( !parse_args( Opts ) ){
+    return EXIT_FAILURE;
+  }
+  vector<ResourceBundle::section> sections;
+  Mwu myMwu( theErrLog, theErrLog );
+  if ( !myMwu.compile_resources( configuration, sections ) ){
+    cerr << "compiling the MWU's failed." << endl;
+    return EXIT_FAILURE;
+  }
+  NERTagger myNER( theErrLog, theErrLog );
+  if ( !myNER.compile_resources( configuration, sections ) ){
+    cerr << "compiling the NER gazeteers failed." << endl;
+    return EXIT_FAILURE;
+  }
+  CGNTagger myCGN( theErrLog, theErrLog );
+  if ( !myCGN.compile_resources( configuration, sections ) ){
+    cerr << "compiling the CGN subsets failed." << endl;
+    return EXIT_FAILURE;
+  }
+  Mblem myMblem( theErrLog, theErrLog );
+  if ( !myMblem.compile_resources( configuration, sections ) ){
+    cerr << "compiling the token-strip rules failed." << endl;
+    return EXIT_FAILURE;
+  }
+  Mbma myMbma( theErrLog, theErrLog );
+  if ( !myMbma.compile_resources( configuration, sections ) ){
+    cerr << "compiling the CGN-CELEX tables failed." << endl;
+    return EXIT_FAILURE;
+  }
+  if ( !ResourceBundle::write( bundleName, sections ) ){
+    cerr << "unable to write: " << bundleName << endl;
+    return EXIT_FAILURE;
+  }
+  for ( const auto& sec : sections ){
+    cerr << sec.name << ": " << sec.data.size() << " bytes" << endl;
+  }
+  cerr << "done, written " << bundleName << endl;
+  return EXIT_SUCCESS;
+}
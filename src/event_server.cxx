@@ -0,0 +1,847 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include "frog/event_server.h"
+
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <stdexcept>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "config.h"
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+using namespace std;
+
+#define LOG *TiCC::Log(errLog)
+
+const size_t MAX_EVENTS = 64;
+const size_t READ_CHUNK = 65536;
+
+EventServer::EventServer( int fd,
+			  Framing frm,
+			  const request_handler& h,
+			  size_t num,
+			  TiCC::LogStream *errlog,
+			  const server_limits& lim ):
+  listen_fd( fd ),
+  epoll_fd( -1 ),
+  framing( frm ),
+  handler( h ),
+  num_workers( num > 0 ? num : 1 ),
+  limits( lim ),
+  running( 0 ),
+  next_serial( 0 ),
+  num_requests( 0 )
+{
+  /// create an EventServer on an already listening socket
+  /*!
+    \param fd the file descriptor of the listening socket
+    \param frm the way requests are delimited
+    \param h the handler to call for every complete request
+    \param num the number of analysis processes to run the handler in
+    \param errlog the LogStream for messages
+    \param lim the limits to enforce
+  */
+  errLog = new TiCC::LogStream( errlog );
+  errLog->add_message( "event-server-" );
+}
+
+EventServer::~EventServer(){
+  /// close all connections, but leave the listening socket alone
+  stop_workers();
+  for ( const auto& it : connections ){
+    close( it.first );
+  }
+  if ( epoll_fd >= 0 ){
+    close( epoll_fd );
+  }
+  delete errLog;
+}
+
+void EventServer::stop_workers(){
+  /// stop the analysis processes
+  /*!
+    Closing its channel tells a process to stop, after finishing the request
+    it may be working on.
+  */
+  for ( auto& w : workers ){
+    if ( w.fd >= 0 ){
+      close( w.fd );
+      w.fd = -1;
+    }
+  }
+  for ( auto& w : workers ){
+    if ( w.pid > 0 ){
+      waitpid( w.pid, NULL, 0 );
+      w.pid = -1;
+    }
+  }
+  worker_index.clear();
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+static bool set_nonblocking( int fd ){
+  int flags = fcntl( fd, F_GETFL, 0 );
+  return flags >= 0
+    && fcntl( fd, F_SETFL, flags | O_NONBLOCK ) == 0;
+}
+
+static bool read_all( int fd, char *data, size_t size, const bool& keep_running ){
+  /// read exactly \e size bytes from a blocking descriptor
+  while ( size > 0 ){
+    ssize_t len = read( fd, data, size );
+    if ( len > 0 ){
+      data += len;
+      size -= len;
+    }
+    else if ( len < 0 && errno == EINTR && keep_running ){
+      continue;
+    }
+    else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool write_all( int fd, const string& data ){
+  /// write all of \e data to a blocking socket
+  size_t done = 0;
+  while ( done < data.size() ){
+    ssize_t len = send( fd, data.data() + done, data.size() - done,
+			MSG_NOSIGNAL );
+    if ( len >= 0 ){
+      done += len;
+    }
+    else if ( errno != EINTR ){
+      return false;
+    }
+  }
+  return true;
+}
+
+void EventServer::run( const bool& keep_running ){
+  /// run the event loop until \e keep_running becomes false
+  /*!
+    \param keep_running a flag, presumably cleared by a signal handler
+
+    The analysis processes are forked first. The listening socket is made
+    non-blocking, so it can be shared by several processes running an
+    EventServer.
+  */
+  running = &keep_running;
+  epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+  if ( epoll_fd < 0 ){
+    throw runtime_error( string("epoll_create1 failed: ") + strerror(errno) );
+  }
+  if ( !set_nonblocking( listen_fd ) ){
+    throw runtime_error( string("unable to make the listening socket non-blocking: ")
+			 + strerror(errno) );
+  }
+  workers.resize( num_workers );
+  for ( auto& w : workers ){
+    if ( !start_worker( w ) ){
+      throw runtime_error( "unable to start the analysis workers" );
+    }
+  }
+  LOG << "started " << workers.size() << " analysis workers" << endl;
+  epoll_event ev;
+  memset( &ev, 0, sizeof(ev) );
+  ev.events = EPOLLIN;
+#ifdef EPOLLEXCLUSIVE
+  // only wake 1 of the processes waiting on the same socket
+  ev.events |= EPOLLEXCLUSIVE;
+#endif
+  ev.data.fd = listen_fd;
+  if ( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev ) < 0 ){
+    throw runtime_error( string("epoll_ctl failed: ") + strerror(errno) );
+  }
+  vector<epoll_event> events( MAX_EVENTS );
+  while ( keep_running ){
+    int num = epoll_wait( epoll_fd, events.data(), events.size(), -1 );
+    if ( num < 0 ){
+      if ( errno == EINTR ){
+	continue;
+      }
+      throw runtime_error( string("epoll_wait failed: ") + strerror(errno) );
+    }
+    for ( int i=0; i < num; ++i ){
+      int fd = events[i].data.fd;
+      if ( fd == listen_fd ){
+	accept_connections();
+	continue;
+      }
+      auto const wit = worker_index.find( fd );
+      if ( wit != worker_index.end() ){
+	handle_worker( workers[wit->second], events[i].events );
+	continue;
+      }
+      auto const cit = connections.find( fd );
+      if ( cit == connections.end() ){
+	continue; // already closed while handling an earlier event
+      }
+      if ( cit->second.input_done ){
+	if ( events[i].events & (EPOLLHUP|EPOLLERR) ){
+	  // the client is gone, no use to wait for its replies
+	  close_connection( fd );
+	  continue;
+	}
+      }
+      else if ( events[i].events & (EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR) ){
+	handle_input( fd );
+      }
+      if ( connections.find( fd ) != connections.end()
+	   && ( events[i].events & EPOLLOUT ) ){
+	flush( fd );
+      }
+    }
+    dispatch();
+  }
+  stop_workers();
+}
+
+bool EventServer::start_worker( analysis_worker& w ){
+  /// fork an analysis process, connected to us by a socket pair
+  /*!
+    \param w the administration of the worker to (re)start
+    \return false when we failed
+  */
+  int fds[2];
+  if ( socketpair( AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, fds ) < 0 ){
+    LOG << "socketpair failed: " << strerror(errno) << endl;
+    return false;
+  }
+  pid_t pid = fork();
+  if ( pid < 0 ){
+    LOG << "unable to fork an analysis worker: " << strerror(errno) << endl;
+    close( fds[0] );
+    close( fds[1] );
+    return false;
+  }
+  if ( pid == 0 ){
+    // the analysis process doesn't need any of the descriptors of the loop
+    close( fds[0] );
+    close( epoll_fd );
+    close( listen_fd );
+    for ( const auto& it : connections ){
+      close( it.first );
+    }
+    for ( const auto& other : workers ){
+      if ( other.fd >= 0 ){
+	close( other.fd );
+      }
+    }
+    serve_requests( fds[1] );
+    // don't run the destructors of our parent's objects
+    _exit( EXIT_SUCCESS );
+  }
+  close( fds[1] );
+  w = analysis_worker();
+  w.pid = pid;
+  w.fd = fds[0];
+  if ( !set_nonblocking( w.fd )
+       || !watch( w.fd, EPOLLIN, true ) ){
+    LOG << "unable to watch analysis worker " << pid << endl;
+    close( w.fd );
+    w.fd = -1;
+    kill( pid, SIGKILL );
+    waitpid( pid, NULL, 0 );
+    w.pid = -1;
+    return false;
+  }
+  worker_index[w.fd] = &w - workers.data();
+  return true;
+}
+
+void EventServer::serve_requests( int fd ){
+  /// the loop of an analysis process
+  /*!
+    \param fd our end of the channel to the event loop
+
+    Every message on the channel is the size of a request, as an uint64_t,
+    followed by the request. We answer with 1 byte, which is 0 when the
+    connection should be closed, the size of the reply and the reply.
+    We stop when the channel is closed.
+  */
+  while ( true ){
+    uint64_t size = 0;
+    if ( !read_all( fd, reinterpret_cast<char*>(&size), sizeof(size),
+		    *running ) ){
+      break;
+    }
+    string request( size, '\0' );
+    if ( size > 0
+	 && !read_all( fd, &request[0], size, *running ) ){
+      break;
+    }
+    string reply;
+    bool keep_open = true;
+    try {
+      keep_open = handler( request, reply );
+    }
+    catch ( const exception& e ){
+      LOG << "request failed: " << e.what() << endl;
+      reply.clear();
+      keep_open = false;
+    }
+    string message( 1, keep_open ? 1 : 0 );
+    uint64_t reply_size = reply.size();
+    message.append( reinterpret_cast<const char*>(&reply_size),
+		    sizeof(reply_size) );
+    message += reply;
+    if ( !write_all( fd, message ) ){
+      break;
+    }
+  }
+  close( fd );
+}
+
+void EventServer::accept_connections(){
+  /// accept all pending connections
+  while ( true ){
+    int fd = accept4( listen_fd, NULL, NULL, SOCK_NONBLOCK|SOCK_CLOEXEC );
+    if ( fd < 0 ){
+      if ( errno != EAGAIN
+	   && errno != EWOULDBLOCK
+	   && errno != EINTR ){
+	LOG << "accept failed: " << strerror(errno) << endl;
+      }
+      // some other process may have been faster
+      return;
+    }
+    if ( limits.max_connections > 0
+	 && connections.size() >= limits.max_connections ){
+      LOG << "too many connections (" << connections.size()
+	  << "), refusing a new one" << endl;
+      refuse( fd, limits.busy_reply );
+      continue;
+    }
+    const uint32_t events = EPOLLIN|EPOLLRDHUP;
+    if ( !watch( fd, events, true ) ){
+      LOG << "unable to watch connection: " << strerror(errno) << endl;
+      close( fd );
+      continue;
+    }
+    connection_state& state = connections[fd];
+    state = connection_state();
+    state.serial = ++next_serial;
+    state.events = events;
+    LOG << "New connection, socketid=" << fd
+	<< " (" << connections.size() << " open)" << endl;
+  }
+}
+
+void EventServer::handle_input( int fd ){
+  /// read everything available on connection \e fd and queue the requests
+  /*!
+    \param fd the connection to read
+
+    Complete requests are queued right away. When the client closed its side,
+    a last incomplete request is queued too. (like the blocking server does)
+  */
+  connection_state& state = connections[fd];
+  bool at_eof = false;
+  char buf[READ_CHUNK];
+  while ( true ){
+    ssize_t len = read( fd, buf, sizeof(buf) );
+    if ( len > 0 ){
+      state.in_buf.append( buf, len );
+      if ( limits.max_request_size > 0 ){
+	// check while reading, so a client can't make us swallow everything
+	handle_lines( fd, state );
+	if ( !state.input_done && too_large( state ) ){
+	  LOG << "request on socketid=" << fd << " exceeds "
+	      << limits.max_request_size << " bytes" << endl;
+	  state.in_buf.clear();
+	  state.request.clear();
+	  state.last_reply = limits.too_large_reply;
+	  state.input_done = true;
+	}
+	if ( state.input_done ){
+	  break;
+	}
+      }
+    }
+    else if ( len == 0 ){
+      at_eof = true;
+      break;
+    }
+    else if ( errno == EINTR ){
+      continue;
+    }
+    else if ( errno == EAGAIN || errno == EWOULDBLOCK ){
+      break;
+    }
+    else {
+      LOG << "read failed on socketid=" << fd << ": "
+	  << strerror(errno) << endl;
+      close_connection( fd );
+      return;
+    }
+  }
+  handle_lines( fd, state );
+  if ( at_eof && !state.input_done ){
+    if ( !state.in_buf.empty() ){
+      // a last line without a newline
+      state.in_buf += "\n";
+      handle_lines( fd, state );
+    }
+    if ( framing != Framing::LINE
+	 && !state.request.empty() ){
+      queue_request( fd, state, state.request );
+      state.request.clear();
+    }
+    state.input_done = true;
+  }
+  if ( !state.in_flight && state.pending.empty() ){
+    state.out_buf += state.last_reply;
+    state.last_reply.clear();
+  }
+  flush( fd );
+}
+
+bool EventServer::too_large( const connection_state& state ) const {
+  /// check if the pending, incomplete, request is too large
+  return state.request.size() + state.in_buf.size() > limits.max_request_size;
+}
+
+void EventServer::refuse( int fd, const string& reply ) const {
+  /// send a last reply to a connection we won't serve, and close it
+  /*!
+    \param fd the new connection
+    \param reply the message for the client. It is sent without waiting,
+    so a client which doesn't read might miss it.
+  */
+  if ( !reply.empty() ){
+    ssize_t len = send( fd, reply.data(), reply.size(), MSG_NOSIGNAL );
+    if ( len < 0 ){
+      LOG << "unable to send a reply to socketid=" << fd << ": "
+	  << strerror(errno) << endl;
+    }
+  }
+  close( fd );
+}
+
+void EventServer::handle_lines( int fd, connection_state& state ){
+  /// split the input buffer in lines, and queue every complete request
+  /*!
+    \param fd the connection
+    \param state the state of that connection
+
+    The handled lines are removed from the buffer at once, at the end.
+  */
+  string::size_type start = 0;
+  string::size_type pos;
+  while ( !state.input_done
+	  && ( pos = state.in_buf.find( '\n', start ) ) != string::npos ){
+    string line = state.in_buf.substr( start, pos - start );
+    start = pos + 1;
+    if ( !line.empty() && line.back() == '\r' ){
+      line.pop_back();
+    }
+    switch ( framing ){
+    case Framing::LINE:
+      queue_request( fd, state, line );
+      break;
+    case Framing::EMPTY_LINE:
+      state.request += line + "\n";
+      if ( line.empty() ){
+	queue_request( fd, state, state.request );
+	state.request.clear();
+      }
+      break;
+    case Framing::EOT:
+      if ( line == "EOT" ){
+	queue_request( fd, state, state.request );
+	state.request.clear();
+      }
+      else {
+	state.request += line + "\n";
+      }
+      break;
+    }
+  }
+  state.in_buf.erase( 0, start );
+}
+
+void EventServer::queue_request( int fd,
+				 connection_state& state,
+				 const string& request ){
+  /// queue 1 complete request for the analysis workers
+  /*!
+    \param fd the connection the request came from
+    \param state the state of that connection
+    \param request the complete request
+
+    When limits.max_requests are already queued or being analyzed, the
+    request gets the busy reply instead, in its turn.
+  */
+  if ( limits.max_requests > 0
+       && num_requests >= limits.max_requests ){
+    LOG << "too many requests (" << num_requests
+	<< "), refusing one on socketid=" << fd << endl;
+    if ( !state.in_flight && state.pending.empty() ){
+      state.out_buf += limits.busy_reply;
+    }
+    else {
+      state.pending.push_back( queued_request{ limits.busy_reply, true } );
+    }
+    return;
+  }
+  ++num_requests;
+  state.pending.push_back( queued_request{ request, false } );
+  if ( !state.in_flight && state.pending.size() == 1 ){
+    ready.push_back( make_pair( fd, state.serial ) );
+  }
+}
+
+void EventServer::dispatch(){
+  /// hand queued requests to the idle analysis workers
+  for ( auto& w : workers ){
+    if ( ready.empty() ){
+      return;
+    }
+    if ( w.fd < 0 || w.conn_fd >= 0 ){
+      continue;
+    }
+    while ( !ready.empty() ){
+      auto [fd, serial] = ready.front();
+      ready.pop_front();
+      auto const it = connections.find( fd );
+      if ( it == connections.end()
+	   || it->second.serial != serial
+	   || it->second.in_flight
+	   || it->second.pending.empty() ){
+	continue; // closed, or nothing left to do
+      }
+      connection_state& state = it->second;
+      string request = std::move( state.pending.front().text );
+      state.pending.pop_front();
+      state.in_flight = true;
+      uint64_t size = request.size();
+      w.out_buf.append( reinterpret_cast<const char*>(&size), sizeof(size) );
+      w.out_buf += request;
+      w.conn_fd = fd;
+      w.conn_serial = serial;
+      flush_worker( w );
+      break;
+    }
+  }
+}
+
+void EventServer::drop_pending( connection_state& state ){
+  /// forget the requests of a connection that are still waiting
+  for ( const auto& req : state.pending ){
+    if ( !req.refused ){
+      --num_requests;
+    }
+  }
+  state.pending.clear();
+}
+
+void EventServer::handle_worker( analysis_worker& w, uint32_t events ){
+  /// handle the events on the channel of an analysis worker
+  /*!
+    \param w the worker
+    \param events the epoll events
+  */
+  if ( events & EPOLLOUT ){
+    flush_worker( w );
+    if ( w.fd < 0 ){
+      return;
+    }
+  }
+  if ( !( events & (EPOLLIN|EPOLLHUP|EPOLLERR) ) ){
+    return;
+  }
+  char buf[READ_CHUNK];
+  while ( true ){
+    ssize_t len = read( w.fd, buf, sizeof(buf) );
+    if ( len > 0 ){
+      w.in_buf.append( buf, len );
+    }
+    else if ( len == 0 ){
+      worker_failed( w );
+      return;
+    }
+    else if ( errno == EINTR ){
+      continue;
+    }
+    else if ( errno == EAGAIN || errno == EWOULDBLOCK ){
+      break;
+    }
+    else {
+      LOG << "read failed on analysis worker " << w.pid << ": "
+	  << strerror(errno) << endl;
+      worker_failed( w );
+      return;
+    }
+  }
+  const size_t head = 1 + sizeof(uint64_t);
+  string::size_type start = 0;
+  while ( w.in_buf.size() - start >= head ){
+    uint64_t size = 0;
+    memcpy( &size, w.in_buf.data() + start + 1, sizeof(size) );
+    if ( w.in_buf.size() - start - head < size ){
+      break;
+    }
+    bool keep_open = w.in_buf[start] != 0;
+    string reply = w.in_buf.substr( start + head, size );
+    start += head + size;
+    handle_reply( w, keep_open, reply );
+  }
+  w.in_buf.erase( 0, start );
+}
+
+void EventServer::handle_reply( analysis_worker& w,
+				bool keep_open,
+				const string& reply ){
+  /// pass the reply of an analysis worker on to its connection
+  /*!
+    \param w the worker, which is idle afterwards
+    \param keep_open false when the connection should be closed after the reply
+    \param reply the reply
+  */
+  int fd = w.conn_fd;
+  uint64_t serial = w.conn_serial;
+  w.conn_fd = -1;
+  --num_requests;
+  auto const it = connections.find( fd );
+  if ( it == connections.end()
+       || it->second.serial != serial ){
+    return; // the client is gone
+  }
+  connection_state& state = it->second;
+  state.in_flight = false;
+  state.out_buf += reply;
+  if ( !keep_open ){
+    drop_pending( state );
+    state.input_done = true;
+  }
+  else {
+    while ( !state.pending.empty()
+	    && state.pending.front().refused ){
+      state.out_buf += state.pending.front().text;
+      state.pending.pop_front();
+    }
+    if ( !state.pending.empty() ){
+      ready.push_back( make_pair( fd, serial ) );
+    }
+  }
+  if ( state.pending.empty() ){
+    state.out_buf += state.last_reply;
+    state.last_reply.clear();
+  }
+  flush( fd );
+}
+
+void EventServer::worker_failed( analysis_worker& w ){
+  /// clean up after an analysis worker that died, and start a new one
+  /*!
+    \param w the worker
+
+    The connection it was working for is closed, like it would have been
+    when the request threw.
+  */
+  LOG << "analysis worker " << w.pid << " stopped unexpectedly" << endl;
+  worker_index.erase( w.fd );
+  epoll_ctl( epoll_fd, EPOLL_CTL_DEL, w.fd, NULL );
+  close( w.fd );
+  w.fd = -1;
+  kill( w.pid, SIGKILL );
+  waitpid( w.pid, NULL, 0 );
+  w.pid = -1;
+  if ( w.conn_fd >= 0 ){
+    handle_reply( w, false, "" );
+  }
+  if ( *running && !start_worker( w ) ){
+    LOG << "unable to restart an analysis worker" << endl;
+    bool any_left = false;
+    for ( const auto& other : workers ){
+      any_left |= ( other.fd >= 0 );
+    }
+    if ( !any_left ){
+      throw runtime_error( "no analysis workers left" );
+    }
+  }
+}
+
+void EventServer::flush( int fd ){
+  /// write as much of the pending output of \e fd as possible
+  /*!
+    \param fd the connection to write to
+
+    closes the connection when all is written, and no more requests will
+    come or are being handled.
+  */
+  connection_state& state = connections[fd];
+  while ( !state.out_buf.empty() ){
+    ssize_t len = send( fd,
+			state.out_buf.data(),
+			state.out_buf.size(),
+			MSG_NOSIGNAL );
+    if ( len >= 0 ){
+      state.out_buf.erase( 0, len );
+    }
+    else if ( errno == EINTR ){
+      continue;
+    }
+    else if ( errno == EAGAIN || errno == EWOULDBLOCK ){
+      break;
+    }
+    else {
+      LOG << "write failed on socketid=" << fd << ": "
+	  << strerror(errno) << endl;
+      close_connection( fd );
+      return;
+    }
+  }
+  if ( state.out_buf.empty()
+       && state.input_done
+       && !state.in_flight
+       && state.pending.empty() ){
+    close_connection( fd );
+  }
+  else {
+    update_events( fd );
+  }
+}
+
+void EventServer::flush_worker( analysis_worker& w ){
+  /// write as much of the pending requests for \e w as possible
+  /*!
+    \param w the worker
+  */
+  while ( !w.out_buf.empty() ){
+    ssize_t len = send( w.fd,
+			w.out_buf.data(),
+			w.out_buf.size(),
+			MSG_NOSIGNAL );
+    if ( len >= 0 ){
+      w.out_buf.erase( 0, len );
+    }
+    else if ( errno == EINTR ){
+      continue;
+    }
+    else if ( errno == EAGAIN || errno == EWOULDBLOCK ){
+      break;
+    }
+    else {
+      LOG << "write failed on analysis worker " << w.pid << ": "
+	  << strerror(errno) << endl;
+      worker_failed( w );
+      return;
+    }
+  }
+  bool want_write = !w.out_buf.empty();
+  if ( want_write != w.want_write ){
+    if ( !watch( w.fd, want_write ? EPOLLIN|EPOLLOUT : EPOLLIN, false ) ){
+      worker_failed( w );
+      return;
+    }
+    w.want_write = want_write;
+  }
+}
+
+void EventServer::update_events( int fd ){
+  /// only wait for the events a connection needs
+  /*!
+    \param fd the connection
+
+    We read until the input is done, and wait for a connection to become
+    writable only when we have output.
+  */
+  connection_state& state = connections[fd];
+  uint32_t events = 0;
+  if ( !state.input_done ){
+    events |= EPOLLIN|EPOLLRDHUP;
+  }
+  if ( !state.out_buf.empty() ){
+    events |= EPOLLOUT;
+  }
+  if ( events == state.events ){
+    return;
+  }
+  if ( !watch( fd, events, false ) ){
+    LOG << "epoll_ctl failed on socketid=" << fd << ": "
+	<< strerror(errno) << endl;
+    close_connection( fd );
+    return;
+  }
+  state.events = events;
+}
+
+bool EventServer::watch( int fd, uint32_t events, bool add ){
+  /// add or change the epoll registration of \e fd
+  /*!
+    \param fd the descriptor
+    \param events the events to wait for
+    \param add true for a new descriptor
+    \return false when epoll_ctl failed
+  */
+  epoll_event ev;
+  memset( &ev, 0, sizeof(ev) );
+  ev.events = events;
+  ev.data.fd = fd;
+  return epoll_ctl( epoll_fd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+		    fd, &ev ) == 0;
+}
+
+void EventServer::close_connection( int fd ){
+  /// stop watching connection \e fd and close it
+  epoll_ctl( epoll_fd, EPOLL_CTL_DEL, fd, NULL );
+  close( fd );
+  auto const it = connections.find( fd );
+  if ( it != connections.end() ){
+    drop_pending( it->second );
+    connections.erase( it );
+  }
+  LOG << "Connection closed, socketid=" << fd
+      << " (" << connections.size() << " open)" << endl;
+}
+
+#else // HAVE_SYS_EPOLL_H
+
+void EventServer::run( const bool& ){
+  throw runtime_error( "EventServer: no epoll support on this system" );
+}
+
+#endif // HAVE_SYS_EPOLL_H
@@ -44,16 +44,18 @@ using namespace Tagger;
 
 static string POS_tagset = "http://ilk.uvt.nl/folia/sets/frog-mbpos-cgn";
 
-bool IOBTagger::init( const TiCC::Configuration& config ){
+bool IOBTagger::init( const TiCC::Configuration& config,
+		      const BaseTagger *model ){
   /// initalize a IOB chunker from 'config'
   /*!
     \param config the TiCC::Configuration
+    \param model an already initialized tagger to share the models with
     \return true on succes, false otherwise
 
     first BaseTagger::init() is called to set generic values,
     then the IOB specific values 'set' is added
   */
-  if ( !BaseTagger::init( config ) ){
+  if ( !BaseTagger::init( config, model ) ){
     return false;
   }
   string val = config.lookUp( "set", "tagger" );
@@ -75,12 +77,11 @@ void IOBTagger::add_declaration( folia::Document& doc,
   doc.declare( folia::AnnotationType::CHUNKING, tagset, args );
 }
 
-void IOBTagger::Classify( frog_data& swords ){
-  /// Tag one sentence, given in frog_data format
+vector<tag_entry> IOBTagger::extract_sentence( const frog_data& swords ){
+  /// create the input for the IOB tagger for one sentence
   /*!
     \param swords the frog_data structure to analyze
-
-    When tagging succeeds, 'swords' will be extended with the tag results
+    \return a list of tag_entry elements, enriched with the POS tags
   */
   vector<UnicodeString> words;
   vector<UnicodeString> ptags;
@@ -110,7 +111,14 @@ void IOBTagger::Classify( frog_data& swords ){
     }
     to_do.push_back( ta );
   }
-  _tag_result = tag_entries( to_do );
+  return to_do;
+}
+
+void IOBTagger::finish_sentence( frog_data& swords ){
+  /// add the tagger results in _tag_result to one sentence
+  /*!
+    \param swords the frog_data structure to extend
+  */
   if ( debug ){
     DBG << "IOB tagger out: " << endl;
     for ( size_t i=0; i < _tag_result.size(); ++i ){
@@ -169,7 +177,7 @@ void IOBTagger::addTag( frog_record& fd,
   */
 #pragma omp critical (dataupdate)
   {
-    fd.iob_tag = tag;
+    fd.iob_tag = symbol( tag );
     fd.iob_confidence = confidence;
   }
 }
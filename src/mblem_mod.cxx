@@ -40,6 +40,8 @@
 #include "ticcutils/SocketBasics.h"
 #include "ticcutils/json.hpp"
 #include "frog/Frog-util.h"
+#include "frog/server_pool.h"
+#include "frog/cgn_tag.h"
 
 using namespace std;
 using namespace nlohmann;
@@ -59,7 +61,14 @@ Mblem::Mblem( TiCC::LogStream *errlog, TiCC::LogStream *dbglog ):
   history(20),
   debug(0),
   keep_case( false ),
-  filter(0)
+  filter(0),
+  _cache(0),
+  _owns_cache( false ),
+  _table(0),
+  _owns_table( false ),
+  _disk_cache(0),
+  _owns_disk_cache( false ),
+  _bundle(0)
 {
   errLog = new TiCC::LogStream( errlog );
   errLog->add_message( "mblem-" );
@@ -115,10 +124,74 @@ bool Mblem::fill_ts_map( const string& file ){
   return true;
 }
 
-bool Mblem::init( const TiCC::Configuration& config ) {
+bool Mblem::load_ts_map( const string& file ){
+  /// use the 'token-strip' rules from the resource bundle
+  /*!
+    \param file name of the rules file
+    \return false when the bundle has no up to date rules. The caller
+    should use fill_ts_map() then.
+   */
+  const char *data = 0;
+  size_t size = 0;
+  if ( !_bundle
+       || !_bundle->find( "mblem:token_strip",
+			  make_stamp( "mblem:token_strip", file ),
+			  data, size ) ){
+    return false;
+  }
+  vector<UnicodeString> fields;
+  if ( !ResourceBundle::decode_lines( data, size, fields )
+       || fields.size() % 3 != 0 ){
+    LOG << "corrupt section mblem:token_strip in resource bundle" << endl;
+    return false;
+  }
+  for ( size_t i=0; i < fields.size(); i += 3 ){
+    token_strip_map[fields[i]].insert( make_pair( fields[i+1],
+						  TiCC::stringTo<int>( fields[i+2] ) ) );
+  }
+  LOG << "using precompiled mblem:token_strip" << endl;
+  return true;
+}
+
+bool Mblem::compile_resources( const TiCC::Configuration& config,
+			       vector<ResourceBundle::section>& sections ){
+  /// read the 'token-strip' rules and add them to a resource bundle
+  /*!
+    \param config the Configuration to use
+    \param sections the list of sections to add the rules to
+    \return false when reading the rules failed
+   */
+  string tokenStripFile = config.lookUp( "token_strip_file", "mblem" );
+  if ( tokenStripFile.empty() ){
+    return true;
+  }
+  tokenStripFile = prefix( config.configDir(), tokenStripFile );
+  if ( !fill_ts_map( tokenStripFile ) ){
+    return false;
+  }
+  vector<UnicodeString> fields;
+  for ( const auto& [tag,rules] : token_strip_map ){
+    for ( const auto& [cls,strip] : rules ){
+      fields.push_back( tag );
+      fields.push_back( cls );
+      fields.push_back( TiCC::toUnicodeString( strip ) );
+    }
+  }
+  ResourceBundle::section sec;
+  sec.name = "mblem:token_strip";
+  sec.stamp = make_stamp( "mblem:token_strip", tokenStripFile );
+  sec.data = ResourceBundle::encode_lines( fields );
+  sections.push_back( sec );
+  return true;
+}
+
+bool Mblem::init( const TiCC::Configuration& config,
+		  const Mblem *model ) {
   /// initialize the lemmatizer using the config
   /*!
     \param config the Configuration to use
+    \param model an already initialized Mblem. When given, we don't load
+    the instance base again, but create a Timbl clone which shares it.
     \return true when no problems are detected
   */
   LOG << "Initiating lemmatizer..." << endl;
@@ -187,6 +260,7 @@ bool Mblem::init( const TiCC::Configuration& config ) {
     treeName = "mblem.tree";
   }
   treeName = prefix( config.configDir(), treeName );
+  tree_name = treeName;
 
   string charFile = config.lookUp( "char_filter_file", "mblem" );
   if ( charFile.empty() ){
@@ -201,7 +275,8 @@ bool Mblem::init( const TiCC::Configuration& config ) {
   string tokenStripFile = config.lookUp( "token_strip_file", "mblem" );
   if ( !tokenStripFile.empty() ){
     tokenStripFile = prefix( config.configDir(), tokenStripFile );
-    if ( !fill_ts_map( tokenStripFile ) ){
+    if ( !load_ts_map( tokenStripFile )
+	 && !fill_ts_map( tokenStripFile ) ){
       return false;
     }
   }
@@ -227,6 +302,79 @@ bool Mblem::init( const TiCC::Configuration& config ) {
     textclass = "current";
   }
 
+  if ( model ){
+    // share the cache of the model
+    _cache = model->_cache;
+  }
+  else {
+    size_t cache_size = 100000;
+    par = config.lookUp( "cache_size", "mblem" );
+    if ( !par.empty() && !TiCC::stringTo<size_t>( par, cache_size ) ){
+      LOG << "invalid 'cache_size' value in configuration: " << par << endl;
+      return false;
+    }
+    if ( cache_size > 0 ){
+      _cache = new ResultCache<UnicodeString,
+			       vector<UnicodeString>,
+			       unicode_hash>( cache_size );
+      _owns_cache = true;
+    }
+  }
+
+  if ( model ){
+    _table = model->_table;
+  }
+  else {
+    string tableName = config.lookUp( "suffix_table", "mblem" );
+    if ( !tableName.empty() ){
+      tableName = prefix( config.configDir(), tableName );
+      _table = new SuffixTable( errLog );
+      if ( !_table->open( tableName, table_stamp() )
+	   || _table->history() != history ){
+	LOG << "not using suffix table: " << tableName << endl;
+	delete _table;
+	_table = 0;
+      }
+      else {
+	LOG << "using suffix table " << tableName << " with "
+	    << _table->size() << " entries" << endl;
+	_owns_table = true;
+      }
+    }
+  }
+
+  if ( model ){
+    _disk_cache = model->_disk_cache;
+  }
+  else {
+    // a cache file is written to, so it is NOT searched in the config dir
+    string cacheName = config.lookUp( "persistent_cache", "mblem" );
+    if ( !cacheName.empty() ){
+      string model_id = "mblem " + _version + " history="
+	+ to_string( history ) + " ";
+      string model_file;
+      if ( _host.empty() ){
+	model_id += treeName;
+	model_file = treeName;
+      }
+      else {
+	model_id += _host + ":" + _port + "/" + _base;
+      }
+      _disk_cache = new PersistentCache( errLog );
+      if ( _disk_cache->open( cacheName,
+			      make_stamp( model_id, model_file ) ) ){
+	LOG << "using cache file " << cacheName << " with "
+	    << _disk_cache->size() << " entries" << endl;
+	_owns_disk_cache = true;
+      }
+      else {
+	LOG << "not using cache file: " << cacheName << endl;
+	delete _disk_cache;
+	_disk_cache = 0;
+      }
+    }
+  }
+
   if ( _host.empty() ){
     string opts = config.lookUp( "timblOpts", "mblem" );
     if ( opts.empty() ){
@@ -234,6 +382,14 @@ bool Mblem::init( const TiCC::Configuration& config ) {
     }
     // make it silent
     opts += " +vs -vf -F TABBED";
+    if ( model ){
+      if ( !model->myLex ){
+	LOG << "unable to share the lemmatizer model: it isn't loaded" << endl;
+	return false;
+      }
+      myLex = new Timbl::TimblAPI( *model->myLex );
+      return myLex->Valid();
+    }
     //Read in (igtree) data
     myLex = new Timbl::TimblAPI(opts);
     return myLex->GetInstanceBase(treeName);
@@ -258,6 +414,15 @@ Mblem::~Mblem(){
   delete filter;
   delete myLex;
   myLex = 0;
+  if ( _owns_cache ){
+    delete _cache;
+  }
+  if ( _owns_table ){
+    delete _table;
+  }
+  if ( _owns_disk_cache ){
+    delete _disk_cache;
+  }
   if ( errLog != dbgLog ){
     delete dbgLog;
   }
@@ -293,61 +458,64 @@ UnicodeString Mblem::make_instance( const UnicodeString& in ) {
   return instance;
 }
 
-void Mblem::filterTag( const icu::UnicodeString& postag ){
+void Mblem::filterTag( const cgn_tag& postag ){
   /// filter all non-matching tags out of the mblem results
   /*!
-    \param postag the tag, given by the CGN-tagger, that should match
+    \param postag the parsed tag, given by the CGN-tagger, that should match
 
     Mblem produces a range of possible solutions with tags. We use the POS tag
     given by the CGN tagger to remove all solutions with a different tag
   */
   auto it = mblemResult.begin();
   while( it != mblemResult.end() ){
-    UnicodeString tag = it->getTag();
-    bool found = ( postag == tag );
+    const cgn_tag& tag = cgn_tag::get( symbol( it->getTag() ) );
+    bool found = ( postag.tag == tag.tag );
     if ( !found ){
       // try fuzzy matching. It't enough when the head tags match AND
       // all subtags from the lemmatizer are found in the postag of the Tagger
-      vector<UnicodeString> pos_parts = TiCC::split_at_first_of( postag, "(,)" );
-      vector<UnicodeString> tag_parts = TiCC::split_at_first_of( tag, "(,)" );
-      if ( pos_parts[0] == tag_parts[0] ){
+      if ( postag.head == tag.head ){
 	found = true;
 	// there is a chance
 	if ( debug > 2 ){
-	  DBG << "MISSCHIEN match van tag=" << tag
-	      << " in pos=" << postag << endl;
+	  DBG << "MISSCHIEN match van tag=" << tag.tag
+	      << " in pos=" << postag.tag << endl;
 	}
-	for ( const auto& pit : tag_parts ){
-	  if ( std::find( pos_parts.begin(), pos_parts.end(), pit ) != pos_parts.end() ){
-	    found = false;
-	    break;
+	if ( postag.has_part( tag.head ) ){
+	  found = false;
+	}
+	else {
+	  for ( const auto& pit : tag.features ){
+	    if ( postag.has_part( pit ) ){
+	      found = false;
+	      break;
+	    }
 	  }
 	}
 	if ( found ){
 	  if ( debug > 2 ){
-	    DBG << "fuzzy match van tag=" << tag
-		<< " in pos=" << postag << endl;
+	    DBG << "fuzzy match van tag=" << tag.tag
+		<< " in pos=" << postag.tag << endl;
 	  }
 	}
       }
     }
     if ( found ){
       if ( debug > 1 ){
-	DBG << "compare cgn-tag " << postag << " with mblem-tag " << tag
+	DBG << "compare cgn-tag " << postag.tag << " with mblem-tag " << tag.tag
 	    << "\n\t==> identical tags. KEEP"  << endl;
       }
       ++it;
     }
     else {
 	if ( debug > 1 ){
-	  DBG << "compare cgn-tag " << postag << " with mblem-tag " << tag
+	  DBG << "compare cgn-tag " << postag.tag << " with mblem-tag " << tag.tag
 	      << "\n\t==> different tags. REMOVE" << endl;
 	}
 	it = mblemResult.erase(it);
       }
   }
   if ( (debug > 1) && mblemResult.empty() ){
-    DBG << "NO CORRESPONDING TAG! " << postag << endl;
+    DBG << "NO CORRESPONDING TAG! " << postag.tag << endl;
   }
 }
 
@@ -401,34 +569,27 @@ void Mblem::add_provenance( folia::Document& doc,
   doc.declare( folia::AnnotationType::LEMMA, tagset, args );
 }
 
-void Mblem::Classify( frog_record& fd ){
-  /// add lemma information to the frog_data
+bool Mblem::fixed_lemma( const frog_record& fd, UnicodeString& uword ) const {
+  /// check if the lemma of a word can be determined without Timbl
   /*!
-    \param fd The frog_data
+    \param fd The frog_record of the word
+    \param uword the (filtered) word. When the lemma is fixed, this is
+    the lemma, otherwise it is the word to give to the classifier
+    \return true when the lemma is fixed
 
     this handles some special cases like ABBREVIATION, the token-strip rules
     and the one-one rules.
-    All 'normal' cases are handled over to the Timbl classifier
   */
-  UnicodeString uword = fd.word;
-  UnicodeString pos_tag = fd.tag;
-  UnicodeString token_class = fd.token_class;
-  if (debug > 1 ){
-    DBG << "Classify " << uword << "(" << pos_tag << ") ["
-	<< token_class << "]" << endl;
-  }
+  uword = fd.word;
+  const UnicodeString& pos_tag = fd.tag;
+  const UnicodeString& token_class = fd.token_class;
   if ( filter ){
     uword = filter->filter( uword );
   }
   if ( token_class == "ABBREVIATION" ){
     // We dont handle ABBREVIATION's so just take the word as such
-#pragma omp critical (dataupdate)
-    {
-      fd.lemmas.push_back( uword );
-    }
-    return;
+    return true;
   }
-
   auto const& it1 = token_strip_map.find( pos_tag );
   if ( it1 != token_strip_map.end() ){
     // some tag/tokenizer_class combinations are special
@@ -436,46 +597,146 @@ void Mblem::Classify( frog_record& fd ){
     auto const& it2 = it1->second.find( token_class );
     if ( it2 != it1->second.end() ){
       UnicodeString uword2 = UnicodeString( uword, 0, uword.length() - it2->second );
-      if ( uword2.isEmpty() ){
-	uword2 = uword;
+      if ( !uword2.isEmpty() ){
+	uword = uword2;
       }
-#pragma omp critical (dataupdate)
-      {
-	fd.lemmas.push_back( uword2 );
-      }
-      return;
+      return true;
     }
   }
   if ( one_one_tags.find( pos_tag ) != one_one_tags.end() ){
     // some tags are just taken as such
-#pragma omp critical (dataupdate)
-    {
-      fd.lemmas.push_back( uword );
-    }
-    return;
+    return true;
   }
   if ( !keep_case ){
     uword.toLower();
   }
-  Classify( uword );
-  filterTag( pos_tag );
-  makeUnique();
-  if ( mblemResult.empty() ){
-    // just return the word as a lemma
+  return false;
+}
+
+void Mblem::Classify( frog_record& fd ){
+  /// add lemma information to the frog_data
+  /*!
+    \param fd The frog_data
+
+    The special cases are handled by fixed_lemma().
+    All 'normal' cases are handled over to the Timbl classifier.
+    When caching is enabled, the result only depends on the word, the tag and
+    the token class, so it is looked up first.
+  */
+  const UnicodeString& pos_tag = fd.tag;
+  if (debug > 1 ){
+    DBG << "Classify " << fd.word << "(" << pos_tag << ") ["
+	<< fd.token_class << "]" << endl;
+  }
+  vector<UnicodeString> lemmas;
+  UnicodeString key;
+  if ( _cache ){
+    key = cache_key( fd );
+    if ( _cache->lookup( key, lemmas ) ){
 #pragma omp critical (dataupdate)
-    {
-      fd.lemmas.push_back( uword );
+      {
+	fd.lemmas.insert( fd.lemmas.end(), lemmas.begin(), lemmas.end() );
+      }
+      return;
     }
   }
+  UnicodeString uword;
+  if ( fixed_lemma( fd, uword ) ){
+    lemmas.push_back( uword );
+  }
   else {
-#pragma omp critical (dataupdate)
-    {
+    Classify( uword );
+    filterTag( fd.cgn() );
+    makeUnique();
+    if ( mblemResult.empty() ){
+      // just return the word as a lemma
+      lemmas.push_back( uword );
+    }
+    else {
       for ( auto const& it : mblemResult ){
-	UnicodeString result = it.getLemma();
-	fd.lemmas.push_back( result );
+	lemmas.push_back( it.getLemma() );
       }
     }
   }
+  if ( _cache ){
+    _cache->store( key, lemmas );
+  }
+#pragma omp critical (dataupdate)
+  {
+    fd.lemmas.insert( fd.lemmas.end(), lemmas.begin(), lemmas.end() );
+  }
+}
+
+UnicodeString Mblem::cache_key( const frog_record& fd ) const {
+  /// create the key for the result cache
+  /*!
+    \param fd the frog_record of the word
+    \return a key holding everything the lemmas depend on
+  */
+  return fd.word + "\t" + fd.tag + "\t" + fd.token_class;
+}
+
+cache_stats Mblem::get_cache_stats() const {
+  /// return the counters of the result cache. All 0 when not caching
+  if ( _cache ){
+    return _cache->stats();
+  }
+  return cache_stats();
+}
+
+size_t Mblem::disk_cache_written() const {
+  /// return the number of records we appended to the cache file
+  if ( _disk_cache ){
+    return _disk_cache->written();
+  }
+  return 0;
+}
+
+void Mblem::Classify( const vector<frog_record*>& words ){
+  /// add lemma information to a list of words
+  /*!
+    \param words The frog_records to lemmatize, typically all words of one or
+    more sentences
+
+    When a Timbl server is used, the instances of all words are sent in one
+    request, instead of one round trip per word.
+  */
+  if ( !_host.empty() ){
+    vector<UnicodeString> insts;
+    for ( const auto *fd : words ){
+      if ( _cache && _cache->contains( cache_key( *fd ) ) ){
+	continue;
+      }
+      UnicodeString uword;
+      if ( !fixed_lemma( *fd, uword ) ){
+	UnicodeString u_class;
+	if ( known_class( uword, u_class ) ){
+	  continue;
+	}
+	UnicodeString inst = make_instance( uword );
+	if ( server_classes.find( inst ) == server_classes.end() ){
+	  server_classes[inst] = "";
+	  insts.push_back( inst );
+	}
+      }
+    }
+    if ( !insts.empty() ){
+      vector<UnicodeString> classes = call_server( insts );
+      for ( size_t i=0; i < insts.size(); ++i ){
+	server_classes[insts[i]] = classes[i];
+      }
+    }
+  }
+  try {
+    for ( auto *fd : words ){
+      Classify( *fd );
+    }
+  }
+  catch ( ... ){
+    server_classes.clear();
+    throw;
+  }
+  server_classes.clear();
 }
 
 UnicodeString Mblem::call_server( const UnicodeString& instance ){
@@ -484,87 +745,212 @@ UnicodeString Mblem::call_server( const UnicodeString& instance ){
     \param instance The instance to give to Timbl
     \return the lemma rule as returned by Timbl
   */
-  Sockets::ClientSocket client;
-  if ( !client.connect( _host, _port ) ){
-    LOG << "failed to open connection, " << _host
-	<< ":" << _port << endl
-	<< "Reason: " << client.getMessage() << endl;
-    exit( EXIT_FAILURE );
-  }
   if ( debug > 1 ){
     DBG << "calling MBLEM-server" << endl;
   }
-  string in_line;
-  client.read( in_line );
-  json response;
-  try {
-    response = json::parse( in_line );
-  }
-  catch ( const exception& e ){
-    LOG << "json parsing failed on '" << in_line << "':"
-	<< e.what() << endl;
-    abort();
-  }
-  //  LOG << "received json data:" << response.dump(2) << endl;
-  if ( !_base.empty() ){
-    json out_json;
-    out_json["command"] = "base";
-    out_json["param"] = _base;
-    string out_line = out_json.dump() + "\n";
-    //    LOG << "sending BASE json data:" << out_line << endl;
-    client.write( out_line );
-    client.read( in_line );
-    try {
-      response = json::parse( in_line );
-    }
-    catch ( const exception& e ){
-      LOG << "json parsing failed on '" << in_line << "':"
-	  << e.what() << endl;
-      abort();
-    }
-    //    LOG << "received json data:" << response.dump(2) << endl;
-  }
   // create json query struct
   json query;
   query["command"] = "classify";
   query["param"] = TiCC::UnicodeToUTF8(instance);
   //  LOG << "send json" << query.dump(2) << endl;
-  // send it to the server
-  string out_line = query.dump() + "\n";
-  client.write( out_line );
-  // receive json
-  client.read( in_line );
-  //  LOG << "received line:" << in_line << "" << endl;
-  try {
-    response = json::parse( in_line );
-  }
-  catch ( const exception& e ){
-    LOG << "json parsing failed on '" << in_line << "':"
-	<< e.what() << endl;
-    abort();
-  }
+  json response = ServerPool::instance().query( _host, _port, _base,
+						query, dbgLog );
   //  LOG << "received json data:" << response.dump(2) << endl;
   string result = response["category"];
   //  LOG << "extracted result " << result << endl;
   return TiCC::UnicodeFromUTF8(result);
 }
 
-void Mblem::Classify( const UnicodeString& uWord ){
-  /// give the lemma for 1 word
+vector<UnicodeString> Mblem::call_server( const vector<UnicodeString>& insts ){
+  /// use a Timbl server to classify a list of instances in one request
   /*!
-    \param word a Unicode string with the word
-    the internal mblemResult struct will be filled with 1 or more (alternative)
-    solutions of a lemma + a POS-tag
+    \param insts The instances to give to Timbl
+    \return the lemma rules as returned by Timbl, one for every instance
+  */
+  if ( debug > 1 ){
+    DBG << "calling MBLEM-server for " << insts.size() << " instances" << endl;
+  }
+  json query;
+  query["command"] = "classify";
+  json arr = json::array();
+  for ( const auto& i : insts ){
+    arr.push_back( TiCC::UnicodeToUTF8(i) );
+  }
+  query["params"] = arr;
+  json response = ServerPool::instance().query( _host, _port, _base,
+						query, dbgLog );
+  vector<UnicodeString> result;
+  if ( !response.is_array() ){
+    result.push_back( TiCC::UnicodeFromUTF8(response["category"]) );
+  }
+  else {
+    for ( const auto& it : response.items() ){
+      result.push_back( TiCC::UnicodeFromUTF8(it.value()["category"]) );
+    }
+  }
+  if ( result.size() != insts.size() ){
+    throw runtime_error( "MBLEM-server returned " + to_string(result.size())
+			 + " results for " + to_string(insts.size())
+			 + " instances" );
+  }
+  return result;
+}
+
+UnicodeString Mblem::get_class( const UnicodeString& uWord ){
+  /// get the Timbl class for 1 word
+  /*!
+    \param uWord the word
+    \return the class, from the suffix table when present, otherwise from
+    Timbl or the Timbl server.
   */
-  mblemResult.clear();
-  UnicodeString inst = make_instance(uWord);
   UnicodeString u_class;
+  if ( known_class( uWord, u_class ) ){
+    return u_class;
+  }
+  UnicodeString inst = make_instance(uWord);
   if ( !_host.empty() ){
-    u_class = call_server( inst );
+    auto const& it = server_classes.find( inst );
+    if ( it != server_classes.end() ){
+      u_class = it->second;
+    }
+    else {
+      u_class = call_server( inst );
+    }
   }
   else {
     myLex->Classify( inst, u_class );
   }
+  if ( _disk_cache ){
+    _disk_cache->store( TiCC::UnicodeToUTF8( SuffixTable::make_key( uWord, history ) ),
+			TiCC::UnicodeToUTF8( u_class ) );
+  }
+  return u_class;
+}
+
+bool Mblem::known_class( const UnicodeString& uWord,
+			 UnicodeString& u_class ) const {
+  /// look up the Timbl class of a word in the suffix table and the cache file
+  /*!
+    \param uWord the word
+    \param u_class the class found
+    \return true when found
+  */
+  if ( !_table && !_disk_cache ){
+    return false;
+  }
+  UnicodeString key = SuffixTable::make_key( uWord, history );
+  if ( _table && _table->lookup( key, u_class ) ){
+    return true;
+  }
+  string value;
+  if ( _disk_cache
+       && _disk_cache->lookup( TiCC::UnicodeToUTF8( key ), value ) ){
+    u_class = TiCC::UnicodeFromUTF8( value );
+    return true;
+  }
+  return false;
+}
+
+void Mblem::prewarm( const UnicodeString& word ){
+  /// make sure the Timbl class of a word is in the cache file
+  /*!
+    \param word the word. It is normalized as Classify() does
+  */
+  UnicodeString uword = word;
+  if ( filter ){
+    uword = filter->filter( uword );
+  }
+  if ( !keep_case ){
+    uword.toLower();
+  }
+  if ( !uword.isEmpty() ){
+    get_class( uword );
+  }
+}
+
+uint64_t Mblem::table_stamp() const {
+  /// the stamp of the suffix tables made with our classifier
+  /*!
+    The size and modification time of a local instancebase are part of it.
+    For a server, its address and base are.
+  */
+  string what = "mblem suffix table history=" + to_string( history ) + " ";
+  if ( _host.empty() ){
+    return make_stamp( what + tree_name, tree_name );
+  }
+  return make_stamp( what + _host + ":" + _port + "/" + _base );
+}
+
+bool Mblem::compile_suffix_table( const set<UnicodeString>& words,
+				  const string& file_name ){
+  /// classify the suffixes of all words and store them in a suffix table
+  /*!
+    \param words the words to use. They are normalized the same way as
+    Classify() does
+    \param file_name the file to create
+    \return true on succes
+
+    The classes always come from Timbl, an already loaded suffix table is not
+    used.
+  */
+  map<UnicodeString,UnicodeString> table;
+  vector<UnicodeString> keys;
+  for ( auto uword : words ){
+    if ( filter ){
+      uword = filter->filter( uword );
+    }
+    if ( !keep_case ){
+      uword.toLower();
+    }
+    if ( uword.isEmpty() ){
+      continue;
+    }
+    UnicodeString key = SuffixTable::make_key( uword, history );
+    if ( table.find( key ) == table.end() ){
+      table[key] = "";
+      keys.push_back( key );
+    }
+  }
+  LOG << "compiling " << keys.size() << " suffixes from "
+      << words.size() << " words" << endl;
+  const size_t chunk = 1000;
+  for ( size_t start=0; start < keys.size(); start += chunk ){
+    size_t end = min( start + chunk, keys.size() );
+    if ( !_host.empty() ){
+      vector<UnicodeString> insts;
+      for ( size_t i=start; i < end; ++i ){
+	insts.push_back( make_instance( keys[i] ) );
+      }
+      vector<UnicodeString> classes = call_server( insts );
+      for ( size_t i=start; i < end; ++i ){
+	table[keys[i]] = classes[i-start];
+      }
+    }
+    else {
+      for ( size_t i=start; i < end; ++i ){
+	UnicodeString u_class;
+	myLex->Classify( make_instance( keys[i] ), u_class );
+	table[keys[i]] = u_class;
+      }
+    }
+  }
+  if ( !SuffixTable::write( file_name, history, table, table_stamp() ) ){
+    LOG << "unable to write suffix table: " << file_name << endl;
+    return false;
+  }
+  LOG << "wrote " << table.size() << " entries to: " << file_name << endl;
+  return true;
+}
+
+void Mblem::Classify( const UnicodeString& uWord ){
+  /// give the lemma for 1 word
+  /*!
+    \param word a Unicode string with the word
+    the internal mblemResult struct will be filled with 1 or more (alternative)
+    solutions of a lemma + a POS-tag
+  */
+  mblemResult.clear();
+  UnicodeString u_class = get_class( uWord );
   if ( debug > 1){
     DBG << "class: " << u_class  << endl;
   }
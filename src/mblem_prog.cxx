@@ -44,6 +44,7 @@
 #include "libfolia/folia.h"
 #include "frog/ucto_tokenizer_mod.h"
 #include "frog/cgn_tagger_mod.h"
+#include "frog/cgn_tag.h"
 
 using namespace std;
 using namespace icu;
@@ -59,6 +60,7 @@ bool usewordlist = false;
 bool useTagger = true;
 bool useTokenizer = true;
 string output_name;
+string table_name;
 
 TiCC::Configuration configuration;
 static string configDir = string(SYSCONF_PATH) + "/" + PACKAGE + "/nld/";
@@ -74,6 +76,9 @@ void usage( ) {
        << "\t -t <testfile>    Run mblem on this file\n"
        << "\t --wordlist <wordfile>    Run on a wordlist. Produces a lemma list\n"
        << "\t -o <outputfile>    write results in 'outputfile'\n"
+       << "\t --compile-table <tablefile> Don't lemmatize, but create a suffix table\n"
+       << "\t\t for all words in the input files. (use 'suffix_table' in the\n"
+       << "\t\t [[mblem]] section of the configuration to use it)\n"
 
        << "\t --notokenizer    Don't use a tokenizer, so assume all text is tokenized already.\n"
        << "\t --notagger       Don't use a tagger to disambiguate, so give ALL variants.\n"
@@ -134,6 +139,10 @@ bool parse_args( TiCC::CL_Options& Opts ) {
     useTagger = false;
     useTokenizer = false;
   }
+  if ( Opts.extract( "compile-table", table_name ) ){
+    useTagger = false;
+    useTokenizer = false;
+  }
   if ( Opts.extract( 't', value ) ){
     ifstream is( value );
     if ( !is ){
@@ -172,6 +181,23 @@ bool init(){
   return true;
 }
 
+bool Compile( const vector<string>& names, const string& table_file ){
+  set<UnicodeString> words;
+  for ( const auto& name : names ){
+    ifstream in( name );
+    if ( !in ){
+      cerr << "unable to open: " << name << endl;
+      return false;
+    }
+    UnicodeString line;
+    while ( TiCC::getline( in, line ) ){
+      vector<UnicodeString> parts = TiCC::split( line );
+      words.insert( parts.begin(), parts.end() );
+    }
+  }
+  return myMblem.compile_suffix_table( words, table_file );
+}
+
 void Test( istream& in, ostream& os ){
   UnicodeString line;
   while ( TiCC::getline( in, line ) ){
@@ -191,7 +217,7 @@ void Test( istream& in, ostream& os ){
 	vector<TagResult> tagrv = tagger.tagLine( us );
 	for ( const auto& tr : tagrv ){
 	  myMblem.Classify( tr.word() );
-	  myMblem.filterTag( tr.assigned_tag() );
+	  myMblem.filterTag( cgn_tag::get( symbol( tr.assigned_tag() ) ) );
 	  vector<pair<UnicodeString,UnicodeString> > res = myMblem.getResult();
 	  UnicodeString out_line = tr.word() + " {" + tr.assigned_tag() + "}\t";
 	  for ( const auto& [lemma,tag] : res ){
@@ -263,7 +289,7 @@ int main(int argc, char *argv[]) {
        << "Radboud University" << endl
        << "ILK   - Induction of Linguistic Knowledge Research Group,"
        << "Tilburg University" << endl;
-  TiCC::CL_Options Opts("c:t:hVd:o:", "version,notagger,notokenizer,wordlist");
+  TiCC::CL_Options Opts("c:t:hVd:o:", "version,notagger,notokenizer,wordlist,compile-table:");
   try {
     Opts.init(argc, argv);
   }
@@ -279,6 +305,9 @@ int main(int argc, char *argv[]) {
       cerr << "terminated." << endl;
       return EXIT_FAILURE;
     }
+    if ( !table_name.empty() ){
+      return Compile( fileNames, table_name ) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
     ostream *os;
     if ( !output_name.empty() ){
       os = new ofstream( output_name );
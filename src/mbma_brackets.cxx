@@ -340,6 +340,37 @@ BaseBracket *BracketNest::append( BaseBracket *t ){
   return this;
 }
 
+BracketLeaf::BracketLeaf( const BracketLeaf& other,
+			  TiCC::LogStream& l ):
+  BaseBracket( other, l ),
+  _ifpos( other._ifpos ),
+  _glue( other._glue ),
+  _orig( other._orig ),
+  _morph( other._morph ),
+  _inflect( other._inflect )
+{
+  /// create a copy of a BracketLeaf, using another LogStream
+  /*!
+    \param other the BracketLeaf to copy
+    \param l a LogStream for messages
+  */
+}
+
+BracketNest::BracketNest( const BracketNest& other,
+			  TiCC::LogStream& l ):
+  BaseBracket( other, l ),
+  _compound( other._compound )
+{
+  /// create a deep copy of a BracketNest, using another LogStream
+  /*!
+    \param other the BracketNest to copy
+    \param l a LogStream for messages
+  */
+  for ( const auto *part : other._parts ){
+    _parts.push_back( part->clone( l ) );
+  }
+}
+
 BracketLeaf::~BracketLeaf(){
   //  LOG << "DELETED LEAF: " << (void *)this << endl;
 }
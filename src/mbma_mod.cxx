@@ -47,7 +47,9 @@
 #include "ticcutils/SocketBasics.h"
 #include "ticcutils/json.hpp"
 #include "frog/Frog-util.h"
+#include "frog/server_pool.h"
 #include "frog/FrogData.h"
+#include "frog/cgn_tag.h"
 
 using namespace std;
 using namespace icu;
@@ -60,12 +62,42 @@ const long int RIGHT = 6; // right context
 #define LOG *TiCC::Log(errLog)
 #define DBG *TiCC::Log(dbgLog)
 
+namespace {
+  void cgn_clex_files( const TiCC::Configuration& config,
+		       string& main,
+		       string& sub ){
+    /// find the names of the CGN-CLEX translation files
+    /*!
+      \param config the Configuration to use
+      \param main set to the name of the main-rules file
+      \param sub set to the name of the sub-rules file
+    */
+    main = config.lookUp( "cgn_clex_main", "mbma" );
+    if ( main.empty() ){
+      main = "cgntags.main";
+    }
+    main = prefix( config.configDir(), main );
+    sub = config.lookUp( "cgn_clex_sub", "mbma" );
+    if ( sub.empty() ){
+      sub = "cgntags.sub";
+    }
+    sub = prefix( config.configDir(), sub );
+  }
+}
+
 Mbma::Mbma( TiCC::LogStream *errlog, TiCC::LogStream *dbglog ):
   MTree(0),
   filter(0),
   debugFlag(0),
   filter_diac(false),
-  doDeepMorph(false)
+  doDeepMorph(false),
+  _cache(0),
+  _owns_cache(false),
+  _window_cache(0),
+  _owns_window_cache(false),
+  _disk_cache(0),
+  _owns_disk_cache(false),
+  _bundle(0)
 {
   /// create an Mbma classifier object
   /*!
@@ -94,6 +126,15 @@ Mbma::~Mbma() {
   delete MTree;
   clearAnalysis();
   delete filter;
+  if ( _owns_cache ){
+    delete _cache;
+  }
+  if ( _owns_window_cache ){
+    delete _window_cache;
+  }
+  if ( _owns_disk_cache ){
+    delete _disk_cache;
+  }
   if ( errLog != dbgLog ){
     delete dbgLog;
   }
@@ -158,10 +199,42 @@ void Mbma::init_cgn( const string& main, const string& sub ) {
   }
 }
 
-bool Mbma::init( const TiCC::Configuration& config ) {
+bool Mbma::load_cgn( const string& main, const string& sub ) {
+  /// use the CGN-CLEX translation tables from the resource bundle
+  /*!
+    \param main the name of the main-rules file
+    \param sub the name of the sub-rules file
+    \return false when the bundle has no up to date tables. The caller
+    should use init_cgn() then.
+  */
+  const char *data = 0;
+  size_t size = 0;
+  if ( !_bundle
+       || !_bundle->find( "mbma:cgn_clex",
+			  make_stamp( "mbma:cgn_clex", { main, sub } ),
+			  data, size ) ){
+    return false;
+  }
+  vector<UnicodeString> fields;
+  if ( !ResourceBundle::decode_lines( data, size, fields )
+       || fields.size() % 2 != 0 ){
+    LOG << "corrupt section mbma:cgn_clex in resource bundle" << endl;
+    return false;
+  }
+  for ( size_t i=0; i < fields.size(); i += 2 ){
+    TAGconv.insert( make_pair( fields[i], fields[i+1] ) );
+  }
+  LOG << "using precompiled mbma:cgn_clex" << endl;
+  return true;
+}
+
+bool Mbma::init( const TiCC::Configuration& config,
+		 const Mbma *model ) {
   /// initialize the Mbma analyzer using the config
   /*!
     \param config the Configuration to use
+    \param model an already initialized Mbma. When given, we don't load
+    the instance base again, but create a Timbl clone which shares it.
     \return true when no problems are detected
   */
   LOG << "Initiating morphological analyzer..." << endl;
@@ -223,25 +296,12 @@ bool Mbma::init( const TiCC::Configuration& config ) {
     clex_tagset = val;
   }
   string cgn_clex_main;
-  val = config.lookUp( "cgn_clex_main", "mbma" );
-  if ( val.empty() ){
-    cgn_clex_main = "cgntags.main";
-  }
-  else {
-    cgn_clex_main = val;
-  }
-  cgn_clex_main = prefix( config.configDir(), cgn_clex_main );
-
   string cgn_clex_sub;
-  val = config.lookUp( "cgn_clex_sub", "mbma" );
-  if ( val.empty() ){
-    cgn_clex_sub = "cgntags.sub";
-  }
-  else {
-    cgn_clex_sub = val;
+  cgn_clex_files( config, cgn_clex_main, cgn_clex_sub );
+  if ( !model && !load_cgn( cgn_clex_main, cgn_clex_sub ) ){
+    // the translation tables are static, so already filled by the model
+    init_cgn( cgn_clex_main, cgn_clex_sub );
   }
-  cgn_clex_sub = prefix( config.configDir(), cgn_clex_sub );
-  init_cgn( cgn_clex_main, cgn_clex_sub );
 
   string charFile = config.lookUp( "char_filter_file", "mbma" );
   if ( charFile.empty() ){
@@ -265,6 +325,71 @@ bool Mbma::init( const TiCC::Configuration& config ) {
     textclass = "current";
   }
 
+  if ( model ){
+    // share the caches of the model
+    _cache = model->_cache;
+    _window_cache = model->_window_cache;
+    _disk_cache = model->_disk_cache;
+  }
+  else {
+    size_t cache_size = 100000;
+    val = config.lookUp( "cache_size", "mbma" );
+    if ( !val.empty() && !TiCC::stringTo<size_t>( val, cache_size ) ){
+      LOG << "invalid 'cache_size' value in configuration: " << val << endl;
+      return false;
+    }
+    if ( cache_size > 0 ){
+      _cache = new ResultCache<UnicodeString,
+			       mbma_result,
+			       unicode_hash>( cache_size );
+      _owns_cache = true;
+    }
+    // the character windows are shared by many different words, so this
+    // also helps for words that are never seen twice
+    size_t window_cache_size = 200000;
+    val = config.lookUp( "window_cache_size", "mbma" );
+    if ( !val.empty() && !TiCC::stringTo<size_t>( val, window_cache_size ) ){
+      LOG << "invalid 'window_cache_size' value in configuration: " << val << endl;
+      return false;
+    }
+    if ( window_cache_size > 0 && _host.empty() ){
+      _window_cache = new ResultCache<UnicodeString,
+				      UnicodeString,
+				      unicode_hash>( window_cache_size );
+      _owns_window_cache = true;
+    }
+    // a cache file is written to, so it is NOT searched in the config dir
+    string cacheName = config.lookUp( "persistent_cache", "mbma" );
+    if ( !cacheName.empty() ){
+      string model_id = "mbma " + _version + " window="
+	+ to_string( LEFT ) + "/" + to_string( RIGHT ) + " ";
+      string model_file;
+      if ( _host.empty() ){
+	string tfName = config.lookUp( "treeFile", "mbma" );
+	if ( tfName.empty() ){
+	  tfName = "mbma.igtree";
+	}
+	model_file = prefix( config.configDir(), tfName );
+	model_id += model_file;
+      }
+      else {
+	model_id += _host + ":" + _port + "/" + _base;
+      }
+      _disk_cache = new PersistentCache( errLog );
+      if ( _disk_cache->open( cacheName,
+			      make_stamp( model_id, model_file ) ) ){
+	LOG << "using cache file " << cacheName << " with "
+	    << _disk_cache->size() << " entries" << endl;
+	_owns_disk_cache = true;
+      }
+      else {
+	LOG << "not using cache file: " << cacheName << endl;
+	delete _disk_cache;
+	_disk_cache = 0;
+      }
+    }
+  }
+
   if ( _host.empty() ){
     // so classic monolytic run
     string tfName = config.lookUp( "treeFile", "mbma" );
@@ -278,6 +403,14 @@ bool Mbma::init( const TiCC::Configuration& config ) {
       opts = "-a1";
     }
     opts += " +vs -vf"; // make Timbl run quietly
+    if ( model ){
+      if ( !model->MTree ){
+	LOG << "unable to share the MBMA model: it isn't loaded" << endl;
+	return false;
+      }
+      MTree = new Timbl::TimblAPI( *model->MTree );
+      return MTree->Valid();
+    }
     MTree = new Timbl::TimblAPI(opts);
     return MTree->GetInstanceBase(MTreeFilename);
   }
@@ -296,6 +429,37 @@ bool Mbma::init( const TiCC::Configuration& config ) {
   }
 }
 
+bool Mbma::compile_resources( const TiCC::Configuration& config,
+			      vector<ResourceBundle::section>& sections ){
+  /// read the CGN-CLEX translation tables and add them to a resource bundle
+  /*!
+    \param config the Configuration to use
+    \param sections the list of sections to add the tables to
+    \return false when reading the tables failed
+  */
+  string cgn_clex_main;
+  string cgn_clex_sub;
+  cgn_clex_files( config, cgn_clex_main, cgn_clex_sub );
+  try {
+    init_cgn( cgn_clex_main, cgn_clex_sub );
+  }
+  catch ( const exception& e ){
+    LOG << e.what() << endl;
+    return false;
+  }
+  vector<UnicodeString> fields;
+  for ( const auto& [cgn,clex] : TAGconv ){
+    fields.push_back( cgn );
+    fields.push_back( clex );
+  }
+  ResourceBundle::section sec;
+  sec.name = "mbma:cgn_clex";
+  sec.stamp = make_stamp( "mbma:cgn_clex", { cgn_clex_main, cgn_clex_sub } );
+  sec.data = ResourceBundle::encode_lines( fields );
+  sections.push_back( sec );
+  return true;
+}
+
 vector<UnicodeString> Mbma::make_instances( const UnicodeString& word ){
   /// convert a Unicode string into a range of UTF8 instances for Timbl
   /*!
@@ -335,6 +499,102 @@ vector<UnicodeString> Mbma::make_instances( const UnicodeString& word ){
   return insts;
 }
 
+UnicodeString Mbma::classify_window( const UnicodeString& inst ){
+  /// classify 1 character window with the Timbl tree
+  /*!
+    \param inst the instance, as created by make_instances()
+    \return the class. Taken from the window cache when possible
+  */
+  UnicodeString ans;
+  if ( _window_cache && _window_cache->lookup( inst, ans ) ){
+    if ( debugFlag > 1){
+      DBG << inst << " ==> " << ans << " (cached)" << endl;
+    }
+    return ans;
+  }
+  MTree->Classify( inst, ans );
+  if ( debugFlag > 1){
+    DBG << inst << " ==> " << ans
+	<< ", depth=" << MTree->matchDepth() << endl;
+  }
+  if ( _window_cache ){
+    _window_cache->store( inst, ans );
+  }
+  return ans;
+}
+
+vector<UnicodeString> Mbma::get_classes( const UnicodeString& uWord ){
+  /// get the Timbl classes for all character windows of a word
+  /*!
+    \param uWord the (cleaned) word
+    \return one class for every character
+  */
+  vector<UnicodeString> classes;
+  if ( known_classes( uWord, classes ) ){
+    return classes;
+  }
+  if ( !_host.empty() ){
+    auto const& it = server_classes.find( uWord );
+    if ( it != server_classes.end() ){
+      classes = it->second;
+    }
+    else {
+      call_server( make_instances( uWord ), classes );
+    }
+  }
+  else {
+    vector<UnicodeString> insts = make_instances( uWord );
+    classes.reserve( insts.size() );
+    for ( auto const& inst : insts ) {
+      classes.push_back( classify_window( inst ) );
+    }
+  }
+  if ( _disk_cache ){
+    _disk_cache->store( TiCC::UnicodeToUTF8( uWord ),
+			TiCC::UnicodeToUTF8( TiCC::join( classes, "\t" ) ) );
+  }
+  return classes;
+}
+
+bool Mbma::known_classes( const UnicodeString& uWord,
+			  vector<UnicodeString>& classes ) const {
+  /// look up the Timbl classes of a word in the cache file
+  /*!
+    \param uWord the (cleaned) word
+    \param classes the classes found
+    \return true when found
+  */
+  string value;
+  if ( _disk_cache
+       && _disk_cache->lookup( TiCC::UnicodeToUTF8( uWord ), value ) ){
+    classes = TiCC::split_at( TiCC::UnicodeFromUTF8( value ), "\t" );
+    if ( classes.size() == (size_t)uWord.length() ){
+      return true;
+    }
+    classes.clear();
+  }
+  return false;
+}
+
+void Mbma::prewarm( const UnicodeString& word ){
+  /// make sure the Timbl classes of a word are in the cache file
+  /*!
+    \param word the word. It is cleaned up as Classify() does
+  */
+  vector<UnicodeString> parts = TiCC::split( word );
+  UnicodeString uWord = TiCC::join( parts, "" );
+  if ( filter ){
+    uWord = filter->filter( uWord );
+  }
+  uWord.toLower();
+  if ( filter_diac ){
+    uWord = TiCC::filter_diacritics( uWord );
+  }
+  if ( !uWord.isEmpty() ){
+    get_classes( uWord );
+  }
+}
+
 UnicodeString find_class( unsigned int step,
 			  const vector<UnicodeString>& classes,
 			  unsigned int nranal ){
@@ -450,15 +710,23 @@ Rule* Mbma::matchRule( const std::vector<icu::UnicodeString>& ana,
 }
 
 bool check_next( const UnicodeString& tag ){
-  vector<UnicodeString> v = TiCC::split_at_first_of( tag, "()" );
-  if ( v.size() != 2
-       || v[0] != "VNW" ){
+  /// check if the next tag allows to keep the V2I inflection
+  /*!
+    \param tag the POS tag of the next word
+    \return true for a VNW, unless it has '2' as an inner feature
+  */
+  static const symbol second( "2" );
+  const cgn_tag& parsed = cgn_tag::get( symbol( tag ) );
+  if ( parsed.head != "VNW"
+       || parsed.features.empty() ){
     return false;
   }
-  else {
-    bool result = v[1].indexOf( ",2," ) == -1;
-    return result;
+  for ( size_t i=1; i+1 < parsed.features.size(); ++i ){
+    if ( parsed.features[i] == second ){
+      return false;
+    }
   }
+  return true;
 }
 
 vector<Rule*> Mbma::execute( const icu::UnicodeString& word,
@@ -647,7 +915,7 @@ void Mbma::filterHeadTag( const icu::UnicodeString& head ){
   }
 }
 
-void Mbma::filterSubTags( const vector<icu::UnicodeString>& feats ){
+void Mbma::filterSubTags( const vector<symbol>& feats ){
   /// reduce the analyses set based on sub-features
   /*!
     \param feats a list of subfeatures
@@ -1006,27 +1274,134 @@ void Mbma::storeResult( frog_record& fd,
   }
 }
 
-void Mbma::Classify( frog_record& fd ){
-  UnicodeString word = fd.word;
-  UnicodeString tag = fd.tag;
-  UnicodeString token_class = fd.token_class;
-  vector<UnicodeString> v = TiCC::split_at_first_of( tag, "()" );
-  UnicodeString head = v[0];
-  if (debugFlag >1 ){
-    DBG << "Classify " << word << "(" << head << ") ["
-	<< token_class << "]" << endl;
-  }
+bool Mbma::as_is( const frog_record& fd, UnicodeString& word ) const {
+  /// clean up a word and check if it must be taken over 'as-is'
+  /*!
+    \param fd the frog_record of the word
+    \param word the cleaned up word. When the word isn't taken 'as-is' this
+    is lowercased, ready to analyze
+    \return true when the word should not be analyzed
+  */
+  const UnicodeString& head = fd.cgn().head;
   // HACK! for now remove any whitespace!
-  vector<UnicodeString> parts = TiCC::split( word );
+  vector<UnicodeString> parts = TiCC::split( fd.word );
   word = TiCC::join( parts, "" );
   if ( filter ){
     word = filter->filter( word );
   }
   if ( head == "LET"
        || head == "SPEC"
-       || token_class == "ABBREVIATION" ){
+       || fd.token_class == "ABBREVIATION" ){
     // take over the letter/word 'as-is'.
     //  also ABBREVIATION's aren't handled bij mbma-rules
+    return true;
+  }
+  word.toLower();
+  return false;
+}
+
+UnicodeString Mbma::cache_key( const frog_record& fd ) const {
+  /// create the key for the result cache
+  /*!
+    \param fd the frog_record of the word
+    \return a key holding everything the analysis depends on
+  */
+  UnicodeString result = doDeepMorph ? "1" : "0";
+  result += "\t" + fd.word + "\t" + fd.tag + "\t" + fd.next_tag
+    + "\t" + fd.token_class;
+  return result;
+}
+
+cache_stats Mbma::get_cache_stats() const {
+  /// return the counters of the result cache. All 0 when not caching
+  if ( _cache ){
+    return _cache->stats();
+  }
+  return cache_stats();
+}
+
+size_t Mbma::disk_cache_written() const {
+  /// return the number of records we appended to the cache file
+  if ( _disk_cache ){
+    return _disk_cache->written();
+  }
+  return 0;
+}
+
+cache_stats Mbma::get_window_cache_stats() const {
+  /// return the counters of the window cache. All 0 when not caching
+  if ( _window_cache ){
+    return _window_cache->stats();
+  }
+  return cache_stats();
+}
+
+static TiCC::LogStream& cache_log(){
+  /// the LogStream of the brackets kept in the result cache
+  /*!
+    The cache is shared, and outlives the sessions that fill it, so the
+    cached brackets may not refer to the LogStream of a session. They never
+    log anyway: a hit is cloned again with the LogStream of its user.
+  */
+  static ostream null_stream( nullptr );
+  static TiCC::LogStream the_log( null_stream );
+  return the_log;
+}
+
+void Mbma::Classify( frog_record& fd ){
+  /// run a morphological analysis on 1 word
+  /*!
+    \param fd the frog_record of the word. It is extended with the results
+
+    When caching is enabled, the finished results of an earlier analysis
+    with the same inputs are copied instead.
+  */
+  UnicodeString key;
+  if ( _cache ){
+    key = cache_key( fd );
+    mbma_result cached;
+    if ( _cache->lookup( key, cached ) ){
+#pragma omp critical (dataupdate)
+      {
+	fd.clean_word = cached.clean_word;
+	fd.morph_string = cached.morph_string;
+	fd.compound_string = cached.compound_string;
+	for ( const auto& br : cached.morph_structure ){
+	  fd.morph_structure.push_back( br->clone( *dbgLog ) );
+	}
+      }
+      return;
+    }
+  }
+  analyze( fd );
+  if ( _cache ){
+    mbma_result result;
+#pragma omp critical (dataupdate)
+    {
+      result.clean_word = fd.clean_word;
+      result.morph_string = fd.morph_string;
+      result.compound_string = fd.compound_string;
+      for ( const auto& br : fd.morph_structure ){
+	result.morph_structure.emplace_back( br->clone( cache_log() ) );
+      }
+    }
+    _cache->store( key, result );
+  }
+}
+
+void Mbma::analyze( frog_record& fd ){
+  /// do the real morphological analysis of 1 word
+  /*!
+    \param fd the frog_record of the word. It is extended with the results
+  */
+  const cgn_tag& parsed = fd.cgn();
+  const UnicodeString& head = parsed.head;
+  if (debugFlag >1 ){
+    DBG << "Classify " << fd.word << "(" << head << ") ["
+	<< fd.token_class << "]" << endl;
+  }
+  UnicodeString word;
+  if ( as_is( fd, word ) ){
     fd.clean_word = word;
     store_brackets( fd, word, head );
     vector<UnicodeString> tmp;
@@ -1035,61 +1410,87 @@ void Mbma::Classify( frog_record& fd ){
   }
   else {
     UnicodeString lWord = word;
-    lWord.toLower();
     fd.clean_word = lWord;
     Classify( lWord, fd.next_tag );
-    vector<UnicodeString> featVals;
-    if ( v.size() > 1 ){
-      featVals = TiCC::split_at( v[1], "," );
-    }
     filterHeadTag( head );
-    filterSubTags( featVals );
+    filterSubTags( parsed.features );
     assign_compounds();
     storeResult( fd, lWord, head );
   }
 }
 
-void Mbma::call_server( const vector<UnicodeString>& insts,
-			vector<UnicodeString>& classes ){
-  Sockets::ClientSocket client;
-  if ( !client.connect( _host, _port ) ){
-    LOG << "failed to open connection, " << _host
-	<< ":" << _port << endl
-	<< "Reason: " << client.getMessage() << endl;
-    exit( EXIT_FAILURE );
-  }
-  if ( debugFlag > 1 ){
-    DBG << "calling MBMA-server" << endl;
+void Mbma::Classify( const vector<frog_record*>& words ){
+  /// run a morphological analysis on a list of words
+  /*!
+    \param words The frog_records to analyze, typically all words of one or
+    more sentences
+
+    When a Timbl server is used, the instances of all words are sent in one
+    request, instead of one round trip per word.
+  */
+  if ( !_host.empty() ){
+    vector<UnicodeString> keys;
+    vector<UnicodeString> insts;
+    vector<size_t> counts;
+    for ( const auto *fd : words ){
+      if ( _cache && _cache->contains( cache_key( *fd ) ) ){
+	continue;
+      }
+      UnicodeString word;
+      if ( !as_is( *fd, word ) ){
+	if ( filter_diac ){
+	  word = TiCC::filter_diacritics( word );
+	}
+	vector<UnicodeString> known;
+	if ( server_classes.find( word ) == server_classes.end()
+	     && !known_classes( word, known ) ){
+	  server_classes[word].clear();
+	  vector<UnicodeString> w_insts = make_instances( word );
+	  keys.push_back( word );
+	  counts.push_back( w_insts.size() );
+	  insts.insert( insts.end(), w_insts.begin(), w_insts.end() );
+	}
+      }
+    }
+    if ( !insts.empty() ){
+      vector<UnicodeString> classes;
+      classes.reserve( insts.size() );
+      call_server( insts, classes );
+      if ( classes.size() != insts.size() ){
+	server_classes.clear();
+	throw runtime_error( "MBMA-server returned "
+			     + to_string(classes.size())
+			     + " results for " + to_string(insts.size())
+			     + " instances" );
+      }
+      auto cit = classes.begin();
+      for ( size_t i=0; i < keys.size(); ++i ){
+	server_classes[keys[i]].assign( cit, cit + counts[i] );
+	cit += counts[i];
+      }
+    }
   }
-  string in_line;
-  client.read( in_line );
-  json response;
   try {
-    response = json::parse( in_line );
+    for ( auto *fd : words ){
+      Classify( *fd );
+    }
   }
-  catch ( const exception& e ){
-    string err_msg = "json parsing failed on '" + in_line + "':" + e.what();
-    LOG << err_msg << endl;
-    throw( runtime_error( err_msg ) );
+  catch ( ... ){
+    server_classes.clear();
+    throw;
   }
-  //  LOG << "received json data:" << response.dump(2) << endl;
-  if ( !_base.empty() ){
-    json out_json;
-    out_json["command"] = "base";
-    out_json["param"] = _base;
-    string out_line = out_json.dump() + "\n";
-    //    LOG << "sending BASE json data:" << out_line << endl;
-    client.write( out_line );
-    client.read( in_line );
-    try {
-      response = json::parse( in_line );
-    }
-    catch ( const exception& e ){
-      string err_msg = "json parsing failed on '" + in_line + "':" + e.what();
-      LOG << err_msg << endl;
-      throw( runtime_error( err_msg ) );
-    }
-    //    LOG << "received json data:" << response.dump(2) << endl;
+  server_classes.clear();
+}
+
+void Mbma::call_server( const vector<UnicodeString>& insts,
+			vector<UnicodeString>& classes ){
+  /// use a Timbl server to classify a list of instances
+  /*!
+    \param insts the instances to classify
+    \param classes the classes found, one for every instance
+  */
+  if ( debugFlag > 1 ){
+    DBG << "calling MBMA-server" << endl;
   }
   // create json struct
   json query;
@@ -1100,23 +1501,10 @@ void Mbma::call_server( const vector<UnicodeString>& insts,
   }
   query["params"] = arr;
   //  LOG << "send json" << query.dump(2) << endl;
-  // send it to the server
-  string out_line = query.dump() + "\n";
-  client.write( out_line );
-  // receive json
-  client.read( in_line );
-  //  LOG << "received line:" << in_line << "" << endl;
-  try {
-    response = json::parse( in_line );
-  }
-  catch ( const exception& e ){
-    string err_msg = "json parsing failed on '" + in_line + "':" + e.what();
-    LOG << err_msg << endl;
-    throw( runtime_error( err_msg ) );
-  }
+  json response = ServerPool::instance().query( _host, _port, _base,
+						query, dbgLog );
   //  LOG << "received json data:" << response.dump(2) << endl;
-  assert( response.size() == insts.size() );
-  if ( response.size() == 1 ){
+  if ( !response.is_array() ){
     classes.push_back( TiCC::UnicodeFromUTF8(response["category"]) );
   }
   else {
@@ -1133,26 +1521,7 @@ void Mbma::Classify( const icu::UnicodeString& word,
   if ( filter_diac ){
     uWord = TiCC::filter_diacritics( uWord );
   }
-  vector<UnicodeString> insts = make_instances( uWord );
-  vector<UnicodeString> classes;
-  classes.reserve( insts.size() );
-  //  LOG << "made instances: " << insts << endl;
-  if ( !_host.empty() ){
-    call_server( insts, classes );
-  }
-  else {
-    int i = 0;
-    for ( auto const& inst : insts ) {
-      UnicodeString ans;
-      MTree->Classify( inst, ans );
-      if ( debugFlag > 1){
-	DBG << "itt #" << i+1 << " " << insts[i] << " ==> " << ans
-	    << ", depth=" << MTree->matchDepth() << endl;
-	++i;
-      }
-      classes.push_back( ans );
-    }
-  }
+  vector<UnicodeString> classes = get_classes( uWord );
 
   // fix for 1st char class ==0
   if ( classes[0] == "0" ){
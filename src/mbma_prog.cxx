@@ -43,6 +43,7 @@
 #include "libfolia/folia.h"
 #include "frog/ucto_tokenizer_mod.h"
 #include "frog/cgn_tagger_mod.h"
+#include "frog/cgn_tag.h"
 
 using namespace std;
 using namespace icu;
@@ -203,12 +204,13 @@ void Test( istream& in ){
 	vector<TagResult> tagv = tagger.tagLine( s );
 	for ( const auto& tr : tagv ){
 	  UnicodeString uWord = tr.word();
-	  UnicodeString tag = tr.assigned_tag();
-	  vector<UnicodeString> v = TiCC::split_at_first_of( tag, "(,)" );
-	  if ( v.empty() ){
+	  const cgn_tag& parsed = cgn_tag::get( symbol( tr.assigned_tag() ) );
+	  if ( parsed.head.isEmpty() ){
 	    throw runtime_error( "error: tag not in right format " );
 	  }
-	  UnicodeString head = v[0];
+	  const UnicodeString& head = parsed.head;
+	  vector<symbol> v( 1, parsed.head );
+	  v.insert( v.end(), parsed.features.begin(), parsed.features.end() );
 	  if ( head != "SPEC" ){
 	    uWord.toLower();
 	  }
@@ -38,6 +38,8 @@
 #include <cstring>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <limits>
 
 #include "timbl/TimblAPI.h"
 #include "ticcutils/PrettyPrint.h"
@@ -51,6 +53,17 @@ using icu::UnicodeString;
 #define LOG *TiCC::Log(errLog)
 #define DBG *TiCC::Log(dbgLog)
 
+namespace {
+  /// \brief the start of a compiled MWU trie
+  struct mwu_trie_header {
+    uint64_t words;
+    uint64_t edges;
+    uint64_t nodes;
+    uint64_t entries;
+    uint64_t pool_units;   ///< the size of the word pool in code units
+  };
+}
+
 mwuAna::mwuAna( const UnicodeString& wrd,
 		bool glue_tag,
 		size_t index ):
@@ -67,16 +80,253 @@ mwuAna::mwuAna( const UnicodeString& wrd,
    */
 }
 
-void mwuAna::merge( const mwuAna *add ){
-  /// merge two mwuAna records
-  /*
-    \param add the mwuAna to merge.
+mwu_trie::mwu_trie():
+  _nodes( 1 ),
+  _entries( 0 ),
+  _compiled( 0 ),
+  _words( 0 ),
+  _edge_count( 0 ),
+  _word_index( 0 ),
+  _word_pool( 0 ),
+  _edge_keys( 0 ),
+  _edge_next( 0 ),
+  _final( 0 )
+{
+  /// create an empty trie, with only a root node
+}
 
-    in fact we only take over the endpostion of add the other fields are
-    of no interest more, as the words are already resolved
-   */
-  mwu_end = add->mwu_end;
-  delete add;
+void mwu_trie::add( const vector<UnicodeString>& words ){
+  /// add an MWU to the trie
+  /*!
+    \param words the words of the MWU, in order
+  */
+  if ( _compiled ){
+    throw logic_error( "mwu_trie: unable to add to a compiled trie" );
+  }
+  size_t current = 0;
+  for ( const auto& word : words ){
+    auto it = _nodes[current].next.find( word );
+    if ( it == _nodes[current].next.end() ){
+      // push_back may move the nodes, so don't keep references
+      _nodes.push_back( node() );
+      it = _nodes[current].next.insert( make_pair( word,
+						   _nodes.size()-1 ) ).first;
+    }
+    current = it->second;
+  }
+  if ( !_nodes[current].final ){
+    _nodes[current].final = true;
+    ++_entries;
+  }
+}
+
+size_t mwu_trie::step( size_t current, const UnicodeString& word ) const {
+  /// follow the edge for a word from a node
+  /*!
+    \param current the node to start from
+    \param word the word to follow
+    \return the index of the next node, or 0 when there is none
+  */
+  if ( !_compiled ){
+    const auto it = _nodes[current].next.find( word );
+    if ( it == _nodes[current].next.end() ){
+      return 0;
+    }
+    return it->second;
+  }
+  // find the number of the word
+  size_t low = 0;
+  size_t high = _words;
+  while ( low < high ){
+    size_t mid = low + ( high - low ) / 2;
+    int cmp = word.compare( _word_pool + _word_index[mid],
+			    (int32_t)( _word_index[mid+1] - _word_index[mid] ) );
+    if ( cmp == 0 ){
+      low = mid;
+      break;
+    }
+    if ( cmp > 0 ){
+      low = mid + 1;
+    }
+    else {
+      high = mid;
+    }
+  }
+  if ( low >= high ){
+    return 0;
+  }
+  uint64_t key = ( uint64_t(current) << 32 ) | low;
+  const uint64_t *end = _edge_keys + _edge_count;
+  const uint64_t *it = std::lower_bound( _edge_keys, end, key );
+  if ( it == end || *it != key ){
+    return 0;
+  }
+  return _edge_next[it - _edge_keys];
+}
+
+bool mwu_trie::is_final( size_t current ) const {
+  /// does an MWU end in a node?
+  return _compiled ? _final[current] != 0 : _nodes[current].final;
+}
+
+bool mwu_trie::has_start( const UnicodeString& word ) const {
+  /// check if any MWU starts with a word
+  return step( 0, word ) != 0;
+}
+
+size_t mwu_trie::longest_match( const UnicodeString& first,
+				const vector<mwuAna*>& words,
+				size_t start ) const {
+  /// find the longest MWU starting at a position
+  /*!
+    \param first the word to use for position \e start. (this may be a
+    decapped version)
+    \param words the words of the sentence
+    \param start the position of the first word
+    \return the number of words after \e start that are part of the MWU.
+    0 when there is no match.
+  */
+  size_t current = step( 0, first );
+  size_t result = 0;
+  for ( size_t j = start + 1; current != 0 && j < words.size(); ++j ){
+    current = step( current, words[j]->getWord() );
+    if ( current != 0 && is_final( current ) ){
+      result = j - start;
+    }
+  }
+  return result;
+}
+
+string mwu_trie::compile() const {
+  /// store the trie in a form that load() can use in place
+  /*!
+    \return the compiled trie: a header, the start of every word in the
+    word pool, the sorted edge keys, the node for every edge key, the words
+    in UTF-16 sorted on code units and a byte for every node telling if an
+    MWU ends there.
+
+    The words are numbered in sorted order, so a word number can be found
+    with a binary search.
+  */
+  if ( _compiled ){
+    const mwu_trie_header *head
+      = reinterpret_cast<const mwu_trie_header*>(_compiled);
+    return string( _compiled, sizeof(mwu_trie_header)
+		   + ( _words + 1 + _edge_count ) * sizeof(uint64_t)
+		   + _edge_count * sizeof(uint32_t)
+		   + _word_index[_words] * sizeof(UChar)
+		   + head->nodes );
+  }
+  if ( _nodes.size() > numeric_limits<uint32_t>::max() ){
+    throw runtime_error( "mwu_trie: too many nodes to compile" );
+  }
+  map<UnicodeString,uint32_t> vocab;
+  for ( const auto& nod : _nodes ){
+    for ( const auto& it : nod.next ){
+      vocab.insert( make_pair( it.first, 0 ) );
+    }
+  }
+  vector<uint64_t> word_index;
+  UnicodeString pool;
+  for ( auto& [word,num] : vocab ){
+    num = word_index.size();
+    word_index.push_back( pool.length() );
+    pool += word;
+  }
+  word_index.push_back( pool.length() );
+  map<uint64_t,uint32_t> edges;
+  string final_block( _nodes.size(), '\0' );
+  for ( size_t i=0; i < _nodes.size(); ++i ){
+    for ( const auto& [word,next] : _nodes[i].next ){
+      edges[ ( uint64_t(i) << 32 ) | vocab[word] ] = next;
+    }
+    if ( _nodes[i].final ){
+      final_block[i] = 1;
+    }
+  }
+  mwu_trie_header head;
+  head.words = vocab.size();
+  head.edges = edges.size();
+  head.nodes = _nodes.size();
+  head.entries = _entries;
+  head.pool_units = pool.length();
+  string result( reinterpret_cast<const char*>(&head), sizeof(head) );
+  result.append( reinterpret_cast<const char*>(word_index.data()),
+		 word_index.size() * sizeof(uint64_t) );
+  for ( const auto& edge : edges ){
+    result.append( reinterpret_cast<const char*>(&edge.first),
+		   sizeof(uint64_t) );
+  }
+  for ( const auto& edge : edges ){
+    result.append( reinterpret_cast<const char*>(&edge.second),
+		   sizeof(uint32_t) );
+  }
+  result.append( reinterpret_cast<const char*>(pool.getBuffer()),
+		 pool.length() * sizeof(UChar) );
+  result += final_block;
+  return result;
+}
+
+bool mwu_trie::load( const char *data, size_t size ){
+  /// use a compiled trie, as made by compile()
+  /*!
+    \param data the compiled trie. It must stay valid, and 8 byte aligned,
+    for the lifetime of this trie
+    \param size the size of \e data
+    \return false when the data is corrupt
+  */
+  if ( size < sizeof(mwu_trie_header) ){
+    return false;
+  }
+  mwu_trie_header head;
+  memcpy( &head, data, sizeof(head) );
+  const uint64_t max_items = size / sizeof(uint64_t);
+  if ( head.words >= max_items || head.edges >= max_items
+       || head.nodes == 0 || head.nodes > size
+       || head.pool_units >= size ){
+    return false;
+  }
+  size_t needed = sizeof(head)
+    + ( head.words + 1 + head.edges ) * sizeof(uint64_t)
+    + head.edges * sizeof(uint32_t)
+    + head.pool_units * sizeof(UChar)
+    + head.nodes;
+  if ( needed != size ){
+    return false;
+  }
+  const char *pos = data + sizeof(head);
+  const uint64_t *word_index = reinterpret_cast<const uint64_t*>( pos );
+  pos += ( head.words + 1 ) * sizeof(uint64_t);
+  const uint64_t *edge_keys = reinterpret_cast<const uint64_t*>( pos );
+  pos += head.edges * sizeof(uint64_t);
+  const uint32_t *edge_next = reinterpret_cast<const uint32_t*>( pos );
+  pos += head.edges * sizeof(uint32_t);
+  const UChar *pool = reinterpret_cast<const UChar*>( pos );
+  pos += head.pool_units * sizeof(UChar);
+  for ( size_t i=0; i < head.words; ++i ){
+    if ( word_index[i] > word_index[i+1] ){
+      return false;
+    }
+  }
+  if ( word_index[head.words] != head.pool_units ){
+    return false;
+  }
+  for ( size_t i=0; i < head.edges; ++i ){
+    if ( edge_next[i] >= head.nodes ){
+      return false;
+    }
+  }
+  _nodes.clear();
+  _entries = head.entries;
+  _words = head.words;
+  _edge_count = head.edges;
+  _word_index = word_index;
+  _word_pool = pool;
+  _edge_keys = edge_keys;
+  _edge_next = edge_next;
+  _final = reinterpret_cast<const uint8_t*>( pos );
+  _compiled = data;
+  return true;
 }
 
 Mwu::Mwu( TiCC::LogStream *err_log, TiCC::LogStream *dbg_log ){
@@ -92,6 +342,9 @@ Mwu::Mwu( TiCC::LogStream *err_log, TiCC::LogStream *dbg_log ){
   dbgLog = new TiCC::LogStream( dbg_log );
   dbgLog->add_message( "mwu-" );
   filter = 0;
+  _trie = 0;
+  _owns_trie = false;
+  _bundle = 0;
 }
 
 Mwu::~Mwu(){
@@ -100,6 +353,9 @@ Mwu::~Mwu(){
   delete errLog;
   delete dbgLog;
   delete filter;
+  if ( _owns_trie ){
+    delete _trie;
+  }
 }
 
 void Mwu::reset(){
@@ -124,10 +380,12 @@ void Mwu::add( const frog_record& fd ){
   mWords.push_back( new mwuAna( word, glue, index ) );
 }
 
-bool Mwu::read_mwus( const string& fname) {
-  /// fill our table with MWU's
+bool Mwu::read_lines( const string& fname,
+		      vector<UnicodeString>& lines ) {
+  /// read the lines of the MWU file
   /*!
-    \param fname the file to reaf from
+    \param fname the file to read from
+    \param lines the lines read
    */
   LOG << "read mwus " + fname << endl;
   ifstream mwufile(fname, ios::in);
@@ -137,14 +395,66 @@ bool Mwu::read_mwus( const string& fname) {
   }
   UnicodeString line;
   while( TiCC::getline( mwufile, line ) ) {
+    lines.push_back( line );
+  }
+  return true;
+}
+
+bool Mwu::read_mwus( const string& fname) {
+  /// fill our table with MWU's
+  /*!
+    \param fname the file to read from
+   */
+  vector<UnicodeString> lines;
+  return read_lines( fname, lines ) && fill_mwus( lines );
+}
+
+bool Mwu::load_mwus() {
+  /// use the compiled MWU trie from the resource bundle
+  /*!
+    \return false when the bundle has no up to date MWU's. The caller
+    should read the MWU file then.
+   */
+  const char *data = 0;
+  size_t size = 0;
+  if ( !_bundle
+       || !_bundle->find( "mwu:t", make_stamp( "mwu", mwuFileName ),
+			  data, size ) ){
+    return false;
+  }
+  mwu_trie *trie = new mwu_trie();
+  if ( !trie->load( data, size ) ){
+    LOG << "corrupt section mwu:t in resource bundle, reading "
+	<< mwuFileName << endl;
+    delete trie;
+    return false;
+  }
+  if ( _owns_trie ){
+    delete _trie;
+  }
+  _trie = trie;
+  _owns_trie = true;
+  LOG << "using precompiled mwu:t (" << _trie->size() << " MWU's)" << endl;
+  return true;
+}
+
+bool Mwu::fill_mwus( const vector<UnicodeString>& lines ) {
+  /// fill our table with MWU's
+  /*!
+    \param lines the lines of the MWU file
+   */
+  if ( _owns_trie ){
+    delete _trie;
+  }
+  _trie = new mwu_trie();
+  _owns_trie = true;
+  for ( const auto& line : lines ){
     vector<UnicodeString> res1 = TiCC::split_at(line, " ");
     if ( res1.size() == 2 ){
       vector<UnicodeString> res2 = TiCC::split_at(res1[0], "_");;
       //res1 has mwus and tags, res2 has ind. words
       if ( res2.size() >= 2 ){
-	UnicodeString key = res2[0];
-	res2.erase(res2.begin());
-	MWUs.insert( make_pair( key, res2 ) );
+	_trie->add( res2 );
       }
       else {
 	LOG << "invalid entry in MWU file " << line << endl;
@@ -159,10 +469,12 @@ bool Mwu::read_mwus( const string& fname) {
   return true;
 }
 
-bool Mwu::init( const TiCC::Configuration& config ) {
+bool Mwu::init( const TiCC::Configuration& config, const Mwu *model ) {
   /// initialize the Mwu using a Configuration structure
   /*!
     \param config the configuration to use
+    \param model an already initialized Mwu. When given, the MWU table is
+    shared with the model instead of read from file.
    */
   LOG << "initiating mwuChunker..." << endl;
   debug = 0;
@@ -179,9 +491,15 @@ bool Mwu::init( const TiCC::Configuration& config ) {
     return false;
   }
   mwuFileName = prefix( config.configDir(), val );
-  if ( !read_mwus(mwuFileName) ) {
-    LOG << "Cannot read mwu file " << mwuFileName << endl;
-    return false;
+  if ( model ){
+    _trie = model->_trie;
+    _owns_trie = false;
+  }
+  else if ( !load_mwus() ){
+    if ( !read_mwus(mwuFileName) ) {
+      LOG << "Cannot read mwu file " << mwuFileName << endl;
+      return false;
+    }
   }
   val = config.lookUp( "version", "mwu" );
   if ( val.empty() ){
@@ -225,6 +543,32 @@ bool Mwu::init( const TiCC::Configuration& config ) {
   return true;
 }
 
+bool Mwu::compile_resources( const TiCC::Configuration& config,
+			     vector<ResourceBundle::section>& sections ){
+  /// read the MWU file and add it to a resource bundle
+  /*!
+    \param config the configuration to use
+    \param sections the list of sections to add the MWU's to
+    \return false when the MWU file is invalid
+   */
+  string val = config.lookUp( "t", "mwu" );
+  if ( val.empty() ){
+    LOG << "cannot find attribute 't' in configfile" << endl;
+    return false;
+  }
+  mwuFileName = prefix( config.configDir(), val );
+  if ( !read_mwus( mwuFileName ) ){
+    LOG << "Cannot read mwu file " << mwuFileName << endl;
+    return false;
+  }
+  ResourceBundle::section sec;
+  sec.name = "mwu:t";
+  sec.stamp = make_stamp( "mwu", mwuFileName );
+  sec.data = _trie->compile();
+  sections.push_back( sec );
+  return true;
+}
+
 using TiCC::operator<<;
 
 ostream &operator<<( ostream& os, const Mwu& mwu ){
@@ -297,125 +641,67 @@ void Mwu::Classify(){
   /// examine the Mwu's internal mwuAna nodes to determine the spans of
   /// all mwu's found
   /*!
-    First we collect all 'glue tags' into MWU's
+    The words are scanned once, from left to right. At every position we take
+    the longest MWU from our table that starts there, and continue after it.
 
-    Second we do a lookup of the words in our table and keep the longest match
+    A sequence of 2 or more words with the 'glue tag' is an MWU too, for this
+    sentence only. It is used when it is longer than the match from the table.
+    Only the very first word of the sentence is also tried decapped, when no
+    MWU at all starts with it.
    */
   if ( debug > 1 ) {
     DBG << "Starting mwu Classify" << endl;
   }
-  mymap2::iterator best_match;
-  size_t matchLength = 0;
   size_t max = mWords.size();
-
-  // add all current sequences of the glue_tag words to MWUs
-  for ( size_t i=0; i < max-1; ++i ) {
-    if ( mWords[i]->isSpec() && mWords[i+1]->isSpec() ) {
-      vector<UnicodeString> newmwu;
-      while ( i < max && mWords[i]->isSpec() ){
-	newmwu.push_back(mWords[i]->getWord());
-	i++;
-      }
-      UnicodeString key = newmwu[0];
-      newmwu.erase( newmwu.begin() );
-      MWUs.insert( make_pair(key, newmwu) );
-    }
-  }
-  size_t i;
-  for ( i = 0; i < max; i++) {
+  size_t i = 0;
+  while ( i < max ){
     UnicodeString word = mWords[i]->getWord();
     if ( debug > 1 ){
       DBG << "checking word[" << i <<"]: " << word << endl;
     }
-    auto matches = MWUs.equal_range(word);
     if ( i == 0
-	 && matches.first == matches.second ) {
+	 && !_trie->has_start( word ) ) {
       // no match on first word. try decaped version.
       // we do this ONLY for the very first word in the sentence!
       word = decap( word );
       if ( debug > 1 ){
      	DBG << "checking decapped word [" << i <<"]: " << word << endl;
       }
-      matches = MWUs.equal_range(word);
     }
-    if ( matches.first != matches.second ) {
-      //match
-      auto current_match = matches.first;
-      if (  debug > 1 ) {
-	DBG << "MWU: match found for " << word << endl;
+    size_t matchLength = _trie->longest_match( word, mWords, i );
+    if ( mWords[i]->isSpec()
+	 && ( i == 0 || !mWords[i-1]->isSpec() ) ){
+      // the start of a sequence of glue_tag words
+      size_t glued = 0;
+      while ( i + glued + 1 < max && mWords[i+glued+1]->isSpec() ){
+	++glued;
       }
-      while( current_match != matches.second
-	     && current_match != MWUs.end() ){
-	vector<UnicodeString> match = current_match->second;
-	size_t max_match = match.size();
-	size_t j = 0;
+      if ( glued > matchLength ){
 	if ( debug > 1 ){
-	  DBG << "checking " << max_match << " matches:" << endl;
-	}
-	for (; i + j + 1 < max && j < max_match; j++) {
-	  if ( match[j] != mWords[i+j+1]->getWord() ) {
-	    if ( debug > 1){
-	      DBG << "match " << j <<" (" << match[j]
-			   << ") doesn't match with word " << i+ j + 1
-			   << " (" << mWords[i+j + 1]->getWord() <<")" << endl;
-	    }
-	    // mismatch in jth word of current mwu
-	    break;
-	  }
-	  else if ( debug > 1 ){
-	    DBG << " matched " <<  mWords[i+j+1]->getWord()
-			 << " j=" << j << endl;
-	  }
-
-	}
-	if (j == max_match && j > matchLength ){
-	  // a match. remember this!
-	  best_match = current_match;
-	  matchLength = j;
-	}
-	++current_match;
-      } // while
-      if( debug > 1){
-	if (matchLength >0 ) {
-	  DBG << "MWU: found match starting with " << (*best_match).first << endl;
-	}
-	else {
-	  DBG <<"MWU: no match" << endl;
+	  DBG << "MWU: glue_tag sequence of " << glued+1 << " words" << endl;
 	}
+	matchLength = glued;
       }
-      // we found a matching mwu, break out of the loop
-      // do useful stuff, and recurse to find more mwus
-      if ( matchLength > 0 ){
-	break;
+    }
+    if ( matchLength > 0 ){
+      if ( debug > 1 ){
+	DBG << "MWU: found match of " << matchLength+1
+	    << " words starting with " << word << endl;
       }
-    } //match found
+      mWords[i]->mwu_end = mWords[i+matchLength]->mwu_end;
+      i += matchLength + 1;
+    }
     else {
       if( debug > 1 ) {
 	DBG <<"MWU:check: no match" << endl;
       }
+      ++i;
     }
-  } //for (i < max)
-  if ( matchLength > 0 ) {
-    //concat
-    if ( debug >1 ){
-      DBG << "mwu found, processing" << endl;
-    }
-    for ( size_t j = 1; j <= matchLength; ++j) {
-      if ( debug > 1 ){
-	DBG << "concat " << mWords[i+j]->getWord() << endl;
-      }
-      mWords[i]->merge( mWords[i+j] );
-    }
-    auto anatmp1 = mWords.begin() + i;
-    auto anatmp2 = ++anatmp1 + matchLength;
-    mWords.erase(anatmp1, anatmp2);
-    if ( debug > 1 ){
-      DBG << "tussenstand:" << endl;
-      DBG << *this << endl;
-    }
-    Classify( );
-  } //if (matchLength)
-  return;
+  }
+  if ( debug > 1 ){
+    DBG << "result:" << endl;
+    DBG << *this << endl;
+  }
 } // //Classify
 
 void Mwu::add_result( const frog_data& fd,
@@ -30,6 +30,8 @@
 */
 
 #include <algorithm>
+#include <limits>
+#include <cstring>
 #include "frog/ner_tagger_mod.h"
 
 #include "mbt/MbtAPI.h"
@@ -48,8 +50,361 @@ using TiCC::operator<<;
 
 static string POS_tagset  = "http://ilk.uvt.nl/folia/sets/frog-mbpos-cgn";
 
+namespace {
+  /// \brief the start of a compiled gazetteer
+  struct gazetteer_header {
+    uint64_t words;
+    uint64_t edges;
+    uint64_t nodes;
+    uint64_t entries;
+    uint64_t pool_units;   ///< the size of the word pool in code units
+    uint64_t names_size;   ///< the size of the category names
+  };
+}
+
+ner_gazetteer::ner_gazetteer():
+  _node_cats( 1, 0 ),
+  _entries( 0 ),
+  _compiled( 0 ),
+  _words( 0 ),
+  _edge_count( 0 ),
+  _nodes( 0 ),
+  _word_index( 0 ),
+  _word_pool( 0 ),
+  _edge_keys( 0 ),
+  _edge_next( 0 ),
+  _compiled_cats( 0 )
+{
+  /// create an empty gazetteer, with only a root node
+}
+
+bool ner_gazetteer::add( const vector<UnicodeString>& words,
+			 const string& cat ){
+  /// add a Named Entity to the gazetteer
+  /*!
+    \param words the words of the NE
+    \param cat the category of the NE (like 'loc' or 'org')
+    \return false when there are too many categories to store
+  */
+  if ( _compiled ){
+    throw logic_error( "ner_gazetteer: unable to add to a compiled gazetteer" );
+  }
+  if ( words.empty() ){
+    return true;
+  }
+  auto cit = _categories.find( cat );
+  if ( cit == _categories.end() ){
+    if ( _categories.size() >= 8 * sizeof(category_set) ){
+      return false;
+    }
+    size_t bit = _categories.size();
+    cit = _categories.insert( make_pair( cat, bit ) ).first;
+  }
+  uint32_t node = 0;
+  for ( const auto& word : words ){
+    auto vit = _vocab.find( word );
+    if ( vit == _vocab.end() ){
+      uint32_t num = _vocab.size();
+      vit = _vocab.insert( make_pair( word, num ) ).first;
+    }
+    uint64_t key = ( uint64_t(node) << 32 ) | vit->second;
+    auto eit = _edges.find( key );
+    if ( eit == _edges.end() ){
+      _node_cats.push_back( 0 );
+      uint32_t next = _node_cats.size() - 1;
+      eit = _edges.insert( make_pair( key, next ) ).first;
+    }
+    node = eit->second;
+  }
+  if ( _node_cats[node] == 0 ){
+    ++_entries;
+  }
+  _node_cats[node] |= category_set(1) << cit->second;
+  return true;
+}
+
+vector<ner_gazetteer::category_set> ner_gazetteer::match( const vector<UnicodeString>& words,
+							  size_t max_len ) const {
+  /// find all known NE's in a sentence
+  /*!
+    \param words the words of the sentence
+    \param max_len the maximum length of a NE
+    \return for every word the union of the categories of all NE's that
+    cover that word
+  */
+  vector<category_set> result( words.size(), 0 );
+  if ( _entries == 0 ){
+    return result;
+  }
+  // number the words once. Unknown words can't be part of any NE
+  const uint32_t unknown = numeric_limits<uint32_t>::max();
+  vector<uint32_t> nums( words.size(), unknown );
+  for ( size_t i=0; i < words.size(); ++i ){
+    word_number( words[i], nums[i] );
+  }
+  vector<category_set> found; // the categories of the NE's from j, per length
+  for ( size_t j=0; j < words.size(); ++j ){
+    found.clear();
+    uint32_t node = 0;
+    for ( size_t i=j;
+	  i < words.size() && i-j < max_len && nums[i] != unknown;
+	  ++i ){
+      if ( !next_node( node, nums[i], node ) ){
+	break;
+      }
+      found.push_back( categories( node ) );
+    }
+    // a NE of length n covers the words j to j+n-1, so every word is
+    // covered by all NE's at least as long as its distance to j
+    category_set covering = 0;
+    for ( size_t n=found.size(); n > 0; --n ){
+      covering |= found[n-1];
+      result[j+n-1] |= covering;
+    }
+  }
+  return result;
+}
+
+bool ner_gazetteer::word_number( const UnicodeString& word,
+				 uint32_t& num ) const {
+  /// find the number of a word
+  /*!
+    \param word the word to look up
+    \param num the number found
+    \return false when the word is not part of any NE
+  */
+  if ( !_compiled ){
+    auto const vit = _vocab.find( word );
+    if ( vit == _vocab.end() ){
+      return false;
+    }
+    num = vit->second;
+    return true;
+  }
+  size_t low = 0;
+  size_t high = _words;
+  while ( low < high ){
+    size_t mid = low + ( high - low ) / 2;
+    int cmp = word.compare( _word_pool + _word_index[mid],
+			    (int32_t)( _word_index[mid+1] - _word_index[mid] ) );
+    if ( cmp == 0 ){
+      num = mid;
+      return true;
+    }
+    if ( cmp > 0 ){
+      low = mid + 1;
+    }
+    else {
+      high = mid;
+    }
+  }
+  return false;
+}
+
+bool ner_gazetteer::next_node( uint32_t node,
+			       uint32_t word,
+			       uint32_t& next ) const {
+  /// follow the edge for a word from a node
+  /*!
+    \param node the node to start from
+    \param word the number of the word
+    \param next the node found
+    \return false when there is no such edge
+  */
+  uint64_t key = ( uint64_t(node) << 32 ) | word;
+  if ( !_compiled ){
+    auto const eit = _edges.find( key );
+    if ( eit == _edges.end() ){
+      return false;
+    }
+    next = eit->second;
+    return true;
+  }
+  const uint64_t *end = _edge_keys + _edge_count;
+  const uint64_t *it = std::lower_bound( _edge_keys, end, key );
+  if ( it == end || *it != key ){
+    return false;
+  }
+  next = _edge_next[it - _edge_keys];
+  return true;
+}
+
+ner_gazetteer::category_set ner_gazetteer::categories( uint32_t node ) const {
+  /// return the categories of the NE's ending in a node
+  return _compiled ? _compiled_cats[node] : _node_cats[node];
+}
+
+string ner_gazetteer::compile() const {
+  /// store the gazetteer in a form that load() can use in place
+  /*!
+    \return the compiled gazetteer: a header, the start of every word in the
+    word pool, the sorted edge keys, the categories of every node, the node
+    for every edge key, the words in UTF-16 sorted on code units and the
+    category names in bit order, separated by newlines.
+
+    The words are renumbered in sorted order, so a word number can be found
+    with a binary search.
+  */
+  if ( _compiled ){
+    return string( _compiled, sizeof(gazetteer_header)
+		   + ( _words + 1 + _edge_count + _nodes ) * sizeof(uint64_t)
+		   + _edge_count * sizeof(uint32_t)
+		   + _word_index[_words] * sizeof(UChar)
+		   + reinterpret_cast<const gazetteer_header*>(_compiled)->names_size );
+  }
+  vector<pair<UnicodeString,uint32_t>> sorted( _vocab.begin(), _vocab.end() );
+  std::sort( sorted.begin(), sorted.end() );
+  vector<uint32_t> renumber( sorted.size() );
+  vector<uint64_t> word_index;
+  UnicodeString pool;
+  for ( size_t i=0; i < sorted.size(); ++i ){
+    renumber[sorted[i].second] = i;
+    word_index.push_back( pool.length() );
+    pool += sorted[i].first;
+  }
+  word_index.push_back( pool.length() );
+  map<uint64_t,uint32_t> edges;
+  for ( const auto& [key,next] : _edges ){
+    uint64_t node = key >> 32;
+    uint32_t word = key & 0xFFFFFFFF;
+    edges[ ( node << 32 ) | renumber[word] ] = next;
+  }
+  vector<string> names( _categories.size() );
+  for ( const auto& [cat,bit] : _categories ){
+    names[bit] = cat;
+  }
+  string name_block;
+  for ( const auto& name : names ){
+    name_block += name + "\n";
+  }
+  gazetteer_header head;
+  head.words = sorted.size();
+  head.edges = edges.size();
+  head.nodes = _node_cats.size();
+  head.entries = _entries;
+  head.pool_units = pool.length();
+  head.names_size = name_block.size();
+  string result( reinterpret_cast<const char*>(&head), sizeof(head) );
+  result.append( reinterpret_cast<const char*>(word_index.data()),
+		 word_index.size() * sizeof(uint64_t) );
+  for ( const auto& edge : edges ){
+    result.append( reinterpret_cast<const char*>(&edge.first),
+		   sizeof(uint64_t) );
+  }
+  result.append( reinterpret_cast<const char*>(_node_cats.data()),
+		 _node_cats.size() * sizeof(category_set) );
+  for ( const auto& edge : edges ){
+    result.append( reinterpret_cast<const char*>(&edge.second),
+		   sizeof(uint32_t) );
+  }
+  result.append( reinterpret_cast<const char*>(pool.getBuffer()),
+		 pool.length() * sizeof(UChar) );
+  result += name_block;
+  return result;
+}
+
+bool ner_gazetteer::load( const char *data, size_t size ){
+  /// use a compiled gazetteer, as made by compile()
+  /*!
+    \param data the compiled gazetteer. It must stay valid, and 8 byte
+    aligned, for the lifetime of this gazetteer
+    \param size the size of \e data
+    \return false when the data is corrupt
+  */
+  if ( size < sizeof(gazetteer_header) ){
+    return false;
+  }
+  gazetteer_header head;
+  memcpy( &head, data, sizeof(head) );
+  const uint64_t max_items = size / sizeof(uint64_t);
+  if ( head.words >= max_items || head.edges >= max_items
+       || head.nodes == 0 || head.nodes >= max_items
+       || head.pool_units >= size || head.names_size > size ){
+    return false;
+  }
+  size_t needed = sizeof(head)
+    + ( head.words + 1 + head.edges + head.nodes ) * sizeof(uint64_t)
+    + head.edges * sizeof(uint32_t)
+    + head.pool_units * sizeof(UChar)
+    + head.names_size;
+  if ( needed != size ){
+    return false;
+  }
+  const char *pos = data + sizeof(head);
+  const uint64_t *word_index = reinterpret_cast<const uint64_t*>( pos );
+  pos += ( head.words + 1 ) * sizeof(uint64_t);
+  const uint64_t *edge_keys = reinterpret_cast<const uint64_t*>( pos );
+  pos += head.edges * sizeof(uint64_t);
+  const category_set *cats = reinterpret_cast<const category_set*>( pos );
+  pos += head.nodes * sizeof(category_set);
+  const uint32_t *edge_next = reinterpret_cast<const uint32_t*>( pos );
+  pos += head.edges * sizeof(uint32_t);
+  const UChar *pool = reinterpret_cast<const UChar*>( pos );
+  pos += head.pool_units * sizeof(UChar);
+  for ( size_t i=0; i < head.words; ++i ){
+    if ( word_index[i] > word_index[i+1] ){
+      return false;
+    }
+  }
+  if ( word_index[head.words] != head.pool_units ){
+    return false;
+  }
+  for ( size_t i=0; i < head.edges; ++i ){
+    if ( edge_next[i] >= head.nodes ){
+      return false;
+    }
+  }
+  map<string,size_t> categories;
+  string names( pos, head.names_size );
+  size_t start = 0;
+  size_t end;
+  while ( ( end = names.find( '\n', start ) ) != string::npos ){
+    size_t bit = categories.size();
+    categories[names.substr( start, end - start )] = bit;
+    start = end + 1;
+  }
+  if ( categories.size() > 8 * sizeof(category_set) ){
+    return false;
+  }
+  _vocab.clear();
+  _edges.clear();
+  _node_cats.clear();
+  _categories = categories;
+  _entries = head.entries;
+  _words = head.words;
+  _edge_count = head.edges;
+  _nodes = head.nodes;
+  _word_index = word_index;
+  _word_pool = pool;
+  _edge_keys = edge_keys;
+  _edge_next = edge_next;
+  _compiled_cats = cats;
+  _compiled = data;
+  return true;
+}
+
+UnicodeString ner_gazetteer::serialize( category_set cats ) const {
+  /// compose the ambitag for a set of categories
+  /*!
+    \param cats the categories
+    \return a string like cat1+cat2+ with the categories sorted, or "O" when
+    \e cats is empty
+  */
+  if ( cats == 0 ){
+    return "O";
+  }
+  UnicodeString result;
+  for ( const auto& [cat,bit] : _categories ){
+    if ( cats & ( category_set(1) << bit ) ){
+      result += TiCC::UnicodeFromUTF8(cat) + "+";
+    }
+  }
+  return result;
+}
+
 NERTagger::NERTagger( TiCC::LogStream *l, TiCC::LogStream *d ):
   BaseTagger( l, d, "NER" ),
+  _ner_model(0),
   gazets_only(false),
   max_ner_size(20)
 {
@@ -58,37 +413,49 @@ NERTagger::NERTagger( TiCC::LogStream *l, TiCC::LogStream *d ):
     \param l a LogStream for errors
     \param d a LogStream for debugging
   */
-  gazet_ners.resize( max_ner_size + 1 );
-  override_ners.resize( max_ner_size + 1 );
 }
 
-bool NERTagger::init( const TiCC::Configuration& config ){
+bool NERTagger::init( const TiCC::Configuration& config,
+		      const BaseTagger *model ){
   /// initalize a NER tagger from 'config'
   /*!
     \param config the TiCC::Configuration
+    \param model an already initialized tagger to share the models with
     \return true on succes, false otherwise
 
     first BaseTagger::init() is called to set generic values,
     then the NER specific values for the gazeteer file-names etc. are
-    added and the files are read.
+    added and the files are read. When a model is given, we use the gazeteers
+    of that model instead of reading them again.
   */
- if ( !BaseTagger::init( config ) ){
+ if ( !BaseTagger::init( config, model ) ){
     return false;
   }
   string val = config.lookUp( "max_ner_size", "NER" );
   if ( !val.empty() ){
     max_ner_size = TiCC::stringTo<int>( val );
   }
-  val = config.lookUp( "known_ners", "NER" );
-  if ( !val.empty() ){
-    if ( !read_gazets( val, config.configDir() ) ){
+  if ( model ){
+    _ner_model = dynamic_cast<const NERTagger*>( model );
+    if ( !_ner_model ){
+      LOG << "unable to share the NER gazeteers of another tagger" << endl;
       return false;
     }
   }
-  val = config.lookUp( "ner_override", "NER" );
-  if ( !val.empty() ){
-    if ( !read_overrides( val, config.configDir() ) ){
-      return false;
+  else {
+    val = config.lookUp( "known_ners", "NER" );
+    if ( !val.empty() ){
+      if ( !load_gazets( "ner:known_ners", val,
+			 config.configDir(), gazet_ners ) ){
+	return false;
+      }
+    }
+    val = config.lookUp( "ner_override", "NER" );
+    if ( !val.empty() ){
+      if ( !load_gazets( "ner:ner_override", val,
+			 config.configDir(), override_ners ) ){
+	return false;
+      }
     }
   }
   val = config.lookUp( "only_gazets", "NER" );
@@ -105,7 +472,7 @@ bool NERTagger::init( const TiCC::Configuration& config ){
 bool NERTagger::fill_ners( const string& cat,
 			   const string& name,
 			   const string& config_dir,
-			   vector<map<UnicodeString,set<string>>>& ners ){
+			   ner_gazetteer& ners ){
   /// fill known Named Entities from one gazeteer file
   /*!
     \param cat The NE categorie (like 'loc' or 'org')
@@ -147,15 +514,11 @@ bool NERTagger::fill_ners( const string& cat,
 	  continue;
 	}
       }
-      // reconstruct the NER with single spaces
-      UnicodeString clean_line = "";
-      for ( const auto& part : parts ){
-	clean_line += part;
-	if ( &part != &parts.back() ){
-	  clean_line += " ";
-	}
+      if ( !ners.add( parts, cat ) ){
+	LOG << "too many Named Entity categories, unable to add '" << cat
+	    << "'" << endl;
+	return false;
       }
-      ners[parts.size()][clean_line].insert( cat );
       ++ner_cnt;
     }
   }
@@ -166,19 +529,16 @@ bool NERTagger::fill_ners( const string& cat,
 
 bool NERTagger::read_gazets( const string& name,
 			     const string& config_dir,
-			     vector<map<UnicodeString,set<string>>>& ners ){
+			     ner_gazetteer& ners ){
   /// fill known Named Entities from a list of gazeteer files
   /*!
     \param name the filename to read the gazeteer info from
     \param config_dir the directory to search for files
     \param ners the structure to store the NE's in
 
-    NE's are stored in a vector of maps, ranked on their length. So NE's of
-    length 1 ("London") are stored at position 1 and so on. ("dag van de arbeid"
-    at position 4).
-
-    the NE is stored in a map using as the mono-spaced string as key and adding
-    the cetagory in a set. (as categories can be ambiguous)
+    NE's are stored in a token trie, so "dag van de arbeid" is stored as the
+    path dag -> van -> de -> arbeid. The end of that path holds the set of
+    categories of the NE. (as categories can be ambiguous)
   */
   string file_name = name;
   string lookup_dir = config_dir;
@@ -230,62 +590,129 @@ bool NERTagger::read_gazets( const string& name,
   }
 }
 
-static vector<UnicodeString> serialize( const vector<set<string>>& stags ){
-  /// for every non empty set {el1,el2,..} in stags we compose a string like:
-  /// el1+el2+...
-  vector<UnicodeString> ambitags( stags.size(), "O" );
-  size_t pos = 0;
-  for ( const auto& it : stags ){
-    if ( !it.empty() ){
-      UnicodeString res;
-      for ( const auto& s : it ){
-	res += TiCC::UnicodeFromUTF8(s) + "+";
+uint64_t NERTagger::gazets_stamp( const string& name,
+				  const string& config_dir ) const {
+  /// calculate a stamp for a list of gazeteer files
+  /*!
+    \param name the filename to read the gazeteer info from
+    \param config_dir the directory to search for files
+    \return a stamp which changes when the list, one of the files in it or
+    the max_ner_size changes
+  */
+  string file_name = name;
+  string lookup_dir = config_dir;
+  if ( name[0] != '/' ) {
+    file_name = prefix( config_dir, file_name );
+  }
+  else {
+    lookup_dir = TiCC::dirname( file_name );
+  }
+  vector<string> files;
+  files.push_back( file_name );
+  ifstream is( file_name );
+  string line;
+  while ( getline( is, line ) ){
+    if ( line.empty() || line[0] == '#' ){
+      continue;
+    }
+    vector<string> parts = TiCC::split_at( line, "\t" );
+    if ( parts.size() != 2 ){
+      continue;
+    }
+    string file = parts[1];
+    if ( !TiCC::isFile( file ) ){
+      file = lookup_dir + "/" + file;
+    }
+    files.push_back( file );
+  }
+  return make_stamp( "ner:" + TiCC::toString( max_ner_size ), files );
+}
+
+bool NERTagger::load_gazets( const string& section,
+			     const string& name,
+			     const string& config_dir,
+			     ner_gazetteer& ners ){
+  /// fill known Named Entities from the resource bundle or from the files
+  /*!
+    \param section the name of the precompiled section in the bundle
+    \param name the filename to read the gazeteer info from
+    \param config_dir the directory to search for files
+    \param ners the structure to store the NE's in
+
+    When a resource bundle is opened and it holds an up to date version of
+    \e section, we use that in place. Otherwise the gazeteer files are read.
+  */
+  if ( _bundle ){
+    const char *data = 0;
+    size_t size = 0;
+    if ( _bundle->find( section, gazets_stamp( name, config_dir ),
+			data, size ) ){
+      if ( ners.load( data, size ) ){
+	LOG << "using precompiled " << section << " ("
+	    << ners.size() << " Named Entities)" << endl;
+	return true;
       }
-      ambitags[pos] = res;
+      LOG << "corrupt section " << section
+	  << " in resource bundle, reading " << name << endl;
     }
-    ++pos;
   }
-  return ambitags;
+  return read_gazets( name, config_dir, ners );
+}
+
+bool NERTagger::compile_resources( const TiCC::Configuration& config,
+				   vector<ResourceBundle::section>& sections ){
+  /// read the gazeteers and add them to a resource bundle
+  /*!
+    \param config the TiCC::Configuration
+    \param sections the list of sections to add the compiled gazeteers to
+    \return false when reading the gazeteers failed
+  */
+  string val = config.lookUp( "max_ner_size", "NER" );
+  if ( !val.empty() ){
+    max_ner_size = TiCC::stringTo<int>( val );
+  }
+  const vector<pair<string,ner_gazetteer*>> lists
+    = { { "known_ners", &gazet_ners },
+	{ "ner_override", &override_ners } };
+  for ( const auto& [key,ners] : lists ){
+    val = config.lookUp( key, "NER" );
+    if ( val.empty() ){
+      continue;
+    }
+    if ( !read_gazets( val, config.configDir(), *ners ) ){
+      return false;
+    }
+    ResourceBundle::section sec;
+    sec.name = "ner:" + key;
+    sec.stamp = gazets_stamp( val, config.configDir() );
+    sec.data = ners->compile();
+    sections.push_back( sec );
+  }
+  return true;
 }
 
 vector<UnicodeString> NERTagger::create_ner_list( const vector<UnicodeString>& words,
-						  const vector<map<UnicodeString,set<string>>>& ners ){
+						  const ner_gazetteer& ners ){
   /// create a list of ambitags given a range of words
   /*!
     \param words a sentence as a list of words
     \param ners the NE structure to examine
+    \return a list with an ambitag like 'loc+org+' for every word, or 'O'
+    for words that are not part of a known NE
    */
-  vector<set<string>> stags( words.size() );
   if ( debug > 1 ){
     DBG << "search for known NER's" << endl;
   }
-  for ( size_t j=0; j < words.size(); ++j ){
-    // cycle through the words
-    UnicodeString seq;
-    size_t len = 1;
-    for ( size_t i = 0; i < min( words.size() - j, (size_t)max_ner_size); ++i ){
-      // start looking for sequences of length len
-      auto const mp = ners[len++];
-      if ( mp.empty() ){
-	continue;
-      }
-      seq += words[j+i];
-      if ( debug > 1 ){
-	DBG << "sequence = '" << seq << "'" << endl;
-      }
-      auto const& tags = mp.find(seq);
-      if ( tags != mp.end() ){
-	if ( debug > 1 ){
-	  DBG << "FOUND tags " << tags->first << "-" << tags->second << endl;
-	}
-	for ( size_t k = 0; k <= i; ++k ){
-	  stags[k+j].insert( tags->second.begin(), tags->second.end() );
-	}
-      }
-      seq += " ";
-    }
+  vector<ner_gazetteer::category_set> cats = ners.match( words, max_ner_size );
+  vector<UnicodeString> result;
+  result.reserve( cats.size() );
+  for ( const auto& c : cats ){
+    result.push_back( ners.serialize( c ) );
+  }
+  if ( debug > 1 ){
+    DBG << "FOUND tags " << result << endl;
   }
-  return serialize( stags );
+  return result;
 }
 
 void NERTagger::add_declaration( folia::Document& doc,
@@ -300,18 +727,15 @@ void NERTagger::add_declaration( folia::Document& doc,
   doc.declare( folia::AnnotationType::ENTITY, tagset, args );
 }
 
-void NERTagger::Classify( frog_data& swords ){
-  /// Tag one sentence, given in frog_data format
+void NERTagger::sentence_words( const frog_data& swords,
+				vector<UnicodeString>& words,
+				vector<UnicodeString>& pos_tags ) const {
+  /// extract the words and POS tags of a sentence
   /*!
-    \param swords the frog_data structure to analyze
-
-    When tagging succeeds, 'swords' will be extended with the tag results
-   */
-  if ( debug ){
-    DBG << "classify from DATA" << endl;
-  }
-  vector<UnicodeString> words;
-  vector<UnicodeString> pos_tags;
+    \param swords the frog_data structure to examine
+    \param words the (space filtered) words
+    \param pos_tags the POS tags of the words
+  */
 #pragma omp critical (dataupdate)
   {
     for ( const auto& w : swords.units ){
@@ -321,101 +745,156 @@ void NERTagger::Classify( frog_data& swords ){
       pos_tags.push_back( w.tag );
     }
   }
-  vector<tc_pair> ner_tags;
+}
+
+void NERTagger::Classify( const vector<frog_data*>& batch ){
+  /// Tag a batch of sentences, given in frog_data format
+  /*!
+    \param batch the frog_data structures to analyze
+
+    When tagging succeeds, every sentence will be extended with the tag
+    results. Unless only gazeteers are used, all sentences are tagged with
+    one call to the tagger.
+   */
+  if ( debug ){
+    DBG << "classify from DATA" << endl;
+  }
   if ( gazets_only ){
-    vector<UnicodeString> gazet_tags = create_ner_list( words, gazet_ners );
-    UnicodeString last = "O";
-    cerr << "bekijk gazet tags: " << gazet_tags << endl;
-    for ( const auto& it : gazet_tags ){
-      vector<UnicodeString> parts = TiCC::split_at( it, "+" );
-      UnicodeString tag = parts[0];
-      cerr << "AHA: last = " << last << " Nieuw=" << tag << endl;
-      if ( tag == "O" ){
-	last = tag;
-      }
-      else {
-	if ( tag == last ){
-	  tag = "I-" + tag;
-	}
-	else {
-	  last = tag;
-	  tag = "B-" + tag;
-	}
-      }
-      cerr << "add a tag: " << tag << endl;
-      ner_tags.push_back( make_pair( tag, 1.0 ) );
+    for ( const auto& sent : batch ){
+      classify_gazets( *sent );
     }
   }
   else {
-    vector<UnicodeString> gazet_tags = create_ner_list( words, gazet_ners );
-    vector<UnicodeString> override_v = create_ner_list( words, override_ners );
-    vector<tc_pair> override_tags;
-    std::transform( override_v.cbegin(), override_v.cend(),
-		    std::back_inserter(override_tags),
-		    []( auto us ){ return make_pair(us,1.0); } );
-    UnicodeString prev = "_";
-    UnicodeString prevN = "_";
-    vector<tag_entry> to_do;
-    for ( size_t i=0; i < swords.size(); ++i ){
-      tag_entry entry;
-      entry.word = words[i];
-      entry.enrichment = prev + "\t" + pos_tags[i];
-      prev = pos_tags[i];
-      if ( i < swords.size() - 1 ){
-	entry.enrichment += "\t" + pos_tags[i+1];
-      }
-      else {
-	entry.enrichment += "\t_";
-      }
-      entry.enrichment += "\t" + prevN + "\t" + gazet_tags[i];
-      prevN = gazet_tags[i];
-      if ( i < swords.size() - 1 ){
-	entry.enrichment += "\t" + gazet_tags[i+1];
+    BaseTagger::Classify( batch );
+  }
+}
+
+void NERTagger::classify_gazets( frog_data& swords ){
+  /// Tag one sentence using only the gazeteers
+  /*!
+    \param swords the frog_data structure to analyze
+   */
+  vector<UnicodeString> words;
+  vector<UnicodeString> pos_tags;
+  sentence_words( swords, words, pos_tags );
+  vector<tc_pair> ner_tags;
+  vector<UnicodeString> gazet_tags = create_ner_list( words, known_ners() );
+  UnicodeString last = "O";
+  cerr << "bekijk gazet tags: " << gazet_tags << endl;
+  for ( const auto& it : gazet_tags ){
+    vector<UnicodeString> parts = TiCC::split_at( it, "+" );
+    UnicodeString tag = parts[0];
+    cerr << "AHA: last = " << last << " Nieuw=" << tag << endl;
+    if ( tag == "O" ){
+      last = tag;
+    }
+    else {
+      if ( tag == last ){
+	tag = "I-" + tag;
       }
       else {
-	entry.enrichment += "\t_";
+	last = tag;
+	tag = "B-" + tag;
       }
-      to_do.push_back( entry );
     }
-    _tag_result = tag_entries( to_do );
-    if ( debug > 1 ){
-      DBG << "NER tagger out: " << endl;
-      for ( size_t i=0; i < _tag_result.size(); ++i ){
-	DBG << "[" << i << "] : word=" << _tag_result[i].word()
-	    << " tag=" << _tag_result[i].assigned_tag()
-	    << " confidence=" << _tag_result[i].confidence() << endl;
-      }
+    cerr << "add a tag: " << tag << endl;
+    ner_tags.push_back( make_pair( tag, 1.0 ) );
+  }
+  post_process( swords, ner_tags );
+}
+
+vector<tag_entry> NERTagger::extract_sentence( const frog_data& swords ){
+  /// create the input for the NER tagger for one sentence
+  /*!
+    \param swords the frog_data structure to analyze
+    \return a list of tag_entry elements, enriched with the POS tags and
+    the gazeteer information
+   */
+  vector<UnicodeString> words;
+  vector<UnicodeString> pos_tags;
+  sentence_words( swords, words, pos_tags );
+  vector<UnicodeString> gazet_tags = create_ner_list( words, known_ners() );
+  UnicodeString prev = "_";
+  UnicodeString prevN = "_";
+  vector<tag_entry> to_do;
+  for ( size_t i=0; i < swords.size(); ++i ){
+    tag_entry entry;
+    entry.word = words[i];
+    entry.enrichment = prev + "\t" + pos_tags[i];
+    prev = pos_tags[i];
+    if ( i < swords.size() - 1 ){
+      entry.enrichment += "\t" + pos_tags[i+1];
+    }
+    else {
+      entry.enrichment += "\t_";
+    }
+    entry.enrichment += "\t" + prevN + "\t" + gazet_tags[i];
+    prevN = gazet_tags[i];
+    if ( i < swords.size() - 1 ){
+      entry.enrichment += "\t" + gazet_tags[i+1];
+    }
+    else {
+      entry.enrichment += "\t_";
     }
-    //
-    // we have to correct for tags that start with 'I-'
-    // (the MBT tagger may deliver those)
-    UnicodeString last;
-    for ( const auto& tag : _tag_result ){
-      UnicodeString assigned = tag.assigned_tag();
-      if ( assigned == "O" ){
-	last = "";
+    to_do.push_back( entry );
+  }
+  return to_do;
+}
+
+void NERTagger::finish_sentence( frog_data& swords ){
+  /// add the tagger results in _tag_result to one sentence
+  /*!
+    \param swords the frog_data structure to extend
+
+    The results are corrected for leading I- tags, and the overrides are
+    merged in.
+   */
+  if ( debug > 1 ){
+    DBG << "NER tagger out: " << endl;
+    for ( size_t i=0; i < _tag_result.size(); ++i ){
+      DBG << "[" << i << "] : word=" << _tag_result[i].word()
+	  << " tag=" << _tag_result[i].assigned_tag()
+	  << " confidence=" << _tag_result[i].confidence() << endl;
+    }
+  }
+  //
+  // we have to correct for tags that start with 'I-'
+  // (the MBT tagger may deliver those)
+  vector<tc_pair> ner_tags;
+  UnicodeString last;
+  for ( const auto& tag : _tag_result ){
+    UnicodeString assigned = tag.assigned_tag();
+    if ( assigned == "O" ){
+      last = "";
+    }
+    else {
+      vector<UnicodeString> parts = TiCC::split_at( assigned, "-" );
+      vector<UnicodeString> vals = TiCC::split_at( parts[1], "+" );
+      UnicodeString val = vals[0];
+      if ( val == last ){
+	assigned = "I-" + val;
       }
       else {
-	vector<UnicodeString> parts = TiCC::split_at( assigned, "-" );
-	vector<UnicodeString> vals = TiCC::split_at( parts[1], "+" );
-	UnicodeString val = vals[0];
-	if ( val == last ){
-	  assigned = "I-" + val;
-	}
-	else {
-	  if ( debug > 1 ){
-	    DBG << "replace " << assigned << " by " << "B-" << val << endl;
-	  }
-	  last = val;
-	  assigned = "B-" + val;
+	if ( debug > 1 ){
+	  DBG << "replace " << assigned << " by " << "B-" << val << endl;
 	}
+	last = val;
+	assigned = "B-" + val;
       }
-      ner_tags.push_back( make_pair( assigned, tag.confidence() ) );
-    }
-    if ( !override_tags.empty() ){
-      vector<UnicodeString> empty;
-      merge_override( ner_tags, override_tags, true, empty );
     }
+    ner_tags.push_back( make_pair( assigned, tag.confidence() ) );
+  }
+  vector<UnicodeString> words;
+  vector<UnicodeString> pos_tags;
+  sentence_words( swords, words, pos_tags );
+  vector<UnicodeString> override_v = create_ner_list( words, known_overrides() );
+  vector<tc_pair> override_tags;
+  std::transform( override_v.cbegin(), override_v.cend(),
+		  std::back_inserter(override_tags),
+		  []( auto us ){ return make_pair(us,1.0); } );
+  if ( !override_tags.empty() ){
+    vector<UnicodeString> empty;
+    merge_override( ner_tags, override_tags, true, empty );
   }
   post_process( swords, ner_tags );
 }
@@ -496,7 +975,7 @@ void NERTagger::addEntity( frog_data& sent,
   for ( size_t i = 0; i < entity.size(); ++i ){
 #pragma omp critical (foliaupdate)
     {
-      sent.units[pos-entity.size()+i].ner_tag = entity[i].first;
+      sent.units[pos-entity.size()+i].ner_tag = symbol( entity[i].first );
       sent.units[pos-entity.size()+i].ner_confidence = c;
     }
   }
@@ -619,7 +1098,11 @@ void NERTagger::merge_override( vector<tc_pair>& tags,
 
 bool NERTagger::Generate( const string& opt_line ){
   /// generate a new tagger using opt_line
-  return tagger->GenerateTagger( opt_line );
+  if ( !tagger ){
+    throw runtime_error( _label + "-tagger is not initialized" );
+  }
+  pooled_tagger mbt( *tagger );
+  return mbt->GenerateTagger( opt_line );
 }
 
 void NERTagger::add_result( const frog_data& fd,
@@ -0,0 +1,449 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include "frog/persistent_cache.h"
+#include "frog/Frog-util.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+#define LOG *TiCC::Log(errLog)
+
+namespace {
+  const char cache_magic[8] = { 'F', 'R', 'O', 'G', 'P', 'C', 'C', '\0' };
+  const uint32_t cache_version = 1;
+  const uint32_t byte_order = 0x01020304;
+
+  /// \brief the start of a cache file
+  struct cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;     ///< to detect files from other architectures
+    uint64_t stamp;          ///< identifies the model and settings used
+  };
+
+  /// \brief the start of every record, followed by the key and the value
+  struct record_header {
+    uint32_t key_len;
+    uint32_t value_len;
+    uint32_t check;          ///< to detect records damaged by a crash
+  };
+
+  uint32_t checksum( const char *key, size_t key_len,
+		     const char *value, size_t value_len ){
+    uint64_t hash = fnv_hash( key, key_len );
+    hash = fnv_hash( value, value_len, hash );
+    return (uint32_t)( hash ^ ( hash >> 32 ) );
+  }
+
+  bool write_all( int fd, const char *data, size_t len ){
+    while ( len > 0 ){
+      ssize_t n = ::write( fd, data, len );
+      if ( n < 0 ){
+	if ( errno == EINTR ){
+	  continue;
+	}
+	return false;
+      }
+      data += n;
+      len -= n;
+    }
+    return true;
+  }
+}
+
+PersistentCache::PersistentCache( TiCC::LogStream *log,
+				  size_t max_added,
+				  size_t max_file_size ):
+  _fd( -1 ),
+  _owner( getpid() ),
+  _stamp( 0 ),
+  _writable( false ),
+  _map( 0 ),
+  _map_size( 0 ),
+  _max_added( max_added ),
+  _max_file_size( max_file_size ),
+  _full( false ),
+  _written( 0 ),
+  errLog( log )
+{
+  /// create a closed cache
+  /*!
+    \param log the LogStream for messages
+    \param max_added the maximum number of records kept in memory that are
+    added after open()
+    \param max_file_size the size in bytes beyond which we stop appending
+  */
+}
+
+PersistentCache::~PersistentCache(){
+  close();
+}
+
+void PersistentCache::close(){
+  /// release the mapping and the file
+  if ( _map ){
+    munmap( const_cast<char*>(_map), _map_size );
+    _map = 0;
+  }
+  _map_size = 0;
+  if ( _fd >= 0 ){
+    ::close( _fd );
+    _fd = -1;
+  }
+  _index.clear();
+  _added.clear();
+  _full = false;
+}
+
+bool PersistentCache::reset( uint64_t stamp, size_t end ){
+  /// replace the file by a new one with only the valid records
+  /*!
+    \param stamp the stamp for the new header
+    \param end the end of the valid records in the current mapping. 0 when
+    there are none
+    \return true on succes
+
+    The new
+    file is written aside and then renamed, so other processes that still
+    have the old one mapped are not disturbed.
+  */
+  string tmp_name = _name + ".tmp" + to_string( getpid() );
+  int fd = ::open( tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+  if ( fd < 0 ){
+    LOG << "unable to create: " << tmp_name << ": "
+	<< strerror( errno ) << endl;
+    return false;
+  }
+  cache_header head;
+  memset( &head, 0, sizeof(head) );
+  memcpy( head.magic, cache_magic, sizeof(cache_magic) );
+  head.version = cache_version;
+  head.byte_order = byte_order;
+  head.stamp = stamp;
+  bool ok = write_all( fd, reinterpret_cast<const char*>(&head), sizeof(head) );
+  if ( ok && _map && end > sizeof(head) ){
+    ok = write_all( fd, _map + sizeof(head), end - sizeof(head) );
+  }
+  ok = ( ::close( fd ) == 0 ) && ok;
+  if ( !ok || rename( tmp_name.c_str(), _name.c_str() ) != 0 ){
+    LOG << "unable to write: " << _name << ": " << strerror( errno ) << endl;
+    unlink( tmp_name.c_str() );
+    return false;
+  }
+  // continue with the new file, and keep it locked
+  fd = ::open( _name.c_str(), O_RDWR | O_APPEND );
+  if ( fd < 0 ){
+    LOG << "unable to reopen: " << _name << ": " << strerror( errno ) << endl;
+    return false;
+  }
+  flock( fd, LOCK_EX );
+  ::close( _fd );
+  _fd = fd;
+  return true;
+}
+
+size_t PersistentCache::scan(){
+  /// map the file and index all valid records
+  /*!
+    \return the offset just behind the last valid record
+  */
+  if ( _map ){
+    munmap( const_cast<char*>(_map), _map_size );
+    _map = 0;
+    _map_size = 0;
+  }
+  _index.clear();
+  struct stat st;
+  if ( fstat( _fd, &st ) != 0
+       || (size_t)st.st_size < sizeof(cache_header) ){
+    return 0;
+  }
+  void *mem = mmap( 0, st.st_size, PROT_READ, MAP_SHARED, _fd, 0 );
+  if ( mem == MAP_FAILED ){
+    LOG << "unable to map: " << _name << ": " << strerror( errno ) << endl;
+    return 0;
+  }
+  _map = static_cast<const char*>(mem);
+  _map_size = st.st_size;
+  size_t pos = sizeof(cache_header);
+  while ( pos + sizeof(record_header) <= _map_size ){
+    record_header rec;
+    memcpy( &rec, _map + pos, sizeof(rec) );
+    size_t len = sizeof(rec) + (size_t)rec.key_len + rec.value_len;
+    if ( len > _map_size - pos ){
+      break;
+    }
+    const char *key = _map + pos + sizeof(rec);
+    if ( checksum( key, rec.key_len,
+		   key + rec.key_len, rec.value_len ) != rec.check ){
+      break;
+    }
+    _index.insert( make_pair( fnv_hash( key, rec.key_len ), pos ) );
+    pos += len;
+  }
+  return pos;
+}
+
+bool PersistentCache::open( const string& file_name, uint64_t stamp ){
+  /// open (or create) a cache file
+  /*!
+    \param file_name the file to use
+    \param stamp the stamp of the current model and settings. A file with
+    another stamp is replaced by an empty one
+    \return true when the cache can be used
+  */
+  close();
+  _name = file_name;
+  _stamp = stamp;
+  _owner = getpid();
+  while ( true ){
+    _writable = true;
+    _fd = ::open( _name.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644 );
+    if ( _fd < 0 ){
+      _writable = false;
+      _fd = ::open( _name.c_str(), O_RDONLY );
+      if ( _fd < 0 ){
+	LOG << "unable to open cache file: " << _name << ": "
+	    << strerror( errno ) << endl;
+	return false;
+      }
+    }
+    flock( _fd, _writable ? LOCK_EX : LOCK_SH );
+    // another process may have replaced the file while we waited
+    struct stat fst;
+    struct stat pst;
+    if ( fstat( _fd, &fst ) == 0
+	 && stat( _name.c_str(), &pst ) == 0
+	 && fst.st_ino == pst.st_ino
+	 && fst.st_dev == pst.st_dev ){
+      break;
+    }
+    ::close( _fd );
+    _fd = -1;
+  }
+  cache_header head;
+  bool valid = pread( _fd, &head, sizeof(head), 0 ) == sizeof(head)
+    && memcmp( head.magic, cache_magic, sizeof(cache_magic) ) == 0
+    && head.version == cache_version
+    && head.byte_order == byte_order;
+  if ( !valid || head.stamp != stamp ){
+    if ( valid ){
+      LOG << "cache file " << _name
+	  << " was made with another model or settings, starting anew" << endl;
+    }
+    if ( !_writable || !reset( stamp, 0 ) ){
+      LOG << "unable to use cache file: " << _name << endl;
+      close();
+      return false;
+    }
+  }
+  size_t end = scan();
+  if ( end < _map_size ){
+    // a record was damaged, probably by a crash while writing it.
+    // keep the records before it
+    LOG << "skipping a damaged record at the end of: " << _name << endl;
+    if ( _writable ){
+      if ( !reset( stamp, end ) ){
+	close();
+	return false;
+      }
+      end = scan();
+    }
+  }
+  flock( _fd, LOCK_UN );
+  return end > 0;
+}
+
+bool PersistentCache::reopen(){
+  /// open the file again, to get a descriptor of our own
+  /*!
+    \return false when that failed
+
+    An flock() belongs to the open file description, which a forked child
+    shares with its parent and siblings. So they wouldn't exclude each other.
+  */
+  int fd = ::open( _name.c_str(), O_RDWR | O_APPEND );
+  if ( fd < 0 ){
+    LOG << "unable to reopen: " << _name << ": " << strerror( errno ) << endl;
+    return false;
+  }
+  ::close( _fd );
+  _fd = fd;
+  _owner = getpid();
+  return true;
+}
+
+bool PersistentCache::follow_file(){
+  /// make sure we hold the current file, after another process replaced it
+  /*!
+    \return false when we shouldn't append anymore
+
+    Called with the file locked. When reset() in another process renamed a
+    new file over ours, appending to our descriptor would be lost in the
+    orphaned file. So we open and lock the new one.
+  */
+  while ( true ){
+    struct stat fst;
+    struct stat pst;
+    if ( fstat( _fd, &fst ) != 0
+	 || stat( _name.c_str(), &pst ) != 0 ){
+      LOG << "cache file " << _name << " is gone" << endl;
+      return false;
+    }
+    if ( fst.st_ino == pst.st_ino
+	 && fst.st_dev == pst.st_dev ){
+      return true;
+    }
+    if ( !reopen() ){
+      return false;
+    }
+    flock( _fd, LOCK_EX );
+    cache_header head;
+    if ( pread( _fd, &head, sizeof(head), 0 ) != sizeof(head)
+	 || head.stamp != _stamp ){
+      LOG << "cache file " << _name
+	  << " was replaced by one for another model or settings" << endl;
+      return false;
+    }
+  }
+}
+
+bool PersistentCache::lookup( const string& key, string& value ) const {
+  /// search a key
+  /*!
+    \param key the key
+    \param value the value found
+    \return true when found
+  */
+  auto range = _index.equal_range( fnv_hash( key.data(), key.size() ) );
+  for ( auto it = range.first; it != range.second; ++it ){
+    record_header rec;
+    memcpy( &rec, _map + it->second, sizeof(rec) );
+    const char *k = _map + it->second + sizeof(rec);
+    if ( rec.key_len == key.size()
+	 && memcmp( k, key.data(), rec.key_len ) == 0 ){
+      value.assign( k + rec.key_len, rec.value_len );
+      return true;
+    }
+  }
+  lock_guard<mutex> guard( _lock );
+  auto it = _added.find( key );
+  if ( it != _added.end() ){
+    value = it->second;
+    return true;
+  }
+  return false;
+}
+
+bool PersistentCache::store( const string& key, const string& value ){
+  /// add a key/value pair, and append it to the file
+  /*!
+    \param key the key
+    \param value the value
+    \return false when appending failed
+  */
+  lock_guard<mutex> guard( _lock );
+  if ( _added.find( key ) != _added.end() ){
+    return true;
+  }
+  if ( _added.size() < _max_added ){
+    _added.insert( make_pair( key, value ) );
+  }
+  else if ( !_full ){
+    LOG << "the cache of " << _name << " is full, new records are only"
+	<< " appended to the file" << endl;
+    _full = true;
+  }
+  if ( !_writable ){
+    return true;
+  }
+  if ( _owner != getpid() ){
+    // we are forked
+    if ( !reopen() ){
+      _writable = false;
+      return false;
+    }
+  }
+  record_header rec;
+  rec.key_len = key.size();
+  rec.value_len = value.size();
+  rec.check = checksum( key.data(), key.size(), value.data(), value.size() );
+  vector<char> buffer( sizeof(rec) + key.size() + value.size() );
+  memcpy( buffer.data(), &rec, sizeof(rec) );
+  memcpy( buffer.data() + sizeof(rec), key.data(), key.size() );
+  memcpy( buffer.data() + sizeof(rec) + key.size(), value.data(), value.size() );
+  flock( _fd, LOCK_EX );
+  if ( !follow_file() ){
+    flock( _fd, LOCK_UN );
+    _writable = false;
+    return false;
+  }
+  struct stat st;
+  if ( fstat( _fd, &st ) == 0
+       && (size_t)st.st_size + buffer.size() > _max_file_size ){
+    flock( _fd, LOCK_UN );
+    LOG << "cache file " << _name << " reached " << _max_file_size
+	<< " bytes, not appending more records" << endl;
+    _writable = false;
+    return true;
+  }
+  bool ok = write_all( _fd, buffer.data(), buffer.size() );
+  flock( _fd, LOCK_UN );
+  if ( !ok ){
+    LOG << "unable to append to: " << _name << ": " << strerror( errno ) << endl;
+    _writable = false;
+  }
+  else {
+    ++_written;
+  }
+  return ok;
+}
+
+size_t PersistentCache::written() const {
+  /// return the number of records this process appended to the file
+  lock_guard<mutex> guard( _lock );
+  return _written;
+}
+
+size_t PersistentCache::size() const {
+  /// return the number of records known
+  lock_guard<mutex> guard( _lock );
+  return _index.size() + _added.size();
+}
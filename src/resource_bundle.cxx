@@ -0,0 +1,307 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include "frog/resource_bundle.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+using icu::UnicodeString;
+
+#define LOG *TiCC::Log(errLog)
+
+namespace {
+  const char bundle_magic[8] = { 'F', 'R', 'O', 'G', 'R', 'E', 'S', '\0' };
+  const uint32_t bundle_version = 1;
+  const uint32_t byte_order = 0x01020304;
+  const size_t max_name = 112;
+
+  /// \brief the start of a bundle file
+  struct bundle_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;     ///< to detect files from other architectures
+    uint64_t sections;
+    uint64_t directory_offset;
+  };
+
+  /// \brief the directory entry of a section
+  struct section_entry {
+    char name[max_name];     ///< 0 terminated
+    uint64_t stamp;
+    uint64_t offset;         ///< from the start of the file, 8 byte aligned
+    uint64_t size;
+  };
+
+  inline uint64_t align( uint64_t offset ){
+    return ( offset + 7 ) & ~uint64_t(7);
+  }
+}
+
+ResourceBundle::ResourceBundle( TiCC::LogStream *log ):
+  _map( 0 ),
+  _map_size( 0 ),
+  _sections( 0 ),
+  _directory( 0 ),
+  errLog( log )
+{
+}
+
+ResourceBundle::~ResourceBundle(){
+  close();
+}
+
+void ResourceBundle::close(){
+  /// unmap the file, if any
+  if ( _map ){
+    munmap( const_cast<char*>(_map), _map_size );
+    _map = 0;
+  }
+  _map_size = 0;
+  _sections = 0;
+  _directory = 0;
+}
+
+bool ResourceBundle::open( const string& file_name ){
+  /// map a resource bundle into memory
+  /*!
+    \param file_name the file to open
+    \return true on succes
+  */
+  close();
+  _name = file_name;
+  int fd = ::open( file_name.c_str(), O_RDONLY );
+  if ( fd < 0 ){
+    LOG << "unable to open resource bundle: " << file_name << ": "
+	<< strerror( errno ) << endl;
+    return false;
+  }
+  struct stat st;
+  if ( fstat( fd, &st ) != 0
+       || (size_t)st.st_size < sizeof(bundle_header) ){
+    LOG << "invalid resource bundle: " << file_name << endl;
+    ::close( fd );
+    return false;
+  }
+  void *mem = mmap( 0, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+  ::close( fd );
+  if ( mem == MAP_FAILED ){
+    LOG << "unable to map resource bundle: " << file_name << ": "
+	<< strerror( errno ) << endl;
+    return false;
+  }
+  _map = static_cast<const char*>(mem);
+  _map_size = st.st_size;
+  bundle_header head;
+  memcpy( &head, _map, sizeof(head) );
+  if ( memcmp( head.magic, bundle_magic, sizeof(bundle_magic) ) != 0
+       || head.version != bundle_version
+       || head.byte_order != byte_order ){
+    LOG << "not a (compatible) resource bundle: " << file_name << endl;
+    close();
+    return false;
+  }
+  if ( head.directory_offset > _map_size
+       || head.sections > ( _map_size - head.directory_offset ) / sizeof(section_entry) ){
+    LOG << "truncated resource bundle: " << file_name << endl;
+    close();
+    return false;
+  }
+  _sections = head.sections;
+  _directory = _map + head.directory_offset;
+  return true;
+}
+
+bool ResourceBundle::find( const string& name,
+			   uint64_t stamp,
+			   const char*& data,
+			   size_t& size ) const {
+  /// find a section in the bundle
+  /*!
+    \param name the name of the section
+    \param stamp the stamp of the current source files and settings
+    \param data set to the start of the section data
+    \param size set to the size of the section data
+    \return true when the section is found, with the right stamp
+  */
+  for ( size_t i=0; i < _sections; ++i ){
+    section_entry entry;
+    memcpy( &entry, _directory + i * sizeof(entry), sizeof(entry) );
+    entry.name[max_name-1] = '\0';
+    if ( name != entry.name ){
+      continue;
+    }
+    if ( entry.stamp != stamp ){
+      LOG << "section '" << name << "' of resource bundle " << _name
+	  << " is out of date. It is not used." << endl;
+      return false;
+    }
+    if ( entry.offset > _map_size
+	 || entry.size > _map_size - entry.offset ){
+      LOG << "section '" << name << "' of resource bundle " << _name
+	  << " is truncated. It is not used." << endl;
+      return false;
+    }
+    data = _map + entry.offset;
+    size = entry.size;
+    return true;
+  }
+  return false;
+}
+
+bool ResourceBundle::write( const string& file_name,
+			    const vector<section>& sections ){
+  /// write a resource bundle
+  /*!
+    \param file_name the file to create
+    \param sections the sections to store
+    \return true on succes
+
+    The file is written aside and then renamed, so running Frogs that have
+    the old one mapped are not disturbed.
+  */
+  bundle_header head;
+  memset( &head, 0, sizeof(head) );
+  memcpy( head.magic, bundle_magic, sizeof(bundle_magic) );
+  head.version = bundle_version;
+  head.byte_order = byte_order;
+  head.sections = sections.size();
+  head.directory_offset = align( sizeof(head) );
+  vector<section_entry> directory;
+  uint64_t pos = head.directory_offset + sections.size() * sizeof(section_entry);
+  for ( const auto& sec : sections ){
+    if ( sec.name.size() >= max_name ){
+      return false;
+    }
+    section_entry entry;
+    memset( &entry, 0, sizeof(entry) );
+    memcpy( entry.name, sec.name.data(), sec.name.size() );
+    entry.stamp = sec.stamp;
+    entry.offset = align( pos );
+    entry.size = sec.data.size();
+    pos = entry.offset + entry.size;
+    directory.push_back( entry );
+  }
+  string tmp_name = file_name + ".tmp" + to_string( getpid() );
+  {
+    ofstream os( tmp_name, ios::binary );
+    if ( !os ){
+      return false;
+    }
+    const char zeros[8] = { 0 };
+    os.write( reinterpret_cast<const char*>(&head), sizeof(head) );
+    os.write( zeros, head.directory_offset - sizeof(head) );
+    os.write( reinterpret_cast<const char*>(directory.data()),
+	      directory.size() * sizeof(section_entry) );
+    pos = head.directory_offset + directory.size() * sizeof(section_entry);
+    for ( size_t i=0; i < sections.size(); ++i ){
+      os.write( zeros, directory[i].offset - pos );
+      os.write( sections[i].data.data(), sections[i].data.size() );
+      pos = directory[i].offset + directory[i].size;
+    }
+    if ( !os.good() ){
+      os.close();
+      unlink( tmp_name.c_str() );
+      return false;
+    }
+  }
+  if ( rename( tmp_name.c_str(), file_name.c_str() ) != 0 ){
+    unlink( tmp_name.c_str() );
+    return false;
+  }
+  return true;
+}
+
+string ResourceBundle::encode_lines( const vector<UnicodeString>& lines ){
+  /// store a list of lines in a section
+  /*!
+    \param lines the lines
+    \return the section data: the number of lines, the start of every line
+    (and the end of the last) in code units, followed by the UTF-16 code units
+    of all lines
+  */
+  vector<uint64_t> index;
+  index.push_back( lines.size() );
+  uint64_t units = 0;
+  for ( const auto& line : lines ){
+    index.push_back( units );
+    units += line.length();
+  }
+  index.push_back( units );
+  string result( reinterpret_cast<const char*>(index.data()),
+		 index.size() * sizeof(uint64_t) );
+  for ( const auto& line : lines ){
+    result.append( reinterpret_cast<const char*>(line.getBuffer()),
+		   line.length() * sizeof(UChar) );
+  }
+  return result;
+}
+
+bool ResourceBundle::decode_lines( const char *data,
+				   size_t size,
+				   vector<UnicodeString>& lines ){
+  /// read a list of lines from a section made by encode_lines()
+  /*!
+    \param data the section data
+    \param size the size of the data
+    \param lines the list to fill
+    \return false when the data is corrupt
+  */
+  lines.clear();
+  if ( size < sizeof(uint64_t) ){
+    return false;
+  }
+  const uint64_t *index = reinterpret_cast<const uint64_t*>( data );
+  uint64_t count = index[0];
+  if ( size / sizeof(uint64_t) < 2
+       || count > size / sizeof(uint64_t) - 2 ){
+    return false;
+  }
+  size_t pool_offset = ( count + 2 ) * sizeof(uint64_t);
+  const UChar *pool = reinterpret_cast<const UChar*>( data + pool_offset );
+  size_t pool_units = ( size - pool_offset ) / sizeof(UChar);
+  lines.reserve( count );
+  for ( size_t i=1; i <= count; ++i ){
+    if ( index[i] > index[i+1] || index[i+1] > pool_units ){
+      lines.clear();
+      return false;
+    }
+    lines.push_back( UnicodeString( pool + index[i],
+				    (int32_t)( index[i+1] - index[i] ) ) );
+  }
+  return true;
+}
@@ -0,0 +1,249 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include "frog/server_pool.h"
+
+#include <unistd.h>
+#include <stdexcept>
+
+using namespace std;
+using namespace nlohmann;
+
+#define LOG *TiCC::Log(log)
+
+ServerPool::ServerPool():
+  owner( getpid() )
+{
+}
+
+ServerPool::~ServerPool(){
+  for ( const auto& [key,conns] : idle ){
+    for ( const auto& c : conns ){
+      delete c;
+    }
+  }
+}
+
+ServerPool& ServerPool::instance(){
+  /// return the one and only pool
+  static ServerPool the_pool;
+  return the_pool;
+}
+
+Sockets::ClientSocket *ServerPool::acquire( const string& key ){
+  /// take an idle connection for \e key out of the pool
+  /*!
+    \param key the host:port/base combination
+    \return a connection, or 0 when none is available
+  */
+  lock_guard<mutex> guard( pool_lock );
+  if ( owner != getpid() ){
+    // we are a forked child. The connections are the parent's, so we
+    // only close our copies of them
+    for ( const auto& [k,conns] : idle ){
+      for ( const auto& c : conns ){
+	delete c;
+      }
+    }
+    idle.clear();
+    owner = getpid();
+  }
+  auto it = idle.find( key );
+  if ( it == idle.end() || it->second.empty() ){
+    return 0;
+  }
+  Sockets::ClientSocket *result = it->second.back();
+  it->second.pop_back();
+  return result;
+}
+
+void ServerPool::release( const string& key,
+			  Sockets::ClientSocket *client ){
+  /// give a (still healthy) connection back to the pool
+  lock_guard<mutex> guard( pool_lock );
+  idle[key].push_back( client );
+}
+
+void ServerPool::discard( const string& key ){
+  /// close all idle connections for \e key, presumably the server restarted
+  lock_guard<mutex> guard( pool_lock );
+  auto it = idle.find( key );
+  if ( it != idle.end() ){
+    for ( const auto& c : it->second ){
+      delete c;
+    }
+    it->second.clear();
+  }
+}
+
+static json read_json( Sockets::ClientSocket& client,
+		       const string& what ){
+  string line;
+  if ( !client.read( line ) ){
+    throw runtime_error( "reading " + what + " failed: "
+			 + client.getMessage() );
+  }
+  try {
+    return json::parse( line );
+  }
+  catch ( const exception& e ){
+    throw runtime_error( "json parsing failed on '" + line + "':"
+			 + e.what() );
+  }
+}
+
+Sockets::ClientSocket *ServerPool::open_connection( const string& host,
+						    const string& port,
+						    const string& base,
+						    TiCC::LogStream *log ) const {
+  /// open a new connection, and handle the greeting and base selection
+  /*!
+    \param host the server host
+    \param port the server port
+    \param base the base to select. May be empty
+    \param log a LogStream for messages
+    \return a connection, ready to receive queries
+
+    This will throw when anything goes wrong
+  */
+  Sockets::ClientSocket *client = new Sockets::ClientSocket();
+  try {
+    if ( !client->connect( host, port ) ){
+      throw runtime_error( "failed to open connection, " + host + ":" + port
+			   + " Reason: " + client->getMessage() );
+    }
+    json greeting = read_json( *client, "greeting" );
+    if ( greeting.value( "status", "ok" ) != "ok" ){
+      throw runtime_error( "server " + host + ":" + port + " isn't OK" );
+    }
+    if ( !base.empty() ){
+      json out_json;
+      out_json["command"] = "base";
+      out_json["param"] = base;
+      if ( !client->write( out_json.dump() + "\n" ) ){
+	throw runtime_error( "selecting base " + base + " failed: "
+			     + client->getMessage() );
+      }
+      json response = read_json( *client, "base response" );
+      if ( response.value( "status", "ok" ) != "ok" ){
+	throw runtime_error( "server " + host + ":" + port
+			     + " refused base " + base );
+      }
+    }
+  }
+  catch ( ... ){
+    delete client;
+    throw;
+  }
+  LOG << "opened connection to " << host << ":" << port;
+  if ( !base.empty() ){
+    LOG << " base=" << base;
+  }
+  LOG << endl;
+  return client;
+}
+
+json ServerPool::query( const string& host,
+			const string& port,
+			const string& base,
+			const json& request,
+			TiCC::LogStream *log ){
+  /// send 1 JSON request to a server and return the JSON response
+  /*!
+    \param host the server host
+    \param port the server port
+    \param base the base to select. May be empty
+    \param request the JSON to send
+    \param log a LogStream for messages
+    \return the JSON response of the server
+
+    A pooled connection is used when available. When it turns out to be
+    closed, all pooled connections for this server are dropped and a fresh
+    one is opened. This will throw when a fresh connection fails too.
+  */
+  const string key = host + ":" + port + "/" + base;
+  const string out_line = request.dump() + "\n";
+  while ( true ){
+    bool fresh = false;
+    Sockets::ClientSocket *client = acquire( key );
+    if ( !client ){
+      client = open_connection( host, port, base, log );
+      fresh = true;
+    }
+    string in_line;
+    if ( client->write( out_line )
+	 && client->read( in_line ) ){
+      json response;
+      try {
+	response = json::parse( in_line );
+      }
+      catch ( const exception& e ){
+	delete client;
+	throw runtime_error( "json parsing failed on '" + in_line + "':"
+			     + e.what() );
+      }
+      release( key, client );
+      return response;
+    }
+    string mess = client->getMessage();
+    delete client;
+    if ( fresh ){
+      throw runtime_error( "lost connection to " + key + ": " + mess );
+    }
+    LOG << "pooled connection to " << key << " failed, reconnecting" << endl;
+    discard( key );
+  }
+}
+
+future<json> ServerPool::submit( const string& host,
+				 const string& port,
+				 const string& base,
+				 const json& request,
+				 TiCC::LogStream *log ){
+  /// start a query in the background
+  /*!
+    \param host the server host
+    \param port the server port
+    \param base the base to select. May be empty
+    \param request the JSON to send
+    \param log a LogStream for messages
+    \return a future that holds the JSON response of the server, or the
+    exception query() threw
+
+    This returns immediately, so a caller can have requests to several
+    servers (or bases) in flight at the same time and collect the answers
+    afterwards. Every request in flight uses its own connection.
+  */
+  return async( launch::async,
+		[this,host,port,base,request,log](){
+		  return query( host, port, base, request, log );
+		} );
+}
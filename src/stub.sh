@@ -0,0 +1,26 @@
+#! /bin/sh
+# run the remote tagger and parser of Frog against frog-stub-server.
+# the tags come from canned answers, the parser bases know nothing.
+
+port=${STUB_PORT:-18923}
+./frog-stub-server -p $port --default __ \
+    --canned tagger=$srcdir/../tests/stub_tagger.txt \
+    --canned pairs=/dev/null --canned dirs=/dev/null \
+    --canned rels=/dev/null 2> stub.log &
+stub=$!
+sleep 1
+./frog --skip=lacn -t $srcdir/../tests/stub.txt -o stub.out \
+    --override=tagger.host=localhost --override=tagger.port=$port \
+    --override=tagger.base=tagger \
+    --override=parser.host=localhost --override=parser.port=$port \
+    --override=parser.pairs_base=pairs --override=parser.dirs_base=dirs \
+    --override=parser.rels_base=rels
+status=$?
+kill $stub
+if [ $status -ne 0 ]; then
+    exit $status
+fi
+# index, word, tag and confidence
+cut -f1,2,6,7 stub.out | diff -w -B - $srcdir/../tests/stub.ok || exit 1
+# every word must be attached by the parser
+awk -F'\t' 'NF > 0 && $12 !~ /^[0-9]+$/ { exit 1 }' stub.out
@@ -0,0 +1,438 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <random>
+#include <chrono>
+
+#include "config.h"
+#include "ticcutils/CommandLine.h"
+#include "ticcutils/StringOps.h"
+#include "ticcutils/Unicode.h"
+#include "ticcutils/SocketBasics.h"
+#include "ticcutils/json.hpp"
+#include "timbl/TimblAPI.h"
+
+using namespace std;
+using namespace nlohmann;
+
+/// \brief the answers the stand-in server gives for one base
+struct stub_base {
+  stub_base(): timbl(0) {};
+  std::map<std::string,std::string> canned; ///< instance (or word) to class
+  Timbl::TimblAPI *timbl;   ///< an optional local Timbl for the rest
+  std::mutex timbl_lock;    ///< a Timbl may classify 1 instance at a time
+};
+
+static map<string,stub_base*> bases;
+static string default_class = "?";
+static int latency = 0;  // milliseconds
+static int jitter = 0;   // milliseconds
+static int debug = 0;
+
+void usage( ) {
+  cout << endl << "frog-stub-server [options] -p <port>" << endl
+       << "A stand-in for a Timbl or MBT server, speaking the same JSON "
+       << "protocol." << endl
+       << "Use it to benchmark and test the remote modes of Frog on 1 machine."
+       << endl << "Options:" << endl;
+  cout << "\t -p <port>    listen on this port (mandatory)\n"
+       << "\t --canned <base>=<file>   answer queries for 'base' from 'file'.\n"
+       << "\t\t Every line holds an instance (or a word), a TAB and the class\n"
+       << "\t\t (or tag). May be repeated\n"
+       << "\t --timbl \"<base>=<instancebase> <timbl options>\"   answer "
+       << "queries for\n"
+       << "\t\t 'base' using a local Timbl. Canned answers take precedence.\n"
+       << "\t\t May be repeated\n"
+       << "\t --default <class>   the class (or tag) for unknown instances. "
+       << "(default '?')\n"
+       << "\t --latency <ms>   delay every reply 'ms' milliseconds\n"
+       << "\t --jitter <ms>    add a random delay of 0 to 'ms' milliseconds "
+       << "to every reply\n"
+       << "\t -h. give some help.\n"
+       << "\t -V or --version .   Show version info.\n"
+       << "\t -d <debug level>    (for more verbosity)\n";
+}
+
+bool split_spec( const string& spec, string& name, string& value ){
+  /// split a 'name=value' option value
+  /*!
+    \param spec the value to split
+    \param name the part before the '='
+    \param value the part after the '='
+    \return true when both parts are non-empty
+  */
+  string::size_type pos = spec.find( "=" );
+  if ( pos == string::npos || pos == 0 ){
+    return false;
+  }
+  name = spec.substr( 0, pos );
+  value = TiCC::trim( spec.substr( pos+1 ) );
+  return !value.empty();
+}
+
+stub_base *get_base( const string& name ){
+  /// find the base with this name, or create it
+  auto it = bases.find( name );
+  if ( it != bases.end() ){
+    return it->second;
+  }
+  stub_base *result = new stub_base();
+  bases[name] = result;
+  return result;
+}
+
+bool read_canned( const string& spec ){
+  /// fill a base with canned answers
+  /*!
+    \param spec the --canned option value: base=file
+    \return true on succes
+  */
+  string name;
+  string file_name;
+  if ( !split_spec( spec, name, file_name ) ){
+    cerr << "invalid --canned value: '" << spec << "'" << endl;
+    return false;
+  }
+  ifstream is( file_name );
+  if ( !is ){
+    cerr << "unable to open canned answers: " << file_name << endl;
+    return false;
+  }
+  stub_base *base = get_base( name );
+  string line;
+  size_t count = 0;
+  while ( getline( is, line ) ){
+    string::size_type pos = line.rfind( "\t" );
+    if ( pos == string::npos ){
+      continue;
+    }
+    base->canned[line.substr( 0, pos )] = TiCC::trim( line.substr( pos+1 ) );
+    ++count;
+  }
+  cerr << "base '" << name << "': read " << count << " answers from "
+       << file_name << endl;
+  return true;
+}
+
+bool load_timbl( const string& spec ){
+  /// attach a local Timbl to a base
+  /*!
+    \param spec the --timbl option value: base=instancebase options
+    \return true on succes
+  */
+  string name;
+  string value;
+  if ( !split_spec( spec, name, value ) ){
+    cerr << "invalid --timbl value: '" << spec << "'" << endl;
+    return false;
+  }
+  string ibase = value;
+  string opts;
+  string::size_type pos = value.find( " " );
+  if ( pos != string::npos ){
+    ibase = value.substr( 0, pos );
+    opts = value.substr( pos+1 );
+  }
+  stub_base *base = get_base( name );
+  if ( base->timbl ){
+    cerr << "base '" << name << "' has a Timbl already" << endl;
+    return false;
+  }
+  base->timbl = new Timbl::TimblAPI( opts );
+  if ( !base->timbl->Valid()
+       || !base->timbl->GetInstanceBase( ibase ) ){
+    cerr << "unable to read instance base: " << ibase << endl;
+    return false;
+  }
+  cerr << "base '" << name << "': using Timbl on " << ibase << endl;
+  return true;
+}
+
+void delay(){
+  /// simulate the network and classifier latency of a real server
+  int ms = latency;
+  if ( jitter > 0 ){
+    static thread_local mt19937 gen( random_device{}() );
+    uniform_int_distribution<int> dis( 0, jitter );
+    ms += dis( gen );
+  }
+  if ( ms > 0 ){
+    this_thread::sleep_for( chrono::milliseconds( ms ) );
+  }
+}
+
+json classify( stub_base *base, const string& instance ){
+  /// answer 1 instance, like a Timbl server would
+  /*!
+    \param base the base to use. May be 0
+    \param instance the instance to classify
+    \return a JSON object with the category, confidence and distribution
+  */
+  string category = default_class;
+  double confidence = 0.0;
+  string distribution;
+  if ( base ){
+    auto it = base->canned.find( instance );
+    if ( it != base->canned.end() ){
+      category = it->second;
+      confidence = 1.0;
+    }
+    else if ( base->timbl ){
+      lock_guard<mutex> guard( base->timbl_lock );
+      const Timbl::ClassDistribution *db;
+      const Timbl::TargetValue *tv
+	= base->timbl->Classify( TiCC::UnicodeFromUTF8(instance), db );
+      if ( tv ){
+	category = TiCC::UnicodeToUTF8( tv->name() );
+	confidence = db->Confidence( tv );
+	distribution = db->DistToString();
+      }
+    }
+  }
+  if ( distribution.empty() ){
+    distribution = "{ " + category + " 1 }";
+  }
+  json result;
+  result["category"] = category;
+  result["confidence"] = confidence;
+  result["distribution"] = distribution;
+  return result;
+}
+
+json tag( stub_base *base, const json& sentence ){
+  /// answer a 'tag' command, like a MBT server would
+  /*!
+    \param base the base to use. May be 0
+    \param sentence the JSON array of words, with optional enrichments
+    \return a JSON array with a tag for every word
+  */
+  json result = json::array();
+  for ( const auto& entry : sentence ){
+    string word = entry.value( "word", "" );
+    string tag = default_class;
+    bool known = false;
+    if ( base ){
+      auto it = base->canned.find( word );
+      if ( it != base->canned.end() ){
+	tag = it->second;
+	known = true;
+      }
+    }
+    json one;
+    one["word"] = word;
+    one["tag"] = tag;
+    one["known"] = known ? "true" : "false";
+    one["confidence"] = known ? 1.0 : 0.0;
+    if ( entry.find( "enrichment" ) != entry.end() ){
+      one["enrichment"] = entry["enrichment"];
+    }
+    result.push_back( one );
+  }
+  return result;
+}
+
+json handle( const json& request, stub_base*& base ){
+  /// handle 1 request on a connection
+  /*!
+    \param request the JSON request
+    \param base the currently selected base. Changed by a 'base' command
+    \return the JSON reply
+  */
+  json reply;
+  string command = request.value( "command", "" );
+  if ( command == "base" ){
+    string name = request.value( "param", "" );
+    auto it = bases.find( name );
+    if ( it == bases.end() ){
+      reply["status"] = "error";
+      reply["message"] = "unknown base: " + name;
+    }
+    else {
+      base = it->second;
+      reply["status"] = "ok";
+    }
+  }
+  else if ( command == "classify" ){
+    delay();
+    if ( request.find( "params" ) != request.end() ){
+      reply = json::array();
+      for ( const auto& inst : request["params"] ){
+	reply.push_back( classify( base, inst.get<string>() ) );
+      }
+    }
+    else {
+      reply = classify( base, request.value( "param", "" ) );
+    }
+  }
+  else if ( command == "tag" ){
+    delay();
+    reply = tag( base, request.value( "sentence", json::array() ) );
+  }
+  else {
+    reply["status"] = "error";
+    reply["message"] = "unknown command: '" + command + "'";
+  }
+  return reply;
+}
+
+void serve( Sockets::ClientSocket *conn ){
+  /// handle all requests on 1 connection, until the client closes it
+  /*!
+    \param conn the connection. We take ownership
+  */
+  json greeting;
+  greeting["status"] = "ok";
+  stub_base *base = 0;
+  if ( bases.size() == 1 ){
+    // like a Timbl server with 1 experiment: no need to select it
+    base = bases.begin()->second;
+  }
+  size_t served = 0;
+  if ( conn->write( greeting.dump() + "\n" ) ){
+    string line;
+    while ( conn->read( line ) ){
+      line = TiCC::trim( line );
+      if ( line.empty() ){
+	continue;
+      }
+      json reply;
+      try {
+	reply = handle( json::parse( line ), base );
+      }
+      catch ( const exception& e ){
+	reply = json::object();
+	reply["status"] = "error";
+	reply["message"] = string("invalid request: ") + e.what();
+      }
+      if ( !conn->write( reply.dump() + "\n" ) ){
+	break;
+      }
+      ++served;
+    }
+  }
+  if ( debug ){
+    cerr << "connection " << conn->getSockId() << " closed after "
+	 << served << " requests" << endl;
+  }
+  delete conn;
+}
+
+int main( int argc, char *argv[] ) {
+  cerr << "frog-stub-server " << VERSION << " (c) CLST, ILK 2024." << endl;
+  TiCC::CL_Options Opts( "hVd:p:",
+			 "version,canned:,timbl:,default:,latency:,jitter:" );
+  try {
+    Opts.init( argc, argv );
+  }
+  catch ( const exception& e ){
+    cerr << "fatal error: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+  if ( Opts.is_present( 'V' ) || Opts.is_present( "version" ) ){
+    return EXIT_SUCCESS;
+  }
+  if ( Opts.is_present( 'h' ) ){
+    usage();
+    return EXIT_SUCCESS;
+  }
+  string port;
+  if ( !Opts.extract( 'p', port ) ){
+    cerr << "missing -p <port> option" << endl;
+    usage();
+    return EXIT_FAILURE;
+  }
+  string value;
+  if ( Opts.extract( 'd', value )
+       && !TiCC::stringTo<int>( value, debug ) ){
+    cerr << "-d value should be an integer" << endl;
+    return EXIT_FAILURE;
+  }
+  if ( Opts.extract( "latency", value )
+       && ( !TiCC::stringTo<int>( value, latency ) || latency < 0 ) ){
+    cerr << "--latency value should be a positive integer" << endl;
+    return EXIT_FAILURE;
+  }
+  if ( Opts.extract( "jitter", value )
+       && ( !TiCC::stringTo<int>( value, jitter ) || jitter < 0 ) ){
+    cerr << "--jitter value should be a positive integer" << endl;
+    return EXIT_FAILURE;
+  }
+  Opts.extract( "default", default_class );
+  while ( Opts.extract( "canned", value ) ){
+    if ( !read_canned( value ) ){
+      return EXIT_FAILURE;
+    }
+  }
+  while ( Opts.extract( "timbl", value ) ){
+    if ( !load_timbl( value ) ){
+      return EXIT_FAILURE;
+    }
+  }
+  if ( !Opts.empty() ){
+    cerr << "unsupported option(s): " << Opts.toString() << endl;
+    return EXIT_FAILURE;
+  }
+  signal( SIGPIPE, SIG_IGN );
+  Sockets::ServerSocket server;
+  if ( !server.connect( port ) ){
+    cerr << "failed starting server: " << server.getMessage() << endl;
+    return EXIT_FAILURE;
+  }
+  if ( !server.listen( 64 ) ) {
+    cerr << "server: listen failed " << strerror( errno ) << endl;
+    return EXIT_FAILURE;
+  }
+  cerr << "listening on port " << port << ", latency " << latency
+       << "ms, jitter " << jitter << "ms" << endl;
+  while ( true ){
+    Sockets::ClientSocket *conn = new Sockets::ClientSocket();
+    if ( server.accept( *conn ) ){
+      if ( debug ){
+	cerr << "new connection, socketid=" << conn->getSockId() << endl;
+      }
+      thread( serve, conn ).detach();
+    }
+    else {
+      cerr << "accept failed: " << server.getMessage() << endl;
+      delete conn;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,324 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include "frog/suffix_table.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include "unicode/ustring.h"
+#include "ticcutils/Unicode.h"
+
+using namespace std;
+using icu::UnicodeString;
+
+#define LOG *TiCC::Log(errLog)
+
+namespace {
+  const char table_magic[8] = { 'F', 'R', 'O', 'G', 'S', 'F', 'X', '\0' };
+  const uint32_t table_version = 1;
+  const uint32_t byte_order = 0x01020304;
+
+  /// \brief the layout of the start of a suffix table file
+  struct table_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;     ///< to detect files from other architectures
+    uint64_t stamp;          ///< identifies the classifier it was made from
+    uint64_t history;
+    uint64_t entries;
+    uint64_t classes;
+    uint64_t keys_offset;
+    uint64_t class_of_offset;
+    uint64_t class_index_offset;
+    uint64_t pool_offset;
+    uint64_t pool_size;
+  };
+
+  inline uint64_t align( uint64_t offset ){
+    return ( offset + 7 ) & ~uint64_t(7);
+  }
+}
+
+SuffixTable::SuffixTable( TiCC::LogStream *log ):
+  _map( 0 ),
+  _map_size( 0 ),
+  _keys( 0 ),
+  _class_of( 0 ),
+  _entries( 0 ),
+  _history( 0 ),
+  errLog( log )
+{
+}
+
+SuffixTable::~SuffixTable(){
+  close();
+}
+
+void SuffixTable::close(){
+  /// unmap the file, if any
+  if ( _map ){
+    munmap( const_cast<char*>(_map), _map_size );
+    _map = 0;
+  }
+  _map_size = 0;
+  _keys = 0;
+  _class_of = 0;
+  _entries = 0;
+  _classes.clear();
+}
+
+UnicodeString SuffixTable::make_key( const UnicodeString& word,
+				     size_t history ){
+  /// create the key for a word: the last 'history' characters, padded
+  /*!
+    \param word the word
+    \param history the number of characters the classifier looks at
+    \return a key of exactly 'history' code units. Padding uses '=', just as
+    Mblem::make_instance() does.
+  */
+  size_t length = word.length();
+  if ( length >= history ){
+    return UnicodeString( word, length - history );
+  }
+  UnicodeString key( (int32_t)history, (UChar32)'=', (int32_t)(history - length) );
+  key += word;
+  return key;
+}
+
+bool SuffixTable::open( const string& file_name, uint64_t stamp ){
+  /// map a suffix table file into memory
+  /*!
+    \param file_name the file to open
+    \param stamp the stamp the file should have. Otherwise it is compiled
+    from another instancebase or server, or with other settings
+    \return true on succes
+  */
+  close();
+  int fd = ::open( file_name.c_str(), O_RDONLY );
+  if ( fd < 0 ){
+    LOG << "unable to open suffix table: " << file_name << ": "
+	<< strerror( errno ) << endl;
+    return false;
+  }
+  struct stat st;
+  if ( fstat( fd, &st ) != 0
+       || (size_t)st.st_size < sizeof(table_header) ){
+    LOG << "invalid suffix table: " << file_name << endl;
+    ::close( fd );
+    return false;
+  }
+  void *mem = mmap( 0, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+  ::close( fd );
+  if ( mem == MAP_FAILED ){
+    LOG << "unable to map suffix table: " << file_name << ": "
+	<< strerror( errno ) << endl;
+    return false;
+  }
+  _map = static_cast<const char*>(mem);
+  _map_size = st.st_size;
+  table_header head;
+  memcpy( &head, _map, sizeof(head) );
+  if ( memcmp( head.magic, table_magic, sizeof(table_magic) ) != 0
+       || head.version != table_version
+       || head.byte_order != byte_order ){
+    LOG << "not a (compatible) suffix table: " << file_name << endl;
+    close();
+    return false;
+  }
+  if ( head.stamp != stamp ){
+    LOG << "suffix table " << file_name
+	<< " is not compiled from the current instancebase" << endl;
+    close();
+    return false;
+  }
+  if ( head.history == 0
+       || head.keys_offset + head.entries * head.history * sizeof(UChar) > _map_size
+       || head.class_of_offset + head.entries * sizeof(uint32_t) > _map_size
+       || head.class_index_offset + (head.classes+1) * sizeof(uint64_t) > _map_size
+       || head.pool_offset + head.pool_size > _map_size ){
+    LOG << "truncated suffix table: " << file_name << endl;
+    close();
+    return false;
+  }
+  _history = head.history;
+  _entries = head.entries;
+  _keys = reinterpret_cast<const UChar*>( _map + head.keys_offset );
+  _class_of = reinterpret_cast<const uint32_t*>( _map + head.class_of_offset );
+  const uint64_t *index
+    = reinterpret_cast<const uint64_t*>( _map + head.class_index_offset );
+  const char *pool = _map + head.pool_offset;
+  // the classes are few, and needed as UnicodeString, so convert them once
+  _classes.reserve( head.classes );
+  for ( size_t i=0; i < head.classes; ++i ){
+    if ( index[i] > index[i+1] || index[i+1] > head.pool_size ){
+      LOG << "corrupt class list in suffix table: " << file_name << endl;
+      close();
+      return false;
+    }
+    _classes.push_back( UnicodeString::fromUTF8( icu::StringPiece( pool + index[i],
+								    index[i+1] - index[i] ) ) );
+  }
+  for ( size_t i=0; i < _entries; ++i ){
+    if ( _class_of[i] >= _classes.size() ){
+      LOG << "corrupt class index in suffix table: " << file_name << endl;
+      close();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SuffixTable::lookup( const UnicodeString& key,
+			  UnicodeString& result ) const {
+  /// search the class for a key
+  /*!
+    \param key a key as created by make_key()
+    \param result the class found
+    \return true when the key is in the table
+  */
+  if ( !_map || (size_t)key.length() != _history ){
+    return false;
+  }
+  const UChar *k = key.getBuffer();
+  size_t low = 0;
+  size_t high = _entries;
+  while ( low < high ){
+    size_t mid = low + ( high - low ) / 2;
+    int cmp = u_memcmp( _keys + mid * _history, k, _history );
+    if ( cmp == 0 ){
+      result = _classes[_class_of[mid]];
+      return true;
+    }
+    if ( cmp < 0 ){
+      low = mid + 1;
+    }
+    else {
+      high = mid;
+    }
+  }
+  return false;
+}
+
+bool SuffixTable::write( const string& file_name,
+			 size_t history,
+			 const map<UnicodeString,UnicodeString>& table,
+			 uint64_t stamp ){
+  /// write a suffix table file
+  /*!
+    \param file_name the file to create
+    \param history the width of the keys
+    \param table the keys (as created by make_key()) with their class. A
+    std::map is sorted on code units, which is the order lookup() expects.
+    \param stamp the stamp of the instancebase used
+    \return true on succes
+
+    The file is written aside and then renamed, so running Frogs that have
+    the old one mapped are not disturbed.
+  */
+  map<UnicodeString,uint32_t> class_ids;
+  vector<UnicodeString> classes;
+  vector<uint32_t> class_of;
+  class_of.reserve( table.size() );
+  for ( const auto& [key,cls] : table ){
+    if ( (size_t)key.length() != history ){
+      return false;
+    }
+    auto it = class_ids.find( cls );
+    if ( it == class_ids.end() ){
+      it = class_ids.insert( make_pair( cls, (uint32_t)classes.size() ) ).first;
+      classes.push_back( cls );
+    }
+    class_of.push_back( it->second );
+  }
+  string pool;
+  vector<uint64_t> index;
+  for ( const auto& cls : classes ){
+    index.push_back( pool.size() );
+    pool += TiCC::UnicodeToUTF8( cls );
+  }
+  index.push_back( pool.size() );
+
+  table_header head;
+  memset( &head, 0, sizeof(head) );
+  memcpy( head.magic, table_magic, sizeof(table_magic) );
+  head.version = table_version;
+  head.byte_order = byte_order;
+  head.stamp = stamp;
+  head.history = history;
+  head.entries = table.size();
+  head.classes = classes.size();
+  head.keys_offset = align( sizeof(head) );
+  head.class_of_offset = align( head.keys_offset
+				+ head.entries * history * sizeof(UChar) );
+  head.class_index_offset = align( head.class_of_offset
+				   + head.entries * sizeof(uint32_t) );
+  head.pool_offset = head.class_index_offset + index.size() * sizeof(uint64_t);
+  head.pool_size = pool.size();
+
+  string tmp_name = file_name + ".tmp" + to_string( getpid() );
+  {
+    ofstream os( tmp_name, ios::binary );
+    if ( !os ){
+      return false;
+    }
+    const char zeros[8] = { 0 };
+    os.write( reinterpret_cast<const char*>(&head), sizeof(head) );
+    os.write( zeros, head.keys_offset - sizeof(head) );
+    for ( const auto& it : table ){
+      os.write( reinterpret_cast<const char*>(it.first.getBuffer()),
+		history * sizeof(UChar) );
+    }
+    uint64_t pos = head.keys_offset + head.entries * history * sizeof(UChar);
+    os.write( zeros, head.class_of_offset - pos );
+    os.write( reinterpret_cast<const char*>(class_of.data()),
+	      class_of.size() * sizeof(uint32_t) );
+    pos = head.class_of_offset + head.entries * sizeof(uint32_t);
+    os.write( zeros, head.class_index_offset - pos );
+    os.write( reinterpret_cast<const char*>(index.data()),
+	      index.size() * sizeof(uint64_t) );
+    os.write( pool.data(), pool.size() );
+    if ( !os.good() ){
+      os.close();
+      unlink( tmp_name.c_str() );
+      return false;
+    }
+  }
+  if ( rename( tmp_name.c_str(), file_name.c_str() ) != 0 ){
+    unlink( tmp_name.c_str() );
+    return false;
+  }
+  return true;
+}
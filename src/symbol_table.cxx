@@ -0,0 +1,124 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include "frog/symbol_table.h"
+
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <ostream>
+#include "ticcutils/Unicode.h"
+
+using namespace std;
+using icu::UnicodeString;
+
+namespace {
+  struct symbol_hash {
+    size_t operator()( const UnicodeString& us ) const {
+      return us.hashCode();
+    }
+  };
+
+  /// \brief the process wide table of interned strings
+  /*!
+    The entries live in a deque, which never moves them, so a symbol can
+    keep a plain pointer to its entry and read it without any locking. Only
+    interning needs the lock, and as the sets of tags are small, nearly all
+    calls just find the string and only need a shared lock.
+   */
+  class symbol_table {
+  public:
+    const symbol_entry *intern( const UnicodeString& s ){
+      {
+	shared_lock<shared_mutex> guard( _lock );
+	auto it = _index.find( s );
+	if ( it != _index.end() ){
+	  return it->second;
+	}
+      }
+      unique_lock<shared_mutex> guard( _lock );
+      auto it = _index.find( s );
+      if ( it != _index.end() ){
+	// another thread was first
+	return it->second;
+      }
+      _entries.push_back( { s, static_cast<uint32_t>( _entries.size() + 1 ) } );
+      const symbol_entry *result = &_entries.back();
+      _index[s] = result;
+      return result;
+    }
+    size_t size() const {
+      shared_lock<shared_mutex> guard( _lock );
+      return _entries.size();
+    }
+  private:
+    mutable shared_mutex _lock;
+    deque<symbol_entry> _entries;
+    unordered_map<UnicodeString,const symbol_entry*,symbol_hash> _index;
+  };
+
+  symbol_table& the_table(){
+    static symbol_table table;
+    return table;
+  }
+}
+
+const UnicodeString symbol::empty_string;
+
+symbol::symbol( const string& s ):
+  _entry( intern( TiCC::UnicodeFromUTF8( s ) ) )
+{
+  /// create a symbol from an UTF8 encoded string
+}
+
+const symbol_entry *symbol::intern( const UnicodeString& s ){
+  /// find or add a string in the symbol table
+  /*!
+    \param s the string to intern
+    \return the entry in the table, or 0 for the empty string
+  */
+  if ( s.isEmpty() ){
+    return 0;
+  }
+  return the_table().intern( s );
+}
+
+size_t symbol::table_size(){
+  /// return the number of distinct symbols interned so far
+  return the_table().size();
+}
+
+ostream& operator<<( ostream& os, const symbol& s ){
+  /// output a symbol to a stream, UTF8 encoded
+  os << TiCC::UnicodeToUTF8( s.str() );
+  return os;
+}
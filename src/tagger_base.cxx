@@ -37,6 +37,7 @@
 #include "ticcutils/Unicode.h"
 #include "ticcutils/json.hpp"
 #include "frog/Frog-util.h"
+#include "frog/server_pool.h"
 
 using namespace std;
 using namespace Tagger;
@@ -48,13 +49,70 @@ using TiCC::operator<<;
 #define LOG *TiCC::Log(err_log)
 #define DBG *TiCC::Log(dbg_log)
 
+mbt_pool::mbt_pool( const string& init_string,
+		    TiCC::LogStream *log,
+		    size_t instances ){
+  /// load a number of MBT taggers
+  /*!
+    \param init_string the MBT options
+    \param log the LogStream for the taggers
+    \param instances the number of taggers to load
+  */
+  _log = new TiCC::LogStream( log );
+  for ( size_t i=0; i < instances; ++i ){
+    MbtAPI *tagger = new MbtAPI( init_string, *_log );
+    _all.push_back( tagger );
+    _free.push_back( tagger );
+    if ( !tagger->isInit() ){
+      break;
+    }
+  }
+}
+
+mbt_pool::~mbt_pool(){
+  /// destroy the taggers. None may be in use
+  for ( const auto& tagger : _all ){
+    delete tagger;
+  }
+  delete _log;
+}
+
+bool mbt_pool::isInit() const {
+  /// are all taggers loaded?
+  for ( const auto& tagger : _all ){
+    if ( !tagger->isInit() ){
+      return false;
+    }
+  }
+  return !_all.empty();
+}
+
+MbtAPI *mbt_pool::acquire(){
+  /// borrow a tagger, waiting until one is free
+  unique_lock<mutex> lock( _lock );
+  _available.wait( lock, [this]{ return !_free.empty(); } );
+  MbtAPI *result = _free.back();
+  _free.pop_back();
+  return result;
+}
+
+void mbt_pool::release( MbtAPI *tagger ){
+  /// give back a tagger from acquire()
+  {
+    lock_guard<mutex> lock( _lock );
+    _free.push_back( tagger );
+  }
+  _available.notify_one();
+}
+
 BaseTagger::BaseTagger( TiCC::LogStream *errlog,
 			TiCC::LogStream *dbglog,
 			const string& label ):
   debug(0),
   _label(label),
-  tagger(NULL),
-  filter(NULL)
+  _eos_mark("<utt>"),
+  filter(NULL),
+  _bundle(NULL)
 {
   err_log = new TiCC::LogStream( errlog );
   err_log->set_message( _label + "-tagger-" );
@@ -68,7 +126,6 @@ BaseTagger::BaseTagger( TiCC::LogStream *errlog,
 }
 
 BaseTagger::~BaseTagger(){
-  delete tagger;
   delete filter;
   if ( err_log != dbg_log ){
     delete dbg_log;
@@ -107,17 +164,28 @@ bool BaseTagger::fill_map( const string& file ){
   return true;
 }
 
-bool BaseTagger::init( const TiCC::Configuration& config ){
+bool BaseTagger::init( const TiCC::Configuration& config,
+		       const BaseTagger *model ){
   /// initalize a tagger from 'config'
   /*!
     \param config the TiCC::Configuration
+    \param model an already initialized tagger with the same label. When
+    given, we share the MBT taggers and the EOS mark of the model.
     \return true on succes, false otherwise
 
+    The model loads 'instances' MBT taggers (default 1) into an mbt_pool.
+    Every call borrows one of them.
+
   */
-  if ( tagger != 0 ){
+  if ( tagger ){
     LOG << _label << "-tagger is already initialized!" << endl;
     return false;
   }
+  if ( model && model->_label != _label ){
+    LOG << "unable to share the model of the " << model->_label
+	<< "-tagger" << endl;
+    return false;
+  }
   string val = config.lookUp( "host", _label );
   if ( !val.empty() ){
     // assume we must use a MBT server for tagging
@@ -229,8 +297,25 @@ bool BaseTagger::init( const TiCC::Configuration& config ){
     DBG << _label << "-tagger textclass= " << textclass << endl;
   }
   if ( _host.empty() ){
-    string init_string = "-s " + settings + " -vcf";
-    tagger = new MbtAPI( init_string, *dbg_log );
+    if ( model ){
+      if ( !model->tagger ){
+	LOG << "unable to share the " << _label
+	    << "-tagger model: it isn't loaded" << endl;
+	return false;
+      }
+      tagger = model->tagger;
+      _eos_mark = model->_eos_mark;
+      return true;
+    }
+    size_t instances = 1;
+    val = config.lookUp( "instances", _label );
+    if ( !val.empty()
+	 && ( !TiCC::stringTo<size_t>( val, instances ) || instances == 0 ) ){
+      LOG << "invalid 'instances' value in configuration: " << val << endl;
+      return false;
+    }
+    tagger = make_shared<mbt_pool>( "-s " + settings + " -vcf",
+				    dbg_log, instances );
     return tagger->isInit();
   }
   else {
@@ -323,76 +408,27 @@ vector<TagResult> json_to_TR( const json& in ){
   return result;
 }
 
-json BaseTagger::read_from_client( Sockets::ClientSocket& client ) const {
-  string input_line;
-  client.read( input_line );
-  json response;
-  try {
-    response = json::parse( input_line );
-  }
-  catch ( const exception& e ){
-    LOG << "json parsing failed on '" << input_line << "':"
-	<< e.what() << endl;
-    abort();
-  }
-  DBG << "received json data:" << response << endl;
-  return response;
-}
-
-void BaseTagger::write_to_client( json& j_out,
-				  Sockets::ClientSocket& client ) const {
-  string output_line = j_out.dump() + "\n";
-  DBG << "sending json data:" << output_line << endl;
-  client.write( output_line );
-}
-
 vector<TagResult> BaseTagger::call_server( const vector<tag_entry>& tv ) const {
-  /// Connect to a MBT server, send and receive JSON and translate to a
+  /// Send a query to a MBT server and translate the JSON result to a
   /// TagResult list
   /*!
     \param tv the tag_entry we would like to be serviced
     \return a vector of TagResult elements
 
-    We set up a connection to the configured server, send a query in JSON
-    and on succesful receiving back a JSON result we convert it back into
-    a TagResult vector
+    We send a query in JSON to the configured server, and on succesful
+    receiving back a JSON result we convert it back into a TagResult vector
 
-    \note So this is a one-shot operation. No connection to the MBT server is
-    kept open.
+    \note The connection is taken from the ServerPool, so it is kept open
+    for the next query.
   */
-  Sockets::ClientSocket client;
-  if ( !client.connect( _host, _port ) ){
-    LOG << "failed to open connection, " << _label << "::" << _host
-	<< ":" << _port << endl
-	<< "Reason: " << client.getMessage() << endl;
-    exit( EXIT_FAILURE );
-  }
   DBG << "calling " << _label << "-server, base=" << base << endl;
-  json response = read_from_client( client );
-  if ( response["status"] != "ok" ){
-    LOG << "the client isn't OK" << endl;
-    abort();
-  }
-  if ( !base.empty() ){
-    json out_json;
-    out_json["command"] = "base";
-    out_json["param"] = base;
-    DBG << "created json" << out_json << endl;
-    write_to_client( out_json, client );
-    json base_response = read_from_client( client );
-    if ( base_response["status"] != "ok" ){
-      LOG << "the client isn't OK" << endl;
-      abort();
-    }
-  }
   // create json query struct
   json my_json = create_json( tv );
   DBG << "created json" << my_json << endl;
-  // send it to the server
-  write_to_client( my_json, client );
-  // receive json
-  my_json = read_from_client( client );
-  return json_to_TR( my_json );
+  json response = ServerPool::instance().query( _host, _port, base,
+						my_json, dbg_log );
+  DBG << "received json data:" << response << endl;
+  return json_to_TR( response );
 }
 
 vector<TagResult> BaseTagger::tagLine( const icu::UnicodeString& line ){
@@ -425,7 +461,9 @@ vector<TagResult> BaseTagger::tagLine( const icu::UnicodeString& line ){
   if ( debug > 1 ){
     DBG << "TAGGING LINE: " << line << endl;
   }
-  return tagger->TagLine( line );
+  pooled_tagger mbt( *tagger );
+  mbt->set_eos_mark( _eos_mark );
+  return mbt->TagLine( line );
 }
 
 vector<TagResult> BaseTagger::tag_entries( const vector<tag_entry>& to_do ){
@@ -444,30 +482,100 @@ vector<TagResult> BaseTagger::tag_entries( const vector<tag_entry>& to_do ){
     return call_server(to_do);
   }
   else {
+    if ( !tagger ){
+      throw runtime_error( _label + "-tagger is not initialized" );
+    }
+    UnicodeString block = make_block( to_do );
+    pooled_tagger mbt( *tagger );
+    mbt->set_eos_mark( _eos_mark );
+    return mbt->TagLine( block );
+  }
+}
+
+UnicodeString BaseTagger::make_block( const vector<tag_entry>& to_do ) const {
+  /// create the input for the MBT tagger for 1 sentence
+  /*!
+    \param to_do a vector of tag_entry elements representing 1 sentence
+    \return a text block, ending with our EOS mark
+  */
+  UnicodeString block;
+  for ( const auto& e: to_do ){
+    block += e.word;
+    if ( !e.enrichment.isEmpty() ){
+      block += "\t" + e.enrichment;
+      block += "\t??\n";
+    }
+    else {
+      block += " ";
+    }
+  }
+  block += _eos_mark + "\n";
+  return block;
+}
+
+vector<vector<TagResult>> BaseTagger::tag_batch( const vector<vector<tag_entry>>& batch ){
+  /// tag a batch of sentences
+  /*!
+    \param batch a list of sentences, each a vector of tag_entry elements
+    \return a list with the TagResult elements for every sentence
+
+    A local MBT tagger gets the whole batch as one block, in one call. The
+    results are split per sentence using the known number of words.
+    A MBT server is called for every sentence, as its protocol handles 1
+    sentence per request.
+  */
+  vector<vector<TagResult>> result;
+  result.reserve( batch.size() );
+  if ( _host.empty() && batch.size() > 1 ){
     if ( !tagger ){
       throw runtime_error( _label + "-tagger is not initialized" );
     }
     UnicodeString block;
-    for ( const auto& e: to_do ){
-      block += e.word;
-      if ( !e.enrichment.isEmpty() ){
-	block += "\t" + e.enrichment;
-	block += "\t??\n";
+    size_t total = 0;
+    for ( const auto& sent : batch ){
+      if ( !sent.empty() ){
+	block += make_block( sent );
+	total += sent.size();
       }
-      else {
-	block += " ";
+    }
+    if ( debug > 1 ){
+      DBG << "TAGGING BATCH of " << batch.size() << " sentences, "
+	  << total << " words" << endl;
+    }
+    vector<TagResult> all;
+    {
+      pooled_tagger mbt( *tagger );
+      mbt->set_eos_mark( _eos_mark );
+      all = mbt->TagLine( block );
+    }
+    if ( all.size() == total ){
+      auto it = all.begin();
+      for ( const auto& sent : batch ){
+	result.emplace_back( make_move_iterator( it ),
+			     make_move_iterator( it + sent.size() ) );
+	it += sent.size();
       }
+      return result;
     }
-    block += "<utt>\n"; // should use tagger.eosmark??
-    return tagger->TagLine( block );
+    // we can't tell which sentence went wrong, so tag them one by one
+    // to get the mismatch reported for the right sentence
+    LOG << _label << "-tagger mismatch in a batch, retrying per sentence"
+	<< endl;
+  }
+  for ( const auto& sent : batch ){
+    result.push_back( tag_entries( sent ) );
   }
+  return result;
 }
 
 UnicodeString BaseTagger::set_eos_mark( const icu::UnicodeString& eos ){
-  /// set the EOS marker for the tagger
+  /// set the EOS marker for this session
   /*!
     \param eos the eos marker as a UnicodeString
     \return the old value
+
+    The mark is handed to the tagger on every call, and sessions created
+    from us later inherit it.
   */
   if ( !_host.empty() ){
     // just ignore??
@@ -475,7 +583,9 @@ UnicodeString BaseTagger::set_eos_mark( const icu::UnicodeString& eos ){
     return "";
   }
   if ( tagger ){
-    return tagger->set_eos_mark( eos );
+    UnicodeString old = _eos_mark;
+    _eos_mark = eos;
+    return old;
   }
   throw runtime_error( _label + "-tagger is not initialized" );
 }
@@ -521,12 +631,40 @@ void BaseTagger::Classify( frog_data& sent ){
 
     When tagging succeeds, 'sent' will be extended with the tag results
    */
-  _words.clear();
-  vector<tag_entry> to_do = extract_sentence( sent );
-  if ( debug > 1 ){
-    DBG << _label << "-tagger in: " << to_do << endl;
+  vector<frog_data*> batch( 1, &sent );
+  Classify( batch );
+}
+
+void BaseTagger::Classify( const vector<frog_data*>& batch ){
+  /// Tag a batch of sentences, given in frog_data format
+  /*!
+    \param batch the frog_data structures to analyze
+
+    All sentences are tagged with one call to the tagger. When tagging
+    succeeds, every sentence will be extended with its tag results
+   */
+  vector<vector<tag_entry>> to_do;
+  to_do.reserve( batch.size() );
+  for ( const auto& sent : batch ){
+    to_do.push_back( extract_sentence( *sent ) );
+    if ( debug > 1 ){
+      DBG << _label << "-tagger in: " << to_do.back() << endl;
+    }
   }
-  _tag_result = tag_entries( to_do );
+  vector<vector<TagResult>> results = tag_batch( to_do );
+  for ( size_t i=0; i < batch.size(); ++i ){
+    _tag_result = std::move( results[i] );
+    finish_sentence( *batch[i] );
+  }
+}
+
+void BaseTagger::finish_sentence( frog_data& sent ){
+  /// check the tagger results for one sentence, and add them to it
+  /*!
+    \param sent the frog_data structure to extend with the tag results
+    in _tag_result
+   */
+  _words.clear();
   if ( _tag_result.size() != sent.size() ){
     LOG << _label << "-tagger mismatch between number of words and the tagger result." << endl;
     LOG << "words according to sentence: " << endl;
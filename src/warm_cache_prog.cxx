@@ -0,0 +1,224 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2024
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include "config.h"
+#include "ticcutils/LogStream.h"
+#include "ticcutils/Configuration.h"
+#include "ticcutils/CommandLine.h"
+#include "ticcutils/StringOps.h"
+#include "ticcutils/Unicode.h"
+#include "timbl/TimblAPI.h"
+#include "frog/mblem_mod.h"
+#include "frog/mbma_mod.h"
+
+using namespace std;
+using icu::UnicodeString;
+
+TiCC::LogStream my_default_log( cerr ); // fall-back
+TiCC::LogStream *theErrLog = &my_default_log;  // fill the externals
+
+vector<string> fileNames;
+bool doMblem = true;
+bool doMbma = true;
+size_t min_freq = 0;
+
+TiCC::Configuration configuration;
+static string configDir = string(SYSCONF_PATH) + "/" + PACKAGE + "/nld/";
+static string configFileName = configDir + "frog.cfg";
+
+static Mblem myMblem(theErrLog);
+static Mbma myMbma(theErrLog);
+
+void usage( ) {
+  cout << endl << "frog-warm-cache [options] frequency-list(s)" << endl
+       << "Fill the cache files of the lemmatizer and the morphological analyzer"
+       << endl << "with all words from one or more frequency lists." << endl
+       << "Every line holds a word, optionally followed by its frequency."
+       << endl;
+  cout << "Options:\n"
+       << "\t -c <filename>    Set configuration file (default " << configFileName << ")\n"
+       << "\t\t the 'persistent_cache' entries of the [[mblem]] and [[mbma]]\n"
+       << "\t\t sections name the files to fill.\n"
+       << "\t -n <freq>        skip words with a frequency below 'freq'\n"
+       << "\t --nomblem        don't fill the lemmatizer cache\n"
+       << "\t --nombma         don't fill the morphological analyzer cache\n"
+       << "\t -h. give some help.\n"
+       << "\t -V or --version .   Show version info.\n"
+       << "\t -d <debug level>    (for more verbosity)\n";
+}
+
+bool parse_args( TiCC::CL_Options& Opts ) {
+  if ( Opts.is_present('V') || Opts.is_present("version" ) ){
+    // we already did show what we wanted.
+    exit( EXIT_SUCCESS );
+  }
+  if ( Opts.is_present ('h') ) {
+    usage();
+    exit( EXIT_SUCCESS );
+  };
+  Opts.extract( 'c', configFileName );
+  if ( configuration.fill( configFileName ) ){
+    cerr << "config read from: " << configFileName << endl;
+  }
+  else {
+    cerr << "failed to read configuration from! '" << configFileName << "'" << endl;
+    cerr << "did you correctly install the frogdata package?" << endl;
+    return false;
+  }
+  string value;
+  if ( Opts.extract( 'd', value ) ) {
+    int debug = 0;
+    if ( !TiCC::stringTo<int>( value, debug ) ){
+      cerr << "-d value should be an integer" << endl;
+      return false;
+    }
+    configuration.setatt( "debug", value, "mblem" );
+    configuration.setatt( "debug", value, "mbma" );
+  }
+  if ( Opts.extract( 'n', value ) ){
+    if ( !TiCC::stringTo<size_t>( value, min_freq ) ){
+      cerr << "-n value should be a positive integer" << endl;
+      return false;
+    }
+  }
+  doMblem = !Opts.is_present( "nomblem" );
+  doMbma = !Opts.is_present( "nombma" );
+  if ( doMblem && configuration.lookUp( "persistent_cache", "mblem" ).empty() ){
+    cerr << "no 'persistent_cache' in the [[mblem]] section, skipping mblem"
+	 << endl;
+    doMblem = false;
+  }
+  if ( doMbma && configuration.lookUp( "persistent_cache", "mbma" ).empty() ){
+    cerr << "no 'persistent_cache' in the [[mbma]] section, skipping mbma"
+	 << endl;
+    doMbma = false;
+  }
+  if ( !doMblem && !doMbma ){
+    cerr << "nothing to do" << endl;
+    return false;
+  }
+  fileNames = Opts.getMassOpts();
+  if ( fileNames.empty() ){
+    cerr << "missing frequency list(s)" << endl;
+    return false;
+  }
+  return true;
+}
+
+bool init(){
+  if ( doMblem && !myMblem.init( configuration ) ){
+    cerr << "MBLEM Initialization failed." << endl;
+    return false;
+  }
+  if ( doMbma && !myMbma.init( configuration ) ){
+    cerr << "MBMA Initialization failed." << endl;
+    return false;
+  }
+  cerr << "Initialization done." << endl;
+  return true;
+}
+
+size_t Warm( istream& in ){
+  size_t count = 0;
+  UnicodeString line;
+  while ( TiCC::getline( in, line ) ){
+    if ( line.isEmpty() || line[0] == '#' ){
+      continue;
+    }
+    vector<UnicodeString> parts = TiCC::split( line );
+    if ( parts.empty() ){
+      continue;
+    }
+    if ( min_freq > 0 ){
+      size_t freq = 0;
+      if ( parts.size() < 2
+	   || !TiCC::stringTo<size_t>( TiCC::UnicodeToUTF8(parts[1]), freq )
+	   || freq < min_freq ){
+	continue;
+      }
+    }
+    if ( doMblem ){
+      myMblem.prewarm( parts[0] );
+    }
+    if ( doMbma ){
+      myMbma.prewarm( parts[0] );
+    }
+    if ( ++count % 10000 == 0 ){
+      cerr << count << " words" << endl;
+    }
+  }
+  return count;
+}
+
+int main( int argc, char *argv[] ) {
+  std::ios_base::sync_with_stdio(false);
+  cerr << "frog-warm-cache " << VERSION << " (c) CLST, ILK 2024." << endl;
+  TiCC::CL_Options Opts( "c:d:hVn:", "version,nomblem,nombma" );
+  try {
+    Opts.init( argc, argv );
+  }
+  catch ( const exception& e ){
+    cerr << "fatal error: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+  if ( !parse_args( Opts ) ){
+    return EXIT_FAILURE;
+  }
+  if ( !init() ){
+    cerr << "terminated." << endl;
+    return EXIT_FAILURE;
+  }
+  size_t total = 0;
+  for ( const auto& name : fileNames ){
+    ifstream in( name );
+    if ( !in ){
+      cerr << "unable to open: " << name << endl;
+      return EXIT_FAILURE;
+    }
+    cerr << "Processing: " << name << endl;
+    total += Warm( in );
+  }
+  cerr << "done, " << total << " words" << endl;
+  if ( doMblem ){
+    cerr << "written " << myMblem.disk_cache_written()
+	 << " records to the lemmatizer cache" << endl;
+  }
+  if ( doMbma ){
+    cerr << "written " << myMbma.disk_cache_written()
+	 << " records to the morphological analyzer cache" << endl;
+  }
+  return EXIT_SUCCESS;
+}